@@ -0,0 +1,294 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <curl/curl.h>
+
+/**
+ * rcbench - micro-benchmark of the byte-level parsing path, without network
+ *
+ * Usage: rcbench [-p pages] [-r records] [-s text size] [-c chunk size] [-n rounds] [-e]
+ *
+ * Feeds synthetic RingEX list responses through rc_curl_write_json in curl
+ * sized chunks (by default an awkward mix from 1 byte up, so that '[' and
+ * page ends land on every kind of boundary), calling rc_curl_next_page (and
+ * through it rc_json_bridge) after every page, the same as the page loop.
+ * Record text embeds ']' and "nextPage" on purpose. With -e, the last page
+ * comes back empty, as it can when records shift between requests.
+ * rc_char_extract is measured separately on access token responses.
+ *
+ * Throughput is reported in GB/s (best of n rounds), and allocations per
+ * megabyte of input. The stitched result is checked after every round:
+ * record count, next page urls and a well-formed records array. The exit
+ * status is 1 if a check failed, so the suite can guard against regressions.
+ *
+ * rc_curl_write_json and rc_curl_next_page are exported, but rc_json_bridge
+ * and rc_char_extract are static, and realloc has to be redirected to count
+ * buffer (re)allocations, so both translation units are built into this
+ * program directly instead of linking the library.
+ */
+
+static size_t bench_n_allocs = 0;
+
+static void* bench_realloc(void* data, size_t size) { bench_n_allocs++; return realloc(data, size); }
+
+#define realloc bench_realloc
+#include "../lib/json_content.c"
+#include "../lib/bearer_token.c"
+#undef realloc
+
+#include "json_scan.h"
+
+#define BENCH_URL "https://platform.ringcentral.com/restapi/v1.0/account/~/call-log?perPage=1000&page="
+#define BENCH_TOKENS 4096
+
+typedef struct {
+
+    char* data;
+    size_t n_bytes;
+
+} BenchPage;
+
+static const size_t bench_chunks[] = { 1, 17, 4093, 2, 16384, 7, 1021, 3, 65521, 509 };
+
+static inline double bench_now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+
+}
+
+static BenchPage bench_page(size_t page, size_t n_pages, size_t n_records, size_t text_size, bool empty) {
+
+    const size_t size = (n_records + 1) * (text_size + 512) + 1024;
+    BenchPage result = { .data = malloc(size), .n_bytes = 0 };
+    char* out = result.data;
+
+    char* text = malloc(text_size + 1);
+    for (size_t i = 0; i < text_size; i++) { text[i] = "abcdefgh ]ij"[i % 12]; }
+    text[text_size] = '\0';
+
+    if (empty) { n_records = 0; }
+
+    out += sprintf(out, "{\n  \"uri\" : \"" BENCH_URL "%zu\",\n  \"records\" : [ ", page);
+
+    for (size_t i = 0; i < n_records; i++) {
+
+        out += sprintf(out, "%s{\n    \"id\" : \"%zu\",\n    \"startTime\" : \"2024-03-01T09:30:00.000Z\",\n"
+                            "    \"duration\" : %zu,\n    \"direction\" : \"Inbound\",\n"
+                            "    \"from\" : { \"name\" : \"\\\"nextPage\\\" : [ ] %s\" },\n"
+                            "    \"to\" : { \"phoneNumber\" : \"+16505550100\" }\n  }",
+                       i ? ", " : "", page * n_records + i, i % 600, text);
+
+    }
+
+    out += sprintf(out, " ],\n  \"paging\" : { \"page\" : %zu, \"totalPages\" : %zu },\n  \"navigation\" : {", page, n_pages);
+    if (page < n_pages) { out += sprintf(out, " \"nextPage\" : { \"uri\" : \"" BENCH_URL "%zu\" }", page + 1); }
+    out += sprintf(out, " }\n}");
+
+    free(text);
+    result.n_bytes = out - result.data;
+    return result;
+
+}
+
+// one page loop over all pages; returns false if the stitched result is wrong
+static bool bench_json(JsonContent* json, const BenchPage* pages, size_t n_pages, size_t chunk,
+                       double* t_write, double* t_next) {
+
+    size_t k = 0;
+    char expected[256];
+    bool ok = true;
+
+    rc_json_reset(json);
+    *t_write = 0;
+    *t_next = 0;
+
+    for (size_t p = 0; p < n_pages; p++) {
+
+        double start = bench_now();
+
+        for (size_t offset = 0, n; offset < pages[p].n_bytes; offset += n) {
+
+            n = chunk ? chunk : bench_chunks[k++ % (sizeof(bench_chunks) / sizeof(size_t))];
+            n = n < pages[p].n_bytes - offset ? n : pages[p].n_bytes - offset;
+
+            if (rc_curl_write_json(pages[p].data + offset, 1, n, json) != n) { return false; }
+
+        }
+
+        *t_write += bench_now() - start;
+
+        start = bench_now();
+        rc_curl_next_page(json);
+        *t_next += bench_now() - start;
+
+        snprintf(expected, sizeof(expected), BENCH_URL "%zu", p + 2);
+
+        if (p + 1 < n_pages) { ok &= json->url_next_page && strcmp(json->url_next_page, expected) == 0; }
+        else { ok &= json->url_next_page == NULL; }
+
+    }
+
+    return ok;
+
+}
+
+static size_t bench_count(const JsonContent* json) {
+
+    JsonScan scan;
+    size_t n_records = 0;
+    size_t n;
+
+    if (!rc_scan_records(&scan, json->buffer, json->n_bytes)) { return 0; }
+
+    for (const char* record; (record = rc_scan_next(&scan, &n)); ) {
+
+        size_t length;
+        if (*record != '{' || record[n - 1] != '}' || !rc_scan_field(record, n, "id", &length)) { return 0; }
+        n_records++;
+
+    }
+
+    return n_records;
+
+}
+
+static double bench_tokens(size_t n_rounds, size_t* n_bytes) {
+
+    const char* format = "{\n  \"access_token\" : \"%s\",\n  \"token_type\" : \"bearer\",\n  \"expires_in\" : 3600,\n"
+                         "  \"refresh_token\" : \"%s\",\n  \"refresh_token_expires_in\" : 604800,\n"
+                         "  \"scope\" : \"CallLog ExtensionInfo ReadAccounts\",\n  \"owner_id\" : \"256440016\"\n}";
+
+    char value[1201];
+    for (size_t i = 0; i < sizeof(value) - 1; i++) { value[i] = "U1BCMDFUMDRKV1MwMXxzLFSvXdw5PHMsVLEn_MrtcyxUsw"[i % 46]; }
+    value[sizeof(value) - 1] = '\0';
+
+    char response[4096];
+    const size_t size = snprintf(response, sizeof(response), format, value, value);
+    char* batch = malloc(size * BENCH_TOKENS);
+    double best = 0;
+    volatile size_t sink = 0;
+
+    for (size_t round = 0; round < n_rounds; round++) {
+
+        for (size_t i = 0; i < BENCH_TOKENS; i++) { memcpy(batch + i * size, response, size); }
+
+        const double start = bench_now();
+
+        for (size_t i = 0; i < BENCH_TOKENS; i++) {
+
+            char* rest = batch + i * size;
+            size_t bytes = size;
+
+            for (const char* field; (field = rc_char_extract(&rest, &bytes)); ) { sink += field[0]; }
+
+        }
+
+        const double elapsed = bench_now() - start;
+        if (best == 0 || elapsed < best) { best = elapsed; }
+
+    }
+
+    (void)sink;
+    free(batch);
+    *n_bytes = size * BENCH_TOKENS;
+    return best;
+
+}
+
+int main(int argc, char** argv) {
+
+    size_t n_pages = 20, n_records = 1000, text_size = 64, chunk = 0, n_rounds = 10;
+    bool empty = false;
+
+    for (int i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], "-e") == 0) { empty = true; continue; }
+        if (i + 1 == argc) { break; }
+
+        const size_t value = strtoul(argv[i + 1], NULL, 10);
+
+        if (strcmp(argv[i], "-p") == 0) { n_pages = value ? value : 1; i++; }
+        else if (strcmp(argv[i], "-r") == 0) { n_records = value; i++; }
+        else if (strcmp(argv[i], "-s") == 0) { text_size = value; i++; }
+        else if (strcmp(argv[i], "-c") == 0) { chunk = value; i++; }
+        else if (strcmp(argv[i], "-n") == 0) { n_rounds = value ? value : 1; i++; }
+
+    }
+
+    BenchPage* pages = calloc(n_pages, sizeof(BenchPage));
+    size_t n_bytes = 0;
+
+    for (size_t p = 0; p < n_pages; p++) {
+
+        pages[p] = bench_page(p + 1, n_pages, n_records, text_size, empty && p + 1 == n_pages);
+        n_bytes += pages[p].n_bytes;
+
+    }
+
+    const size_t expected = n_records * (empty ? n_pages - 1 : n_pages);
+    double best_write = 0, best_next = 0;
+    size_t n_allocs = 0;
+    bool ok = true;
+
+    for (size_t round = 0; round < n_rounds; round++) {
+
+        double t_write, t_next;
+        const size_t before = bench_n_allocs;
+
+        // a fresh container every round, so allocations are those of a real page loop
+        JsonContent* json = RC_JSON_INIT(0);
+
+        ok &= bench_json(json, pages, n_pages, chunk, &t_write, &t_next);
+        ok &= bench_count(json) == expected;
+
+        n_allocs = bench_n_allocs - before;
+        if (best_write == 0 || t_write < best_write) { best_write = t_write; }
+        if (best_next == 0 || t_next < best_next) { best_next = t_next; }
+
+        rc_json_free(json);
+
+    }
+
+    size_t token_bytes = 0;
+    const double t_token = bench_tokens(n_rounds, &token_bytes);
+    const double mb = n_bytes / 1048576.0;
+
+    char chunks[64] = "mixed, 1 byte to 64 kB";
+    if (chunk) { snprintf(chunks, sizeof(chunks), "%zu bytes", chunk); }
+
+    printf("input: %zu pages x %zu records (%s last page), %.1f MB, chunks %s\n",
+           n_pages, n_records, empty ? "empty" : "full", mb, chunks);
+
+    printf("rc_curl_write_json  %8.3f GB/s  %6.2f allocations/MB\n", n_bytes / best_write / 1e9, n_allocs / mb);
+    printf("rc_curl_next_page   %8.3f GB/s  (per input byte, incl. rc_json_bridge)\n", n_bytes / best_next / 1e9);
+    printf("rc_char_extract     %8.3f GB/s  (%d token responses)\n", token_bytes / t_token / 1e9, BENCH_TOKENS);
+    printf("check: %s (%zu records expected)\n", ok ? "ok" : "FAILED", expected);
+
+    for (size_t p = 0; p < n_pages; p++) { free(pages[p].data); }
+    free(pages);
+    return ok ? 0 : 1;
+
+}
@@ -0,0 +1,77 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "ringextract.h"
+
+/**
+ * rcjob - run a declarative extraction job
+ *
+ * Usage: rcjob [-j threads] manifest
+ *
+ * Credentials are read from the standard environment variables
+ * (RC_CLIENT_ID, RC_CLIENT_SECRET, RC_JWT). See job_runner.h for the
+ * manifest format. A summary line is printed for every node; the exit
+ * status is the number of nodes that failed or were skipped (0 on success).
+ */
+int main(int argc, char** argv) {
+
+    size_t n_threads = 0;
+    const char* manifest = NULL;
+
+    for (int i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) { n_threads = strtoul(argv[++i], NULL, 10); }
+        else { manifest = argv[i]; }
+
+    }
+
+    if (manifest == NULL) {
+
+        fprintf(stderr, "usage: %s [-j threads] manifest\n", argv[0]);
+        return 1;
+
+    }
+
+    BearerToken* token = RC_TOKEN_SKELETON();
+    JobRunner* runner = RC_JOBS_INIT(n_threads);
+
+    if (rc_jobs_load(runner, manifest) == NULL) {
+
+        fprintf(stderr, "%s\n", runner->error);
+        RC_JOBS_FREE(runner);
+        return 1;
+
+    }
+
+    const size_t n_failed = rc_jobs_run(token, runner);
+
+    for (size_t i = 0; i < runner->n_nodes; i++) {
+
+        const JobNode* node = runner->nodes + i;
+
+        printf("%-24s %6zu requests %6zu failed  %s\n",
+               node->name, node->n_tasks, node->n_failed, node->error);
+
+    }
+
+    RC_JOBS_FREE(runner);
+    return n_failed > 255 ? 255 : (int)n_failed;
+
+}
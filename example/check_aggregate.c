@@ -0,0 +1,159 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "ringextract.h"
+
+#define HOUR_10 1705312800000LL // 2024-01-15T10:00:00Z
+#define N_REPEATS 40000         // enough rows for every worker of a default query
+
+typedef struct {
+
+    int64_t extension;
+    const char* result;
+    size_t count;
+    int64_t sum, min, max, p50, p90;
+
+} Expected;
+
+static const char* page = "{\"records\":["
+    "{\"startTime\":\"2024-01-15T10:05:00.000Z\",\"duration\":30,\"result\":\"Accepted\",\"extension\":{\"id\":101}},"
+    "{\"startTime\":\"2024-01-15T10:40:00.000Z\",\"duration\":90,\"result\":\"Accepted\",\"extension\":{\"id\":101}},"
+    "{\"startTime\":\"2024-01-15T11:10:00.000Z\",\"duration\":0,\"result\":\"Missed\",\"extension\":{\"id\":101}},"
+    "{\"startTime\":\"2024-01-15T10:15:00.000Z\",\"duration\":60,\"result\":\"Accepted\",\"extension\":{\"id\":102}},"
+    "{\"startTime\":\"2024-01-15T11:30:00.000Z\",\"duration\":120,\"result\":\"Accepted\",\"extension\":{\"id\":102}},"
+    "{\"startTime\":\"2024-01-15T11:45:00.000Z\",\"duration\":240,\"result\":\"Accepted\",\"extension\":{\"id\":102}},"
+    "{\"startTime\":\"2024-01-15T12:00:00.000Z\",\"duration\":0,\"result\":\"Missed\",\"extension\":{\"id\":102}}"
+    "],\"paging\":{\"page\":1}}";
+
+// calls by extension and result between 10:00 and 12:00, the last call falls outside
+static const Expected by_result[] = {
+
+    { 101, "Accepted", 2, 120, 30, 90, 30, 90 },
+    { 101, "Missed", 1, 0, 0, 0, 0, 0 },
+    { 102, "Accepted", 3, 420, 60, 240, 120, 240 }
+
+};
+
+static ColumnFile* write_calls(const char* file, size_t n_repeats) {
+
+    ColumnWriter* writer = rc_col_writer(RC_SCHEMA_CALL_LOG);
+    for (size_t i = 0; writer && i < n_repeats; i++) { rc_col_append(writer, page, strlen(page)); }
+
+    const bool written = writer && rc_col_fwrite(writer, file) != NULL;
+    if (writer) { rc_col_writer_free(writer); }
+
+    return written ? rc_col_open(file) : NULL;
+
+}
+
+static int check_by_result(const ColumnFile* calls, size_t n_repeats, size_t n_threads) {
+
+    AggQuery query = {
+        .keys = { RC_CALL_EXTENSION_ID, RC_CALL_RESULT }, .n_keys = 2, .value = RC_CALL_DURATION,
+        .time = RC_CALL_START_TIME, .from = HOUR_10, .to = HOUR_10 + 2 * AGG_HOUR, .n_threads = n_threads
+    };
+
+    AggResult* result = rc_agg_run(calls, &query);
+    int failed = 0;
+
+    if (result == NULL || result->n_groups != 3 || result->n_rows != 6 * n_repeats) {
+
+        printf("check_aggregate: %zu threads, %zu groups from %zu rows\n", n_threads,
+               result ? result->n_groups : 0, result ? result->n_rows : 0);
+        if (result) { rc_agg_free(result); }
+        return 1;
+
+    }
+
+    for (size_t g = 0; g < 3; g++) {
+
+        const AggGroup* group = result->groups + g;
+        const Expected* expected = by_result + g;
+        const char* label = rc_col_label(calls, RC_CALL_RESULT, (uint8_t)group->keys[1]);
+
+        if (group->keys[0] != expected->extension || label == NULL || strcmp(label, expected->result) != 0 ||
+            group->count != expected->count * n_repeats || group->sum != expected->sum * (int64_t)n_repeats ||
+            group->min != expected->min || group->max != expected->max ||
+            rc_agg_percentile(result, g, 0.5) != expected->p50 || rc_agg_percentile(result, g, 0.9) != expected->p90) {
+
+            printf("check_aggregate: %zu threads, group %zu is %lld %s: %zu calls, %lld s, %lld-%lld s, p50 %lld s, p90 %lld s\n",
+                   n_threads, g, (long long)group->keys[0], label ? label : "NULL", group->count, (long long)group->sum,
+                   (long long)group->min, (long long)group->max,
+                   (long long)rc_agg_percentile(result, g, 0.5), (long long)rc_agg_percentile(result, g, 0.9));
+            failed = 1;
+
+        }
+
+    }
+
+    rc_agg_free(result);
+    return failed;
+
+}
+
+/**
+ * Offline check of the aggregation: group-by with a time filter, hourly
+ * buckets, and percentiles over a small fixed record set; then the same set
+ * repeated until the rows are split across workers, whose partial groups
+ * must merge into the same answer as a single worker's.
+ */
+int main(void) {
+
+    const char* file = "check_aggregate.col";
+    int failed = 0;
+
+    ColumnFile* calls = write_calls(file, 1);
+    if (calls == NULL) { printf("check_aggregate: column file not readable\n"); unlink(file); return 1; }
+
+    failed |= check_by_result(calls, 1, 0);
+
+    AggQuery hourly = { .keys = { RC_CALL_START_TIME }, .n_keys = 1, .bucket = AGG_HOUR, .value = RC_CALL_DURATION };
+    AggResult* result = rc_agg_run(calls, &hourly);
+
+    const int64_t hours[] = { HOUR_10, HOUR_10 + AGG_HOUR, HOUR_10 + 2 * AGG_HOUR };
+    const int64_t sums[] = { 180, 360, 0 };
+
+    if (result == NULL || result->n_groups != 3) { printf("check_aggregate: hourly groups missing\n"); failed = 1; }
+
+    for (size_t g = 0; result && g < result->n_groups && g < 3; g++) {
+
+        const AggGroup* group = result->groups + g;
+        if (group->keys[0] != hours[g] || group->sum != sums[g] || rc_agg_percentile(result, g, 1.0) != group->max)
+        { printf("check_aggregate: hour %zu is %lld, %lld s\n", g, (long long)group->keys[0], (long long)group->sum); failed = 1; }
+
+    }
+
+    if (result) { rc_agg_free(result); }
+    rc_col_close(calls);
+
+    calls = write_calls(file, N_REPEATS);
+    if (calls == NULL) { printf("check_aggregate: repeated column file not readable\n"); unlink(file); return 1; }
+
+    failed |= check_by_result(calls, N_REPEATS, 1);
+    failed |= check_by_result(calls, N_REPEATS, AGG_THREADS);
+
+    rc_col_close(calls);
+    unlink(file);
+
+    if (!failed) { printf("check_aggregate: ok\n"); }
+    return failed;
+
+}
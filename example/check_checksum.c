@@ -0,0 +1,145 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "checksum.h"      // ahead of ringextract.h, for the internal checksum routines
+#include "media_content.h" // and for rc_curl_write_media
+#include "ringextract.h"
+
+#define N_MILLION 1000000
+
+typedef struct {
+
+    const char* input;
+    size_t n_repeats; // input is repeated, fed in chunks of varying size
+    uint32_t crc32c;
+    const char* sha256;
+
+} Vector;
+
+static const Vector vectors[] = {
+
+    { "", 1, 0x00000000, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+    { "abc", 1, 0x364b3fb7, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+    { "123456789", 1, 0xe3069283, "15e2b0d3c33891ebb0f1ef609ec419420c20e320ce94c65fbc8c3312448eb225" },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1, 0x071325f5,
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+    { "a", N_MILLION, 0x436fe240, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" }
+
+};
+
+static void hex(const uint8_t* digest, size_t n, char* out) {
+
+    for (size_t i = 0; i < n; i++) { sprintf(out + 2 * i, "%02x", digest[i]); }
+
+}
+
+// feed the input in chunks of 1 to 97 bytes, so blocks are split at every offset
+static void checksum_vector(const Vector* vector, const char* repeated, Checksum* checksum, char* sha256) {
+
+    const size_t n = strlen(vector->input) * vector->n_repeats;
+    const char* data = vector->n_repeats > 1 ? repeated : vector->input;
+    uint8_t digest[SHA256_SIZE];
+
+    rc_checksum_init(checksum);
+    for (size_t i = 0, chunk = 1; i < n; i += chunk, chunk = chunk % 97 + 1)
+    { rc_checksum_update(checksum, data + i, chunk < n - i ? chunk : n - i); }
+
+    rc_checksum_final(checksum, digest);
+    hex(digest, SHA256_SIZE, sha256);
+
+}
+
+/**
+ * Offline check of the checksums: known-answer vectors for CRC32C and
+ * SHA-256 on both the CPU extensions (where available) and the portable
+ * code, then a manifest entry matching the file it describes.
+ */
+int main(void) {
+
+    static char repeated[N_MILLION];
+    const char* file = "check_checksum.bin";
+    const char* manifest = "check_checksum.jsonl";
+    char sha256[2 * SHA256_SIZE + 1];
+    Checksum checksum;
+    int failed = 0;
+
+    memset(repeated, 'a', N_MILLION);
+
+    for (int portable = 0; portable < 2; portable++) {
+
+        const char* path = rc_checksum_portable(portable) ? "hardware" : "portable";
+
+        for (size_t v = 0; v < sizeof(vectors) / sizeof(Vector); v++) {
+
+            checksum_vector(vectors + v, repeated, &checksum, sha256);
+
+            if (checksum.crc32c != vectors[v].crc32c || strcmp(sha256, vectors[v].sha256) != 0) {
+
+                printf("check_checksum: %s vector %zu gives crc32c %08x, sha256 %s\n",
+                       path, v, (unsigned int)checksum.crc32c, sha256);
+                failed = 1;
+
+            }
+
+        }
+
+    }
+
+    rc_checksum_portable(false);
+
+    // one entry for the file written, with the size and checksums of its bytes
+    MediaContent* media = RC_MEDIA_INIT(0);
+    const Vector* vector = vectors + 3;
+    char line[512], expected[256];
+
+    unlink(manifest);
+    rc_curl_write_media((char*)vector->input, 1, strlen(vector->input), media);
+
+    const bool written = rc_manifest_start(manifest) && rc_media_fwrite(media, file);
+    rc_manifest_stop();
+    RC_MEDIA_FREE(media);
+
+    FILE* f = fopen(manifest, "r");
+    const bool read = f && fgets(line, sizeof(line), f);
+    const bool single = f && fgetc(f) == EOF;
+    if (f) { fclose(f); }
+
+    snprintf(expected, sizeof(expected), "{\"path\":\"%s\",\"size\":%zu,\"crc32c\":\"%08x\",\"sha256\":\"%s\",\"url\":null,",
+             file, strlen(vector->input), (unsigned int)vector->crc32c, vector->sha256);
+
+    if (!written || !read || !single || strncmp(line, expected, strlen(expected)) != 0)
+    { printf("check_checksum: manifest entry is %s", read ? line : "missing\n"); failed = 1; }
+
+    // and the file holds what the entry says
+    f = fopen(file, "rb");
+    const size_t n = f ? fread(line, 1, sizeof(line), f) : 0;
+    if (f) { fclose(f); }
+
+    if (n != strlen(vector->input) || memcmp(line, vector->input, n) != 0)
+    { printf("check_checksum: file holds %zu bytes\n", n); failed = 1; }
+
+    unlink(file);
+    unlink(manifest);
+
+    if (!failed) { printf("check_checksum: ok\n"); }
+    return failed;
+
+}
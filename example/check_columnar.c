@@ -0,0 +1,77 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "ringextract.h"
+
+/**
+ * Offline check of the columnar export: call-log ids and session ids are
+ * alphanumeric strings and must come back as written, not as numbers.
+ */
+int main(void) {
+
+    const char* page = "{\"records\":["
+        "{\"id\":\"Y3s9J2VkQ1UUJjZDQ2QUEBZA\",\"sessionId\":\"s-a1b2c3d4e5\",\"duration\":42,"
+        "\"direction\":\"Inbound\",\"from\":{\"phoneNumber\":\"+16505550100\"}},"
+        "{\"id\":\"Y3s9J2VkQ1UUJjZDQ2QUEBZB\",\"sessionId\":\"s-a1b2c3d4e6\",\"duration\":7,"
+        "\"direction\":\"Outbound\"}"
+        "],\"paging\":{\"page\":1}}";
+
+    const char* file = "check_columnar.col";
+    const char* ids[] = { "Y3s9J2VkQ1UUJjZDQ2QUEBZA", "Y3s9J2VkQ1UUJjZDQ2QUEBZB" };
+    const int64_t durations[] = { 42, 7 };
+    int failed = 0;
+
+    ColumnWriter* writer = rc_col_writer(RC_SCHEMA_CALL_LOG);
+    const size_t n_rows = rc_col_append(writer, page, strlen(page));
+    const bool written = rc_col_fwrite(writer, file) != NULL;
+    rc_col_writer_free(writer);
+
+    ColumnFile* calls = written ? rc_col_open(file) : NULL;
+
+    if (n_rows != 2 || calls == NULL || calls->n_rows != 2) {
+
+        printf("check_columnar: %zu rows appended, file %s\n", n_rows, calls ? "has wrong row count" : "not readable");
+        if (calls) { rc_col_close(calls); }
+        unlink(file);
+        return 1;
+
+    }
+
+    const int64_t* duration = rc_col_int64(calls, RC_CALL_DURATION);
+
+    for (size_t i = 0; i < 2; i++) {
+
+        const char* id = rc_col_text(calls, RC_CALL_ID, i, NULL);
+        const char* session = rc_col_text(calls, RC_CALL_SESSION_ID, i, NULL);
+
+        if (id == NULL || strcmp(id, ids[i]) != 0) { printf("check_columnar: row %zu id is %s\n", i, id ? id : "NULL"); failed = 1; }
+        if (session == NULL || strncmp(session, "s-a1b2c3d4e", 11) != 0) { printf("check_columnar: row %zu sessionId is %s\n", i, session ? session : "NULL"); failed = 1; }
+        if (duration == NULL || duration[i] != durations[i]) { printf("check_columnar: row %zu duration mismatch\n", i); failed = 1; }
+
+    }
+
+    rc_col_close(calls);
+    unlink(file);
+
+    if (!failed) { printf("check_columnar: ok\n"); }
+    return failed;
+
+}
@@ -0,0 +1,106 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ringextract.h"
+#include "stand_in.h"
+
+#define HEADERS "Content-Type: application/octet-stream\r\nConnection: close\r\n"
+#define BODY "0123456789abcdef0123456789abcdef"
+
+static void reply(const char* request, char* reply, size_t size) {
+
+    // /whole is answered in full, /cut closes 10 bytes into its body, /gone is refused
+    if (strncmp(request, "GET /whole ", 11) == 0)
+    { snprintf(reply, size, "HTTP/1.1 200 OK\r\n" HEADERS "Content-Length: %zu\r\n\r\n" BODY, strlen(BODY)); }
+    else if (strncmp(request, "GET /cut ", 9) == 0)
+    { snprintf(reply, size, "HTTP/1.1 200 OK\r\n" HEADERS "Content-Length: %zu\r\n\r\n%.10s", strlen(BODY), BODY); }
+    else { snprintf(reply, size, "HTTP/1.1 404 Not Found\r\n" HEADERS "Content-Length: 2\r\n\r\n{}"); }
+
+}
+
+/**
+ * Offline check of the file writer, on both backends: a file whose
+ * transfer fails is counted by rc_writer_flush with its transfer error,
+ * not as written, while a complete transfer is written whole.
+ */
+int main(void) {
+
+    const WriterBackend backends[] = { RC_WRITER_AUTO, RC_WRITER_THREADS };
+    const char* paths[] = { "/whole", "/cut", "/gone" };
+    const char* files[] = { "check_file_writer.whole", "check_file_writer.cut", "check_file_writer.gone" };
+    char url[64], data[64];
+    int failed = 0;
+    StandIn server;
+
+    if (!stand_in_start(&server, reply, 6)) { printf("check_file_writer: setup failed\n"); return 1; }
+
+    for (size_t b = 0; b < 2; b++) {
+
+        // small buffers, so the io_uring backend fits in a default RLIMIT_MEMLOCK
+        FileWriter* writer = rc_writer_init(4, 4096, backends[b]);
+        if (writer == NULL) { printf("check_file_writer: no writer\n"); failed = 1; break; }
+
+        const char* backend = writer->uring ? "io_uring" : "threads";
+
+        for (size_t i = 0; i < 3; i++) {
+
+            // a token that is still valid, so no token request is made; a failed transfer sticks to its token
+            BearerToken* token = RC_TOKEN_CREDENTIALS("id", "secret", "jwt");
+            token->access_token = "access";
+            token->token_type = "bearer";
+            token->expires_in = time(NULL) + 3600;
+
+            rc_writer_attach(writer, token);
+            snprintf(url, sizeof(url), "http://127.0.0.1:%u%s", server.port, paths[i]);
+            rc_media_get_file(token, files[i], url);
+
+        }
+
+        const size_t n_failed = rc_writer_flush(writer);
+
+        if (n_failed != 2 || writer->n_written != 1 || strncmp(writer->error, files[2], strlen(files[2])) != 0) {
+
+            printf("check_file_writer: %s: %zu written, %zu failed, last error %s\n",
+                   backend, writer->n_written, n_failed, writer->error);
+            failed = 1;
+
+        }
+
+        rc_writer_free(writer);
+
+        FILE* f = fopen(files[0], "rb");
+        const size_t n = f ? fread(data, 1, sizeof(data), f) : 0;
+        if (f) { fclose(f); }
+
+        if (n != strlen(BODY) || memcmp(data, BODY, n) != 0)
+        { printf("check_file_writer: %s: complete file holds %zu bytes\n", backend, n); failed = 1; }
+
+        for (size_t i = 0; i < 3; i++) { unlink(files[i]); }
+
+    }
+
+    stand_in_stop(&server);
+
+    if (!failed) { printf("check_file_writer: ok\n"); }
+    return failed;
+
+}
@@ -0,0 +1,180 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include "ringextract.h"
+#include "stand_in.h"
+
+#define HEADERS "Content-Type: application/json\r\nConnection: close\r\n"
+#define PAGE_3 "{\"records\":[{\"id\":\"r5\",\"note\":\"last\"},{\"id\":\"r6\",\"note\":\"last\"}]}"
+
+static unsigned short port;
+static int n_page_2, n_page_3, n_single, n_gone;
+static volatile sig_atomic_t n_ticks;
+
+static void reply(const char* request, char* reply, size_t size) {
+
+    const char* path = strchr(request, '/');
+    const char* end = strchr(path, ' ');
+    char body[512];
+
+    // page 2 fails with a 5xx once, page 3 and the single page are cut off once; /gone is refused
+    if (strncmp(path, "/records?page=1", end - path) == 0) {
+
+        snprintf(body, sizeof(body), "{\"records\":[{\"id\":\"r1\"},{\"id\":\"r2\"}],"
+                 "\"navigation\":{\"nextPage\":{\"uri\":\"http://127.0.0.1:%u/records?page=2\"}}}", port);
+
+    } else if (strncmp(path, "/records?page=2", end - path) == 0) {
+
+        if (n_page_2++ == 0) { snprintf(reply, size, "HTTP/1.1 500 Internal Server Error\r\n" HEADERS
+                                        "Content-Length: 30\r\n\r\n{\"records\":[{\"id\":\"r-error\"}]}"); return; }
+
+        snprintf(body, sizeof(body), "{\"records\":[{\"id\":\"r3\"},{\"id\":\"r4\"}],"
+                 "\"navigation\":{\"nextPage\":{\"uri\":\"http://127.0.0.1:%u/records?page=3\"}}}", port);
+
+    } else if (strncmp(path, "/records?page=3", end - path) == 0 || strncmp(path, "/single", end - path) == 0) {
+
+        int* n = path[1] == 's' ? &n_single : &n_page_3;
+
+        // the connection closes 20 bytes into a body that promised more
+        if ((*n)++ == 0) { snprintf(reply, size, "HTTP/1.1 200 OK\r\n" HEADERS "Content-Length: %zu\r\n\r\n%.20s",
+                                    strlen(PAGE_3), PAGE_3); return; }
+
+        snprintf(body, sizeof(body), PAGE_3);
+
+    } else {
+
+        n_gone++;
+        snprintf(reply, size, "HTTP/1.1 404 Not Found\r\n" HEADERS "Content-Length: 2\r\n\r\n{}");
+        return;
+
+    }
+
+    snprintf(reply, size, "HTTP/1.1 200 OK\r\n" HEADERS "Content-Length: %zu\r\n\r\n%s", strlen(body), body);
+
+}
+
+// cuts the retry backoff short (sleep returns on any signal), and gives up after 20 seconds
+static void tick(int signal) {
+
+    (void)signal;
+    static const char message[] = "check_page_retry: a page was requested again after it was refused\n";
+
+    if (++n_ticks < 200) { return; }
+    (void)!write(STDOUT_FILENO, message, sizeof(message) - 1);
+    _exit(1);
+
+}
+
+/**
+ * Offline check of the page-level retry: a page that fails with a 5xx and
+ * one whose transfer is cut off are each requested again, and the records
+ * come out once each and whole; a refused page (4xx) is not requested again.
+ */
+int main(void) {
+
+    const char* expected[] = { "r1", "r2", "r3", "r4", "r5", "r6" };
+    char url[64];
+    size_t n_records = 0;
+    int failed = 0;
+    StandIn server;
+
+    // a token that is still valid, so no token request is made
+    BearerToken* token = RC_TOKEN_CREDENTIALS("id", "secret", "jwt");
+    token->access_token = "access";
+    token->token_type = "bearer";
+    token->expires_in = time(NULL) + 3600;
+
+    // the stand-in keeps its accept and read calls out of the ticks
+    sigset_t ticks;
+    sigemptyset(&ticks);
+    sigaddset(&ticks, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &ticks, NULL);
+
+    // 3 pages with 2 retries, a single page with 1 retry, and one refused page
+    const bool started = stand_in_start(&server, reply, 8);
+    pthread_sigmask(SIG_UNBLOCK, &ticks, NULL);
+
+    if (!started) { printf("check_page_retry: setup failed\n"); return 1; }
+    else { port = server.port; }
+
+    struct sigaction action = { .sa_handler = tick, .sa_flags = SA_RESTART };
+    const struct itimerval interval = { .it_interval.tv_usec = 100000, .it_value.tv_usec = 100000 };
+    sigaction(SIGALRM, &action, NULL);
+    setitimer(ITIMER_REAL, &interval, NULL);
+
+    // mid-stream failures, page by page
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/records?page=1", port);
+    PageIter* iter = rc_iter_begin(token, url, 0);
+
+    for (const char* record; iter && rc_iter_next(iter); ) {
+
+        for (size_t n; (record = rc_iter_record(iter, &n)); n_records++) {
+
+            const char* id = n_records < 6 ? expected[n_records] : "";
+            char whole[64];
+
+            snprintf(whole, sizeof(whole), "{\"id\":\"%s\"", id);
+            if (n < strlen(whole) + 1 || strncmp(record, whole, strlen(whole)) != 0 || record[n - 1] != '}')
+            { printf("check_page_retry: record %zu is %.*s\n", n_records, (int)n, record); failed = 1; }
+
+        }
+
+    }
+
+    if (iter) { rc_iter_end(iter); }
+
+    if (token->s_token != RC_TOKEN_OK || n_records != 6)
+    { printf("check_page_retry: %zu records, token error %d\n", n_records, token->s_token); failed = 1; }
+
+    // a cut-off transfer leaves nothing behind in a stitched buffer
+    JsonContent* json = RC_JSON_INIT(0);
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/single", port);
+    rc_json_get_buffer(token, json, url);
+
+    if (token->s_token != RC_TOKEN_OK || json->n_bytes != strlen(PAGE_3) || memcmp(json->buffer, PAGE_3, json->n_bytes) != 0)
+    { printf("check_page_retry: single page is %.*s\n", (int)json->n_bytes, json->buffer ? json->buffer : ""); failed = 1; }
+
+    RC_JSON_FREE(json);
+
+    // a refused page fails at once
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/gone", port);
+    json = RC_JSON_INIT(0);
+    rc_json_get_buffer(token, json, url);
+    RC_JSON_FREE(json);
+
+    stand_in_stop(&server);
+    setitimer(ITIMER_REAL, &(struct itimerval){0}, NULL);
+
+    if (token->s_token != RC_CURL_TRANSFER_FAILED || n_gone != 1)
+    { printf("check_page_retry: refused page requested %d times, token error %d\n", n_gone, token->s_token); failed = 1; }
+
+    if (n_page_2 != 2 || n_page_3 != 2 || n_single != 2)
+    { printf("check_page_retry: pages requested %d, %d and %d times\n", n_page_2, n_page_3, n_single); failed = 1; }
+
+    if (!failed) { printf("check_page_retry: ok\n"); }
+    return failed;
+
+}
@@ -0,0 +1,73 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "ringextract.h"
+
+/**
+ * Offline check of the record store: two calls with distinct alphanumeric ids
+ * stay two records, and a page fetched again replaces them instead of adding.
+ */
+int main(void) {
+
+    const char* page = "{\"records\":["
+        "{\"id\":\"Y3s9J2VkQ1UUJjZDQ2QUEBZA\",\"sessionId\":\"s-a1b2c3d4e5\",\"duration\":42,\"result\":\"Accepted\"},"
+        "{\"id\":\"Y3s9J2VkQ1UUJjZDQ2QUEBZB\",\"sessionId\":\"s-a1b2c3d4e6\",\"duration\":7,\"result\":\"Missed\"}"
+        "],\"paging\":{\"page\":1}}";
+
+    const char* again = "{\"records\":["
+        "{\"id\":\"Y3s9J2VkQ1UUJjZDQ2QUEBZB\",\"sessionId\":\"s-a1b2c3d4e6\",\"duration\":9,\"result\":\"Voicemail\"}"
+        "],\"paging\":{\"page\":1}}";
+
+    int failed = 0;
+    RecordStore* store = rc_store_init(RC_SCHEMA_CALL_LOG);
+    if (store == NULL) { printf("check_record_store: no store\n"); return 1; }
+
+    rc_store_append(store, page, strlen(page));
+    rc_store_append(store, again, strlen(again));
+
+    const size_t first = rc_store_find(store, "Y3s9J2VkQ1UUJjZDQ2QUEBZA");
+    const size_t second = rc_store_find(store, "Y3s9J2VkQ1UUJjZDQ2QUEBZB");
+
+    if (store->n_records != 2) { printf("check_record_store: %zu records, expected 2\n", store->n_records); failed = 1; }
+
+    if (first == SIZE_MAX || second == SIZE_MAX || first == second) {
+
+        printf("check_record_store: ids not told apart (%zu, %zu)\n", first, second);
+        failed = 1;
+
+    } else {
+
+        const CallRecord* a = store->calls + first;
+        const CallRecord* b = store->calls + second;
+
+        if (strcmp(a->id, "Y3s9J2VkQ1UUJjZDQ2QUEBZA") != 0 || a->duration != 42) { printf("check_record_store: first call is %s\n", a->id); failed = 1; }
+        if (strcmp(b->session_id, "s-a1b2c3d4e6") != 0 || b->duration != 9) { printf("check_record_store: second call not replaced\n"); failed = 1; }
+        if (b->result != rc_store_lookup(store, "Voicemail")) { printf("check_record_store: second call result not interned\n"); failed = 1; }
+
+    }
+
+    if (rc_store_find(store, "Y3s9J2VkQ1UUJjZDQ2QUEBZC") != SIZE_MAX) { printf("check_record_store: unknown id found\n"); failed = 1; }
+
+    rc_store_free(store);
+
+    if (!failed) { printf("check_record_store: ok\n"); }
+    return failed;
+
+}
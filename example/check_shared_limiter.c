@@ -0,0 +1,120 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include "shared_limiter.h"
+#include "stand_in.h"
+
+static void reply(const char* request, char* reply, size_t size) {
+
+    // the call log reports its window; the extension list leaves it out
+    const char* window = strstr(request, "/call-log") ? "X-Rate-Limit-Window: 1\r\n" : "";
+
+    snprintf(reply, size,
+        "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 2\r\nConnection: close\r\n"
+        "X-Rate-Limit-Group: %s\r\nX-Rate-Limit-Limit: 10\r\nX-Rate-Limit-Remaining: 0\r\n%s\r\n{}",
+        *window ? "Heavy" : "Medium", window);
+
+}
+
+static size_t discard(char* data, size_t size, size_t n, void* userdata) {
+
+    (void)data; (void)userdata;
+    return size * n;
+
+}
+
+static void timed_out(int signal) {
+
+    (void)signal;
+    static const char message[] = "check_shared_limiter: rc_shared_acquire never returned\n";
+    (void)!write(STDOUT_FILENO, message, sizeof(message) - 1);
+    _exit(1);
+
+}
+
+static long elapsed_ms(const struct timespec* start) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+
+}
+
+// fetch path from the stand-in, publish the response, then take budget for three more requests
+static long fetch_and_acquire(SharedLimiter* limiter, unsigned short port, const char* path) {
+
+    char url[256];
+    struct timespec start;
+    CURL* curl = curl_easy_init();
+
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u%s", port, path);
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard);
+
+    if (curl_easy_perform(curl) != CURLE_OK) { curl_easy_cleanup(curl); return -1; }
+
+    rc_shared_update(limiter, curl, 0);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < 3; i++) { rc_shared_acquire(limiter, curl, RC_PRIORITY_BULK); }
+
+    curl_easy_cleanup(curl);
+    return elapsed_ms(&start);
+
+}
+
+/**
+ * Offline check of the shared limiter: a response without X-Rate-Limit-Window
+ * must not leave rc_shared_acquire refilling a zero-length window forever,
+ * while a response with one still holds requests back until the window ends.
+ */
+int main(void) {
+
+    const char* file = "check_shared_limiter.shm";
+    int failed = 0;
+    StandIn server;
+
+    signal(SIGALRM, timed_out);
+    unlink(file);
+
+    SharedLimiter* limiter = rc_shared_open(file);
+    if (limiter == NULL || !stand_in_start(&server, reply, 2)) { printf("check_shared_limiter: setup failed\n"); return 1; }
+
+    alarm(5);
+    const long unmetered = fetch_and_acquire(limiter, server.port, "/restapi/v1.0/account/~/extension");
+    const long metered = fetch_and_acquire(limiter, server.port, "/restapi/v1.0/account/~/extension/~/call-log");
+    alarm(0);
+
+    stand_in_stop(&server);
+    rc_shared_close(limiter);
+    unlink(file);
+
+    if (unmetered < 0 || metered < 0) { printf("check_shared_limiter: stand-in server not reached\n"); return 1; }
+    if (unmetered > 250) { printf("check_shared_limiter: no window, yet waited %ld ms\n", unmetered); failed = 1; }
+    if (metered < 500) { printf("check_shared_limiter: spent 1s window, yet waited only %ld ms\n", metered); failed = 1; }
+
+    if (!failed) { printf("check_shared_limiter: ok\n"); }
+    return failed;
+
+}
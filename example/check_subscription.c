@@ -0,0 +1,158 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include "checksum.h" // ahead of ringextract.h, for the internal rc_sha1
+#include "ringextract.h"
+#include "stand_in.h"
+
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+static unsigned short port;
+static int n_handshakes;
+
+// base64(SHA-1(key + GUID)), as a server computes it
+static void accept_value(const char* key, size_t n, char* out) {
+
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char message[128];
+    uint8_t digest[SHA1_SIZE + 1] = {0}; // padded to a multiple of 3
+
+    rc_sha1(message, (size_t)snprintf(message, sizeof(message), "%.*s" WS_GUID, (int)n, key), digest);
+
+    for (int i = 0; i < SHA1_SIZE; i += 3) {
+
+        const uint32_t v = (uint32_t)digest[i] << 16 | (uint32_t)digest[i + 1] << 8 | digest[i + 2];
+
+        *out++ = digits[v >> 18 & 63];
+        *out++ = digits[v >> 12 & 63];
+        *out++ = digits[v >> 6 & 63];
+        *out++ = i + 2 < SHA1_SIZE ? digits[v & 63] : '=';
+
+    }
+
+    *out = '\0';
+
+}
+
+// wstoken, then the handshake: answered correctly the first time, with a stale accept value the second time
+static void reply(const char* request, char* reply, size_t size) {
+
+    if (strncmp(request, "POST", 4) == 0) {
+
+        char body[128];
+        const int n = snprintf(body, sizeof(body),
+            "{\"uri\":\"ws://127.0.0.1:%u/ws\",\"ws_access_token\":\"t\",\"expires_in\":86400}", port);
+
+        snprintf(reply, size, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %d\r\n"
+                 "Connection: close\r\n\r\n%s", n, body);
+        return;
+
+    }
+
+    char accept[32] = "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=";
+    const char* key = strstr(request, "Sec-WebSocket-Key: ");
+
+    if (key && n_handshakes++ == 0) { key += 19; accept_value(key, strcspn(key, "\r\n"), accept); }
+
+    snprintf(reply, size, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+             "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+
+}
+
+static void on_event(const char* event, const char* body, size_t n, void* userdata) {
+
+    (void)event; (void)body; (void)n; (void)userdata;
+
+}
+
+static void* run(void* sub) {
+
+    rc_sub_run((Subscription*)sub, on_event, NULL);
+    return NULL;
+
+}
+
+static void timed_out(int signal) {
+
+    (void)signal;
+    static const char message[] = "check_subscription: stand-in server never got both handshakes\n";
+    (void)!write(STDOUT_FILENO, message, sizeof(message) - 1);
+    _exit(1);
+
+}
+
+/**
+ * Offline check of the WebSocket handshake: the client goes on to subscribe
+ * only when Sec-WebSocket-Accept was computed from the key it sent, and
+ * drops the connection when it was not.
+ */
+int main(void) {
+
+    const char* filters[] = { RC_EVENT_TELEPHONY_SESSIONS };
+    char url[64];
+    StandIn server;
+    pthread_t thread;
+
+    char sample[32];
+
+    // the example handshake of RFC 6455 1.3
+    accept_value("dGhlIHNhbXBsZSBub25jZQ==", 24, sample);
+    if (strcmp(sample, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") != 0) { printf("check_subscription: SHA-1 gives %s\n", sample); return 1; }
+
+    // a token that is still valid, so no token request is made
+    BearerToken* token = RC_TOKEN_CREDENTIALS("id", "secret", "jwt");
+    token->access_token = "access";
+    token->token_type = "bearer";
+    token->expires_in = time(NULL) + 3600;
+
+    // wstoken and handshake, twice
+    if (!stand_in_start(&server, reply, 4)) { printf("check_subscription: setup failed\n"); return 1; }
+
+    port = server.port;
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/restapi/oauth/wstoken", port);
+
+    Subscription* sub = rc_sub_init(token, url, filters, 1, 0);
+    if (sub == NULL || pthread_create(&thread, NULL, run, sub) != 0) { printf("check_subscription: setup failed\n"); return 1; }
+
+    signal(SIGALRM, timed_out);
+    alarm(10);
+    stand_in_stop(&server);
+    rc_sub_stop(sub);
+    pthread_join(thread, NULL);
+    alarm(0);
+
+    rc_sub_free(sub);
+
+    // the subscription request follows the good handshake only
+    if (server.n_followed != 1) {
+
+        printf("check_subscription: client went on after %zu of 2 handshakes, expected 1\n", server.n_followed);
+        return 1;
+
+    }
+
+    printf("check_subscription: ok\n");
+    return 0;
+
+}
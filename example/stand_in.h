@@ -0,0 +1,136 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_STAND_IN_H
+#define RC_STAND_IN_H
+
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#define STAND_IN_SIZE 4096
+
+/// @brief Writes the whole response (status line, headers and body) to a request
+typedef void (*StandInReply)(const char* request, char* reply, size_t size);
+
+/**
+ * Local stand-in server for the offline checks
+ *
+ * Listens on 127.0.0.1 (on a port picked by the system), answers a fixed
+ * number of requests, one connection each, with whatever reply writes,
+ * then counts the connections on which the client kept sending (e.g. the
+ * first frame after a WebSocket handshake) before closing them:
+ *
+ * StandIn server;
+ * if (!stand_in_start(&server, reply, 2)) { return 1; }
+ * ... requests to http://127.0.0.1:<server.port>/...
+ * stand_in_stop(&server);
+ */
+typedef struct StandIn {
+
+    int fd;
+    unsigned short port;
+    size_t n_requests;
+    size_t n_followed; // connections the client sent more on after the reply
+    StandInReply reply;
+    pthread_t thread;
+
+} StandIn;
+
+static void* stand_in_serve(void* arg) {
+
+    StandIn* server = arg;
+    char request[STAND_IN_SIZE], reply[STAND_IN_SIZE];
+
+    for (size_t i = 0; i < server->n_requests; i++) {
+
+        const int fd = accept(server->fd, NULL, NULL);
+        if (fd < 0) { break; }
+
+        size_t n = 0;
+        ssize_t n_read = 0;
+
+        // headers only: the checks never send a request body
+        while (n < STAND_IN_SIZE - 1 && (n_read = read(fd, request + n, STAND_IN_SIZE - 1 - n)) > 0) {
+
+            n += (size_t)n_read;
+            request[n] = '\0';
+            if (strstr(request, "\r\n\r\n")) { break; }
+
+        }
+
+        request[n] = '\0';
+        server->reply(request, reply, STAND_IN_SIZE);
+
+        for (size_t sent = 0, total = strlen(reply); sent < total; ) {
+
+            const ssize_t n_sent = write(fd, reply + sent, total - sent);
+            if (n_sent <= 0) { break; }
+            sent += (size_t)n_sent;
+
+        }
+
+        // a plain HTTP client closes (or sits idle); anything else it sends is counted
+        const struct timeval timeout = { .tv_sec = 1 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (read(fd, request, 1) > 0) { server->n_followed++; }
+
+        close(fd);
+
+    }
+
+    return NULL;
+
+}
+
+static bool stand_in_start(StandIn* server, StandInReply reply, size_t n_requests) {
+
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t length = sizeof(address);
+
+    server->fd = socket(AF_INET, SOCK_STREAM, 0);
+    server->reply = reply;
+    server->n_requests = n_requests;
+    server->n_followed = 0;
+
+    if (server->fd < 0) { return false; }
+
+    if (bind(server->fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(server->fd, 4) != 0 ||
+        getsockname(server->fd, (struct sockaddr*)&address, &length) != 0 ||
+        pthread_create(&server->thread, NULL, stand_in_serve, server) != 0)
+    { close(server->fd); return false; }
+
+    server->port = ntohs(address.sin_port);
+    return true;
+
+}
+
+/// @brief wait for the server to answer all its requests, then close it
+static void stand_in_stop(StandIn* server) {
+
+    pthread_join(server->thread, NULL);
+    close(server->fd);
+
+}
+
+#endif // RC_STAND_IN_H
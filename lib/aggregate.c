@@ -0,0 +1,531 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "aggregate.h"
+
+#define MUL(X, Y) (((X) / (Y) + 1) * (Y))
+
+#define AGG_BLOCK 1024
+#define AGG_NONE UINT32_MAX
+#define AGG_ROWS_PER_THREAD (1 << 16)
+#define AGG_INIT_GROUPS 64
+#define AGG_INIT_SLOTS 128
+
+typedef struct AggTable {
+
+    AggGroup* groups;
+    size_t n_groups;
+    size_t total_groups;
+
+    uint32_t* slots; // group + 1, 0 for an empty slot
+    size_t total_slots;
+
+    bool failed;
+
+} AggTable;
+
+typedef struct AggContext {
+
+    const AggQuery* query;
+    size_t n_rows;
+    size_t n_threads;
+
+    const int64_t* value;
+    const int64_t* time;
+    bool filter;
+    int64_t from;
+    int64_t to;
+
+    ColumnType types[AGG_MAX_KEYS];
+    const void* columns[AGG_MAX_KEYS];
+
+    uint32_t* row_group; // local group of every row, AGG_NONE if filtered out
+    AggTable* local;     // per thread
+    uint32_t** remap;    // per thread: local group -> global group
+    size_t** cursor;     // per thread: next value of each global group
+    AggResult* result;
+
+    pthread_t* threads;         // per thread, reused by every pass
+    struct AggWorker* workers;  // per thread
+    bool* started;              // per thread: whether the current pass got its thread
+
+} AggContext;
+
+typedef struct AggWorker {
+
+    AggContext* ctx;
+    size_t thread;
+
+} AggWorker;
+
+static inline uint64_t rc_agg_hash(const int64_t* keys) {
+
+    uint64_t hash = 0;
+    for (size_t k = 0; k < AGG_MAX_KEYS; k++) { hash = (hash ^ (uint64_t)keys[k]) * 0x9e3779b97f4a7c15ULL; }
+    return hash ^ (hash >> 29);
+
+}
+
+static uint32_t* rc_agg_slot(const AggTable* table, const int64_t* keys, uint64_t hash) {
+
+    const size_t mask = table->total_slots - 1;
+
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+
+        uint32_t* slot = table->slots + i;
+        if (*slot == 0 || memcmp(table->groups[*slot - 1].keys, keys, sizeof(int64_t) * AGG_MAX_KEYS) == 0) { return slot; }
+
+    }
+
+}
+
+static bool rc_agg_grow(AggTable* table) {
+
+    const size_t total = table->total_slots ? table->total_slots * 2 : AGG_INIT_SLOTS;
+    uint32_t* slots = calloc(total, sizeof(uint32_t));
+    if (slots == NULL) { return false; }
+
+    free(table->slots);
+    table->slots = slots;
+    table->total_slots = total;
+
+    for (size_t g = 0; g < table->n_groups; g++) {
+
+        const int64_t* keys = table->groups[g].keys;
+        *rc_agg_slot(table, keys, rc_agg_hash(keys)) = (uint32_t)g + 1;
+
+    }
+
+    return true;
+
+}
+
+// find or create the group of keys; NULL if out of memory
+static AggGroup* rc_agg_group(AggTable* table, const int64_t* keys, uint32_t* index) {
+
+    if (2 * (table->n_groups + 1) > table->total_slots && !rc_agg_grow(table)) { table->failed = true; return NULL; }
+
+    uint32_t* slot = rc_agg_slot(table, keys, rc_agg_hash(keys));
+    if (*slot) { *index = *slot - 1; return table->groups + *index; }
+
+    if (table->n_groups == table->total_groups) {
+
+        const size_t total = MUL(table->n_groups + 1, AGG_INIT_GROUPS);
+        AggGroup* groups = realloc(table->groups, total * sizeof(AggGroup));
+
+        if (groups == NULL) { table->failed = true; return NULL; }
+
+        table->groups = groups;
+        table->total_groups = total;
+
+    }
+
+    AggGroup* group = table->groups + table->n_groups;
+    memcpy(group->keys, keys, sizeof(group->keys));
+    group->count = 0;
+    group->sum = 0;
+    group->min = INT64_MAX;
+    group->max = INT64_MIN;
+
+    *index = (uint32_t)table->n_groups;
+    *slot = (uint32_t)++table->n_groups;
+    return group;
+
+}
+
+static inline int64_t rc_agg_bucket(int64_t time, int64_t bucket) {
+
+    const int64_t floor = time / bucket * bucket;
+    return floor > time ? floor - bucket : floor;
+
+}
+
+// filter, gather and group kernels over rows [begin, begin + n)
+static void rc_agg_block(AggContext* ctx, AggTable* table, size_t begin, size_t n) {
+
+    uint32_t sel[AGG_BLOCK];
+    int64_t keys[AGG_MAX_KEYS][AGG_BLOCK];
+    size_t n_sel = 0;
+
+    const AggQuery* query = ctx->query;
+    uint32_t* row_group = ctx->row_group + begin;
+    const int64_t* value = ctx->value + begin;
+
+    if (ctx->filter) {
+
+        const int64_t* time = ctx->time + begin;
+
+        for (size_t i = 0; i < n; i++) {
+
+            sel[n_sel] = (uint32_t)i;
+            n_sel += (time[i] >= ctx->from) & (time[i] < ctx->to);
+
+        }
+
+    } else {
+
+        for (size_t i = 0; i < n; i++) { sel[i] = (uint32_t)i; }
+        n_sel = n;
+
+    }
+
+    memset(row_group, 0xff, n * sizeof(uint32_t));
+
+    for (size_t k = 0; k < query->n_keys; k++) {
+
+        int64_t* key = keys[k];
+
+        if (ctx->types[k] == RC_COL_ENUM) {
+
+            const uint8_t* codes = (const uint8_t*)ctx->columns[k] + begin;
+            for (size_t j = 0; j < n_sel; j++) { key[j] = codes[sel[j]]; }
+
+        } else if (ctx->types[k] == RC_COL_TIME && query->bucket > 0) {
+
+            const int64_t* times = (const int64_t*)ctx->columns[k] + begin;
+            for (size_t j = 0; j < n_sel; j++) { key[j] = rc_agg_bucket(times[sel[j]], query->bucket); }
+
+        } else {
+
+            const int64_t* values = (const int64_t*)ctx->columns[k] + begin;
+            for (size_t j = 0; j < n_sel; j++) { key[j] = values[sel[j]]; }
+
+        }
+
+    }
+
+    for (size_t j = 0; j < n_sel; j++) {
+
+        uint32_t index;
+        int64_t key[AGG_MAX_KEYS] = {0};
+        for (size_t k = 0; k < query->n_keys; k++) { key[k] = keys[k][j]; }
+
+        AggGroup* group = rc_agg_group(table, key, &index);
+        if (group == NULL) { return; }
+
+        const int64_t v = value[sel[j]];
+        group->count++;
+        group->sum += v;
+        group->min = v < group->min ? v : group->min;
+        group->max = v > group->max ? v : group->max;
+        row_group[sel[j]] = index;
+
+    }
+
+}
+
+static inline void rc_agg_chunk(const AggContext* ctx, size_t thread, size_t* begin, size_t* end) {
+
+    *begin = ctx->n_rows * thread / ctx->n_threads;
+    *end = ctx->n_rows * (thread + 1) / ctx->n_threads;
+
+}
+
+static void* rc_agg_group_rows(void* userdata) {
+
+    AggWorker* worker = (AggWorker*)userdata;
+    AggContext* ctx = worker->ctx;
+    AggTable* table = ctx->local + worker->thread;
+    size_t begin, end;
+
+    rc_agg_chunk(ctx, worker->thread, &begin, &end);
+
+    for (size_t i = begin; i < end && !table->failed; i += AGG_BLOCK)
+    { rc_agg_block(ctx, table, i, end - i < AGG_BLOCK ? end - i : AGG_BLOCK); }
+
+    return NULL;
+
+}
+
+static void* rc_agg_scatter(void* userdata) {
+
+    AggWorker* worker = (AggWorker*)userdata;
+    AggContext* ctx = worker->ctx;
+    const uint32_t* remap = ctx->remap[worker->thread];
+    size_t* cursor = ctx->cursor[worker->thread];
+    int64_t* values = ctx->result->values;
+    size_t begin, end;
+
+    rc_agg_chunk(ctx, worker->thread, &begin, &end);
+
+    for (size_t i = begin; i < end; i++) {
+
+        const uint32_t local = ctx->row_group[i];
+        if (local != AGG_NONE) { values[cursor[remap[local]]++] = ctx->value[i]; }
+
+    }
+
+    return NULL;
+
+}
+
+static int rc_agg_compare_values(const void* a, const void* b) {
+
+    const int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+
+}
+
+static int rc_agg_compare_groups(const void* a, const void* b) {
+
+    const int64_t* x = ((const AggGroup*)a)->keys;
+    const int64_t* y = ((const AggGroup*)b)->keys;
+
+    for (size_t k = 0; k < AGG_MAX_KEYS; k++) { if (x[k] != y[k]) { return x[k] < y[k] ? -1 : 1; } }
+    return 0;
+
+}
+
+static void* rc_agg_sort(void* userdata) {
+
+    AggWorker* worker = (AggWorker*)userdata;
+    const AggContext* ctx = worker->ctx;
+    const AggResult* result = ctx->result;
+
+    for (size_t g = worker->thread; g < result->n_groups; g += ctx->n_threads)
+    { qsort(result->values + result->offsets[g], result->groups[g].count, sizeof(int64_t), rc_agg_compare_values); }
+
+    return NULL;
+
+}
+
+// run a pass on every thread; passes that cannot get a thread run on the calling thread
+static void rc_agg_parallel(AggContext* ctx, void* (*pass)(void*)) {
+
+    pthread_t* threads = ctx->threads;
+    AggWorker* workers = ctx->workers;
+    bool* started = ctx->started;
+
+    for (size_t t = 1; t < ctx->n_threads; t++) {
+
+        workers[t] = (AggWorker){ .ctx = ctx, .thread = t };
+        started[t] = pthread_create(threads + t, NULL, pass, workers + t) == 0;
+
+    }
+
+    workers[0] = (AggWorker){ .ctx = ctx, .thread = 0 };
+    pass(workers);
+
+    for (size_t t = 1; t < ctx->n_threads; t++) {
+
+        if (started[t]) { pthread_join(threads[t], NULL); }
+        else { pass(workers + t); }
+
+    }
+
+}
+
+// merge the per-thread groups, sort them by keys, and lay out their values
+static bool rc_agg_merge(AggContext* ctx, AggResult* result) {
+
+    AggTable global = {0};
+    uint32_t index;
+    bool ok = true;
+
+    for (size_t t = 0; t < ctx->n_threads && ok; t++) {
+
+        const AggTable* local = ctx->local + t;
+        ok = !local->failed && (ctx->remap[t] = malloc((local->n_groups + 1) * sizeof(uint32_t))) != NULL;
+
+        for (size_t l = 0; l < local->n_groups && ok; l++) {
+
+            const AggGroup* part = local->groups + l;
+            AggGroup* group = rc_agg_group(&global, part->keys, &index);
+            if (group == NULL) { ok = false; break; }
+
+            group->count += part->count;
+            group->sum += part->sum;
+            group->min = part->min < group->min ? part->min : group->min;
+            group->max = part->max > group->max ? part->max : group->max;
+            ctx->remap[t][l] = index;
+
+        }
+
+    }
+
+    free(global.slots);
+    result->n_groups = global.n_groups;
+
+    const size_t n_groups = global.n_groups;
+    AggGroup* sorted = malloc((n_groups + 1) * sizeof(AggGroup));
+    uint32_t* rank = malloc((n_groups + 1) * sizeof(uint32_t));
+    result->offsets = malloc((n_groups + 1) * sizeof(size_t));
+
+    if (!ok || sorted == NULL || rank == NULL || result->offsets == NULL)
+    { free(global.groups); free(sorted); free(rank); return false; }
+
+    // sort by keys, tracking where each group went through its sum (restored below)
+    for (size_t g = 0; g < n_groups; g++) { sorted[g] = global.groups[g]; sorted[g].sum = (int64_t)g; }
+    qsort(sorted, n_groups, sizeof(AggGroup), rc_agg_compare_groups);
+
+    for (size_t g = 0; g < n_groups; g++) {
+
+        rank[sorted[g].sum] = (uint32_t)g;
+        sorted[g].sum = global.groups[sorted[g].sum].sum;
+
+    }
+
+    free(global.groups);
+    result->groups = sorted;
+    result->offsets[0] = 0;
+
+    for (size_t g = 0; g < n_groups; g++) { result->offsets[g + 1] = result->offsets[g] + sorted[g].count; }
+    result->n_rows = result->offsets[n_groups];
+
+    // each thread scatters its rows of a group right after those of the threads before it
+    for (size_t t = 0; t < ctx->n_threads && ok; t++) {
+
+        const AggTable* local = ctx->local + t;
+        for (size_t l = 0; l < local->n_groups; l++) { ctx->remap[t][l] = rank[ctx->remap[t][l]]; }
+
+    }
+
+    size_t* next = malloc((n_groups + 1) * sizeof(size_t));
+    if (next) { memcpy(next, result->offsets, (n_groups + 1) * sizeof(size_t)); }
+
+    for (size_t t = 0; t < ctx->n_threads && next && ok; t++) {
+
+        const AggTable* local = ctx->local + t;
+        ok = (ctx->cursor[t] = malloc((n_groups + 1) * sizeof(size_t))) != NULL;
+
+        for (size_t l = 0; l < local->n_groups && ok; l++) {
+
+            const uint32_t g = ctx->remap[t][l];
+            ctx->cursor[t][g] = next[g];
+            next[g] += local->groups[l].count;
+
+        }
+
+    }
+
+    ok = ok && next;
+    free(rank);
+    free(next);
+    return ok;
+
+}
+
+AggResult* rc_agg_run(const ColumnFile* cf, const AggQuery* query) {
+
+    const bool filter = query->from || query->to;
+    if (query->n_keys > AGG_MAX_KEYS || query->value >= cf->n_columns) { return NULL; }
+    if (filter && query->time >= cf->n_columns) { return NULL; }
+
+    AggContext ctx = {
+
+        .query = query,
+        .n_rows = cf->n_rows,
+        .value = rc_col_int64(cf, query->value),
+        .time = filter ? rc_col_int64(cf, query->time) : NULL,
+        .filter = filter,
+        .from = query->from ? query->from : INT64_MIN,
+        .to = query->to ? query->to : INT64_MAX
+
+    };
+
+    if (ctx.value == NULL || (filter && ctx.time == NULL)) { return NULL; }
+
+    for (size_t k = 0; k < query->n_keys; k++) {
+
+        if (query->keys[k] >= cf->n_columns) { return NULL; }
+
+        ctx.types[k] = rc_col_type(cf, query->keys[k]);
+        ctx.columns[k] = ctx.types[k] == RC_COL_ENUM ? (const void*)rc_col_codes(cf, query->keys[k])
+                                                     : (const void*)rc_col_int64(cf, query->keys[k]);
+
+        if (ctx.columns[k] == NULL) { return NULL; }
+
+    }
+
+    // small inputs are not worth the threads
+    const size_t n_threads = query->n_threads > 0 ? query->n_threads : AGG_THREADS;
+    const size_t n_chunks = (ctx.n_rows + AGG_ROWS_PER_THREAD - 1) / AGG_ROWS_PER_THREAD;
+    ctx.n_threads = n_chunks < 1 ? 1 : n_chunks < n_threads ? n_chunks : n_threads;
+
+    AggResult* result = calloc(1, sizeof(AggResult));
+    ctx.result = result;
+    ctx.row_group = malloc((ctx.n_rows + 1) * sizeof(uint32_t));
+    ctx.local = calloc(ctx.n_threads, sizeof(AggTable));
+    ctx.remap = calloc(ctx.n_threads, sizeof(uint32_t*));
+    ctx.cursor = calloc(ctx.n_threads, sizeof(size_t*));
+    ctx.threads = calloc(ctx.n_threads, sizeof(pthread_t));
+    ctx.workers = calloc(ctx.n_threads, sizeof(AggWorker));
+    ctx.started = calloc(ctx.n_threads, sizeof(bool));
+
+    bool ok = result && ctx.row_group && ctx.local && ctx.remap && ctx.cursor;
+    ok = ok && ctx.threads && ctx.workers && ctx.started;
+
+    if (ok) { rc_agg_parallel(&ctx, rc_agg_group_rows); }
+    ok = ok && rc_agg_merge(&ctx, result);
+    ok = ok && (result->values = malloc((result->n_rows + 1) * sizeof(int64_t)));
+
+    if (ok) {
+
+        rc_agg_parallel(&ctx, rc_agg_scatter);
+        rc_agg_parallel(&ctx, rc_agg_sort);
+
+    }
+
+    for (size_t t = 0; ctx.local && t < ctx.n_threads; t++) {
+
+        free(ctx.local[t].groups);
+        free(ctx.local[t].slots);
+        if (ctx.remap) { free(ctx.remap[t]); }
+        if (ctx.cursor) { free(ctx.cursor[t]); }
+
+    }
+
+    free(ctx.row_group);
+    free(ctx.local);
+    free(ctx.remap);
+    free(ctx.cursor);
+    free(ctx.threads);
+    free(ctx.workers);
+    free(ctx.started);
+
+    if (!ok && result) { rc_agg_free(result); return NULL; }
+    return result;
+
+}
+
+int64_t rc_agg_percentile(const AggResult* result, size_t group, double q) {
+
+    if (group >= result->n_groups || result->groups[group].count == 0) { return 0; }
+
+    const size_t count = result->groups[group].count;
+    const double rank = q * count; // 1-based nearest rank is ceil(rank)
+    const size_t whole = rank > 0 ? (size_t)rank : 0;
+    const size_t ceiling = whole + ((double)whole < rank);
+    const size_t i = ceiling == 0 ? 0 : ceiling > count ? count - 1 : ceiling - 1;
+
+    return result->values[result->offsets[group] + i];
+
+}
+
+void rc_agg_free(AggResult* result) {
+
+    free(result->groups);
+    free(result->values);
+    free(result->offsets);
+    free(result);
+
+}
@@ -0,0 +1,114 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_AGGREGATE_H
+#define RC_AGGREGATE_H
+
+#include "columnar.h"
+
+#define AGG_THREADS 4
+#define AGG_MAX_KEYS 4
+
+#define AGG_MINUTE 60000LL
+#define AGG_HOUR 3600000LL
+#define AGG_DAY 86400000LL
+
+/// @brief Group-by aggregation of one column, see rc_agg_run
+typedef struct AggQuery {
+
+    size_t keys[AGG_MAX_KEYS]; // group-by columns (RC_COL_ENUM, RC_COL_INT64 or RC_COL_TIME)
+    size_t n_keys;             // 0 to aggregate all rows into a single group
+    int64_t bucket;            // width of RC_COL_TIME keys in ms (e.g. AGG_HOUR); 0 for exact values
+
+    size_t value;              // aggregated column (RC_COL_INT64 or RC_COL_TIME)
+
+    size_t time;               // column filtered by [from, to) (RC_COL_INT64 or RC_COL_TIME)
+    int64_t from;              // 0 for no lower bound
+    int64_t to;                // 0 for no upper bound
+
+    size_t n_threads;          // 0 for default of 4
+
+} AggQuery;
+
+/// @brief One group of an AggResult
+typedef struct AggGroup {
+
+    int64_t keys[AGG_MAX_KEYS]; // enum code, integer value or bucket start (ms), per key column
+    size_t count;
+    int64_t sum;
+    int64_t min;
+    int64_t max;
+
+} AggGroup;
+
+/**
+ * Aggregation over extracted call-log (or extension) columns
+ *
+ * Answers "calls and talk time by extension, by hour, by result" directly
+ * on a ColumnFile, without exporting the data elsewhere:
+ *
+ * ColumnFile* calls = rc_col_open("calls.col");
+ * AggQuery query = {
+ *     .keys = { RC_CALL_EXTENSION_ID, RC_CALL_START_TIME, RC_CALL_RESULT }, .n_keys = 3,
+ *     .bucket = AGG_HOUR, .value = RC_CALL_DURATION,
+ *     .time = RC_CALL_START_TIME, .from = since, .to = until
+ * };
+ * AggResult* result = rc_agg_run(calls, &query);
+ * for (size_t g = 0; g < result->n_groups; g++) {
+ *     const AggGroup* group = result->groups + g;
+ *     printf("%lld %lld %s: %zu calls, %lld s, p90 %lld s\n",
+ *            group->keys[0], group->keys[1], rc_col_label(calls, RC_CALL_RESULT, group->keys[2]),
+ *            group->count, group->sum, rc_agg_percentile(result, g, 0.9));
+ * }
+ * rc_agg_free(result);
+ *
+ * Columns are processed a block of rows at a time by tight loops over the
+ * mapped arrays (filter into a selection vector, gather keys, update
+ * groups); large inputs are split across threads, each grouping its own
+ * rows before the partial groups are merged. Groups come out sorted by keys.
+ */
+typedef struct AggResult {
+
+    AggGroup* groups;
+    size_t n_groups;
+    size_t n_rows;    // rows that passed the filter
+
+    int64_t* values;  // aggregated values, sorted within each group
+    size_t* offsets;  // values of group g are [offsets[g], offsets[g + 1])
+
+} AggResult;
+
+/// @brief Run a group-by aggregation over a column file
+/// @param cf pointer to an open ColumnFile
+/// @param query pointer to an AggQuery
+/// @return a pointer to the result; NULL if a column does not exist or has
+///         an unsupported type, or if out of memory
+AggResult* rc_agg_run(const ColumnFile* cf, const AggQuery* query);
+
+/// @brief Percentile of the aggregated values of a group (nearest rank)
+/// @param result pointer to an AggResult
+/// @param group index into result->groups
+/// @param q quantile between 0 and 1, e.g. 0.5 for the median
+/// @return the percentile; 0 if the group does not exist
+int64_t rc_agg_percentile(const AggResult* result, size_t group, double q);
+
+/// @brief Free an aggregation result
+/// @param result pointer to an AggResult
+void rc_agg_free(AggResult* result);
+
+#endif // RC_AGGREGATE_H
@@ -18,13 +18,18 @@
 
 #include <string.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #include "bearer_token.h"
 #include "rate_limiter.h"
+#include "tracer.h"
 
 #define MAX(X, Y) (X > Y ? X : Y)
 #define MIN(X, Y) (X < Y ? X : Y)
 
+// serializes access token refreshes shared through rc_token_fork
+static pthread_mutex_t rc_token_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /** Official response structure (application/json)
  * 
  *  {
@@ -105,30 +110,30 @@ static inline TokenError rc_token_validate(BearerToken* token) {
 
 }
 
-static TokenError rc_token_request(BearerToken* token) {
+TokenError rc_token_prepare(BearerToken* token, CURL* curl) {
 
-    CURL* curl = curl_easy_init();
+    token->expires_in = time(NULL);
 
-    if (curl) {
+    curl_easy_setopt(curl, CURLOPT_URL       , token->server_url);
+    curl_easy_setopt(curl, CURLOPT_USERNAME  , token->client_id);
+    curl_easy_setopt(curl, CURLOPT_PASSWORD  , token->client_secret);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, token->jwt);
 
-        curl_easy_setopt(curl, CURLOPT_URL       , token->server_url);
-        curl_easy_setopt(curl, CURLOPT_USERNAME  , token->client_id);
-        curl_easy_setopt(curl, CURLOPT_PASSWORD  , token->client_secret);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, token->jwt);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, rc_token_save);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, token);
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, token->error);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1);
 
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, rc_token_save);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, token);
-        curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, token->error);
-        curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1);
+    return token->s_token;
 
-        rc_curl_set_limit(token, curl, 0, 0);
-        curl_easy_cleanup(curl);
+}
 
-    } else { token->s_token = RC_CURL_INIT_FAILED; }
+TokenError rc_token_parse(BearerToken* token) {
+
+    const size_t avail_size = token->client_id - token->buffer;
 
     if (token->s_token == RC_TOKEN_OK) {
 
-        const size_t avail_size = token->client_id - token->buffer;
         size_t bytes = avail_size - token->avail_size;
         char* rest = token->buffer;
 
@@ -139,7 +144,25 @@ static TokenError rc_token_request(BearerToken* token) {
         token->avail_size = avail_size;
         return rc_token_validate(token);
 
-    } else { return token->s_token; }
+    } else { token->avail_size = avail_size; return token->s_token; }
+
+}
+
+static TokenError rc_token_request(BearerToken* token) {
+
+    const uint64_t start = rc_trace_clock();
+    CURL* curl = curl_easy_init();
+
+    if (curl) {
+
+        rc_token_prepare(token, curl);
+        rc_curl_set_limit(token, curl, 0, 0);
+        curl_easy_cleanup(curl);
+
+    } else { token->s_token = RC_CURL_INIT_FAILED; }
+
+    rc_trace_span(RC_TRACE_TOKEN, start, token->s_token);
+    return rc_token_parse(token);
 
 }
 
@@ -186,7 +209,7 @@ static TokenError rc_token_materialize(BearerToken* token) {
 
 }
 
-static TokenError rc_curl_set_error(BearerToken* token) {
+TokenError rc_curl_set_error(BearerToken* token) {
 
     const char* message = NULL;
 
@@ -231,18 +254,58 @@ static TokenError rc_curl_set_error(BearerToken* token) {
 
 }
 
+TokenError rc_token_fork(BearerToken* token, BearerToken* origin) {
+
+#define REBASE(X) token->X = origin->X ? token->buffer + (origin->X - origin->buffer) : NULL
+
+    pthread_mutex_lock(&rc_token_lock);
+
+    if (rc_token_materialize(origin) == RC_TOKEN_OK) {
+
+        const time_t now = time(NULL);
+
+        if (origin->expires_in < now) { rc_token_request(origin); }
+
+    }
+
+    memcpy(token, origin, sizeof(BearerToken));
+    pthread_mutex_unlock(&rc_token_lock);
+
+    if (token->s_token == RC_TOKEN_OK) {
+
+        REBASE(client_id);
+        REBASE(client_secret);
+        REBASE(jwt);
+        REBASE(access_token);
+        REBASE(token_type);
+
+    }
+
+    token->origin = origin;
+    return rc_curl_set_error(token);
+
+#undef REBASE
+
+}
+
+bool rc_token_expired(BearerToken* token) {
+
+    if (rc_token_materialize(token) != RC_TOKEN_OK) { return false; }
+    else { return token->expires_in < time(NULL); }
+
+}
+
 TokenError rc_curl_set_token(BearerToken* token, CURL* curl) {
 
     if (rc_token_materialize(token) != RC_TOKEN_OK) { return token->s_token; }
 
     const time_t now = time(NULL);
 
-    if (token->expires_in < now) {
+    if (token->expires_in < now && token->origin) {
 
-        token->expires_in = now;
-        rc_token_request(token);
+        rc_token_fork(token, token->origin);
 
-    }
+    } else if (token->expires_in < now) { rc_token_request(token); }
 
     if (token->s_token == RC_TOKEN_OK) {
 
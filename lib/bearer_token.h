@@ -21,6 +21,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <curl/curl.h>
 
 #define TOKEN_MAX_SIZE 2048
@@ -38,24 +39,33 @@ typedef enum {
 
 } TokenError;
 
+typedef enum {
+
+    RC_PRIORITY_BULK,       // default: extraction, may be held back for interactive requests
+    RC_PRIORITY_INTERACTIVE // single lookups that someone is waiting for
+
+} RequestPriority;
+
 /**
  * Not using opaque typedef here, specifically so that
- * RC_TOKEN_SKELETON can initialize the struct inline
+ * RC_TOKEN_CREDENTIALS can initialize the struct inline
  * without function call / copy on return
  */
 
 /**
  * Container struct that facilitates JWT flow
- * The only public interface is the RC_TOKEN_SKELETON macro
+ * The only public interfaces are the RC_TOKEN_SKELETON and
+ * RC_TOKEN_CREDENTIALS macros
  * 
  * -- Declaration & Initialization --
  * RIGHT: BearerToken* token = RC_TOKEN_SKELETON();
+ * RIGHT: BearerToken* token = RC_TOKEN_CREDENTIALS(id, secret, jwt);
  * WRONG: BearerToken* token; // this will cause a crash later.
  * 
  * Do not assume/directly modify its member variables or buffer
  * Do not malloc or free
  */
-typedef struct {
+typedef struct BearerToken {
 
     const char* server_url;
 
@@ -71,21 +81,39 @@ typedef struct {
 
     TokenError s_token;
     char error[CURL_ERROR_SIZE];
+    long status; // HTTP status of the last response, from whichever hedged request answered (0 if none)
+
+    struct BearerToken* origin;
+    struct HttpPool* pool;
+    struct SharedLimiter* limiter;
+    RequestPriority priority;
+    struct FileWriter* writer;
+    struct SingleFlight* flight;
+    struct Hedger* hedger;
 
 } BearerToken;
 
 /// @brief Create a BearerToken skeleton on the stack
 /// @return a pointer to the created skeleton
-#define RC_TOKEN_SKELETON() &(BearerToken) \
-{                                          \
-    .buffer = {0},                         \
-    .server_url = RC_OAUTH_TOKEN,          \
-    .client_id = RC_CLIENT_ID,             \
-    .client_secret = RC_CLIENT_SECRET,     \
-    .jwt = RC_JWT,                         \
-    .expires_in = 0,                       \
-    .avail_size = TOKEN_MAX_SIZE,          \
-    .s_token = RC_TOKEN_UNINITIALIZED      \
+#define RC_TOKEN_SKELETON() RC_TOKEN_CREDENTIALS(RC_CLIENT_ID, RC_CLIENT_SECRET, RC_JWT)
+
+/// @brief Create a BearerToken skeleton with explicit credentials on the stack
+/// @param ID client id
+/// @param SECRET client secret
+/// @param JWT JSON Web Token
+/// @return a pointer to the created skeleton
+/// @note For extracting from several accounts at once; strings are copied
+///       into the token when it is first used
+#define RC_TOKEN_CREDENTIALS(ID, SECRET, JWT) &(BearerToken) \
+{                                                         \
+    .buffer = {0},                                        \
+    .server_url = RC_OAUTH_TOKEN,                         \
+    .client_id = ID,                                      \
+    .client_secret = SECRET,                              \
+    .jwt = JWT,                                           \
+    .expires_in = 0,                                      \
+    .avail_size = TOKEN_MAX_SIZE,                         \
+    .s_token = RC_TOKEN_UNINITIALIZED                     \
 }
 
 #ifndef RINGEXTRACT_H // internal functions used within RingEXtract
@@ -102,6 +130,39 @@ TokenError rc_curl_set_token(BearerToken* token, CURL* curl);
 /// @return TokenError code
 TokenError rc_curl_auto_perform(BearerToken* token, CURL* curl);
 
+/// @brief copy a token for use by another thread, sharing origin's access token
+/// @param token pointer to an uninitialized BearerToken to be written
+/// @param origin pointer to a BearerToken (can be just a skeleton)
+/// @return TokenError code (also stored in token)
+/// @note The copy refreshes through origin when the access token expires,
+///       so concurrent copies request a single new access token between them.
+///       origin must outlive its copies and must not be used directly while
+///       any copy is in use by another thread.
+TokenError rc_token_fork(BearerToken* token, BearerToken* origin);
+
+/// @brief check whether a token needs a new access token, without requesting one
+/// @param token pointer to a BearerToken struct (can be just a skeleton)
+/// @return true if the access token has expired (or was never requested);
+///         false if it is still valid or the token is in an error state
+bool rc_token_expired(BearerToken* token);
+
+/// @brief set up a CURL handle to request a new access token
+/// @param token pointer to a materialized BearerToken struct
+/// @param curl a CURL handle
+/// @return TokenError code
+/// @note Once the transfer completes, pass the token to rc_token_parse
+TokenError rc_token_prepare(BearerToken* token, CURL* curl);
+
+/// @brief parse the access token response written by a transfer set up with rc_token_prepare
+/// @param token pointer to a BearerToken struct
+/// @return TokenError code
+TokenError rc_token_parse(BearerToken* token);
+
+/// @brief write the message matching the token's TokenError code to its error buffer
+/// @param token pointer to a BearerToken struct
+/// @return TokenError code
+TokenError rc_curl_set_error(BearerToken* token);
+
 #endif // RINGEXTRACT_H
 
 #endif // RC_BEARER_TOKEN_H
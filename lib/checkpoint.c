@@ -0,0 +1,217 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "checkpoint.h"
+#include "json_content.h"
+#include "tracer.h"
+
+#define CKPT_MAGIC "RCCKPT 1"
+#define CKPT_PATH_SIZE 4096
+#define CKPT_URL_SIZE 4096
+#define CKPT_TAIL_SIZE 256
+
+typedef struct {
+
+    size_t n_pages;
+    size_t offset;
+    char url[CKPT_URL_SIZE];
+    char tail[CKPT_TAIL_SIZE]; // separator held back from the file, see rc_json_spill
+
+} Checkpoint;
+
+static bool rc_ckpt_line(FILE* f, char* line, size_t n) {
+
+    if (fgets(line, n, f) == NULL) { return false; }
+
+    const size_t length = strlen(line);
+    if (length == 0 || line[length - 1] != '\n') { return false; }
+
+    line[length - 1] = '\0';
+    return true;
+
+}
+
+// read a checkpoint of the same url; false if there is none
+static bool rc_ckpt_load(const char* path, const char* url, Checkpoint* ckpt) {
+
+    char line[CKPT_URL_SIZE];
+    FILE* f = fopen(path, "r");
+    if (f == NULL) { return false; }
+
+    bool ok = rc_ckpt_line(f, line, CKPT_URL_SIZE) && strcmp(line, CKPT_MAGIC) == 0
+           && rc_ckpt_line(f, line, CKPT_URL_SIZE) && strcmp(line, url) == 0
+           && rc_ckpt_line(f, line, CKPT_URL_SIZE)
+           && sscanf(line, "%zu %zu", &ckpt->n_pages, &ckpt->offset) == 2
+           && rc_ckpt_line(f, ckpt->url, CKPT_URL_SIZE)
+           && rc_ckpt_line(f, ckpt->tail, CKPT_TAIL_SIZE);
+
+    fclose(f);
+    return ok;
+
+}
+
+static void rc_ckpt_sync_dir(const char* path) {
+
+    char dir[CKPT_PATH_SIZE];
+    const char* slash = strrchr(path, '/');
+
+    if (slash == NULL) { snprintf(dir, CKPT_PATH_SIZE, "."); }
+    else { snprintf(dir, CKPT_PATH_SIZE, "%.*s", (int)(slash - path + 1), path); }
+
+    const int fd = open(dir, O_RDONLY);
+    if (fd >= 0) { fsync(fd); close(fd); }
+
+}
+
+// write the checkpoint to a temporary file, then atomically replace the previous one
+static bool rc_ckpt_save(const char* path, const char* url, const Checkpoint* ckpt) {
+
+    char temp[CKPT_PATH_SIZE + 4];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+
+    FILE* f = fopen(temp, "w");
+    if (f == NULL) { return false; }
+
+    fprintf(f, "%s\n%s\n%zu %zu\n%s\n%s\n", CKPT_MAGIC, url, ckpt->n_pages, ckpt->offset, ckpt->url, ckpt->tail);
+
+    bool ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    ok = ok && rename(temp, path) == 0;
+
+    if (ok) { rc_ckpt_sync_dir(path); }
+    else { remove(temp); }
+
+    return ok;
+
+}
+
+// append completed pages to the file, holding back the trailing separator
+// that rc_json_bridge may still rewrite if the next page is empty
+static bool rc_ckpt_flush(JsonContent* json, FILE* f, Checkpoint* ckpt, bool last) {
+
+    size_t n = json->n_bytes;
+
+    if (!last) {
+
+        while (n > 0 && (json->buffer[n - 1] == ',' || json->buffer[n - 1] == ' ')) { n--; }
+        if (json->n_bytes - n >= CKPT_TAIL_SIZE) { return false; }
+
+    }
+
+    if (n && fwrite(json->buffer, 1, n, f) != n) { return false; }
+    if (fflush(f) != 0 || fsync(fileno(f)) != 0) { return false; }
+
+    ckpt->offset += n;
+    memcpy(ckpt->tail, json->buffer + n, json->n_bytes - n);
+    ckpt->tail[json->n_bytes - n] = '\0';
+    return true;
+
+}
+
+const char* rc_json_get_resumable(BearerToken* token, const char* file, const char* url) {
+
+    char path[CKPT_PATH_SIZE];
+    Checkpoint ckpt = { .n_pages = 0, .offset = 0 };
+    JsonContent* json = RC_JSON_INIT(0);
+    FILE* f = NULL;
+
+    if (strlen(url) >= CKPT_URL_SIZE) { return NULL; }
+    snprintf(path, CKPT_PATH_SIZE, "%s.ckpt", file);
+
+    CURL* curl = curl_easy_init();
+    if (curl == NULL) { token->s_token = RC_CURL_INIT_FAILED; return NULL; }
+
+    if (rc_ckpt_load(path, url, &ckpt) && (f = fopen(file, "r+b"))) {
+
+        // drop anything written after the last checkpoint
+        if (ftruncate(fileno(f), (off_t)ckpt.offset) != 0 || fseek(f, 0, SEEK_END) != 0) { fclose(f); f = NULL; }
+
+    }
+
+    if (f) {
+
+        const size_t n = strlen(ckpt.tail);
+
+        json->buffer = malloc(json->init_size);
+        json->total_size = json->init_size;
+
+        if (json->buffer == NULL) { fclose(f); curl_easy_cleanup(curl); return NULL; }
+        else { memcpy(json->buffer, ckpt.tail, n); }
+
+        json->n_bytes = n;
+        json->n_pages = ckpt.n_pages;
+        curl_easy_setopt(curl, CURLOPT_URL, ckpt.url);
+
+    } else {
+
+        memset(&ckpt, 0, sizeof(Checkpoint));
+        f = fopen(file, "wb");
+        curl_easy_setopt(curl, CURLOPT_URL, url);
+
+    }
+
+    if (f == NULL) { curl_easy_cleanup(curl); RC_JSON_FREE(json); return NULL; }
+
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, rc_curl_write_json);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, json);
+
+    bool ok = true;
+
+    do {
+
+        const uint64_t start = rc_trace_clock();
+        const size_t page = json->n_pages;
+
+        if (rc_curl_auto_perform(token, curl) == RC_TOKEN_OK) { rc_curl_next_page(json); }
+        else { rc_trace_span(RC_TRACE_PAGE, start, page); ok = false; break; }
+
+        rc_trace_span(RC_TRACE_PAGE, start, page);
+
+        const bool last = json->url_next_page == NULL;
+        ok = rc_ckpt_flush(json, f, &ckpt, last);
+
+        if (ok && !last) {
+
+            ckpt.n_pages = json->n_pages;
+            snprintf(ckpt.url, CKPT_URL_SIZE, "%s", json->url_next_page);
+            ok = rc_ckpt_save(path, url, &ckpt);
+
+            curl_easy_setopt(curl, CURLOPT_URL, json->url_next_page);
+            json->n_bytes = strlen(ckpt.tail);
+            memcpy(json->buffer, ckpt.tail, json->n_bytes);
+
+        }
+
+    } while (ok && json->url_next_page);
+
+    fclose(f);
+    curl_easy_cleanup(curl);
+    RC_JSON_FREE(json);
+
+    if (ok) { remove(path); return file; }
+    else { return NULL; }
+
+}
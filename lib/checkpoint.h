@@ -0,0 +1,48 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_CHECKPOINT_H
+#define RC_CHECKPOINT_H
+
+#include "bearer_token.h"
+
+/**
+ * Crash-safe page loop
+ *
+ * rc_json_get_resumable runs the same page loop as rc_json_get_buffer, but
+ * appends each completed page to the output file instead of keeping the
+ * response in memory. After every page, the file is synced and a small
+ * checkpoint file (the output file name + ".ckpt") is atomically replaced
+ * with the url of the next page and the number of bytes written so far.
+ *
+ * If the process dies mid-loop, calling rc_json_get_resumable again with the
+ * same file and url truncates the output back to the last checkpoint and
+ * continues from the next page, so no page is fetched or written twice.
+ * Once the loop completes, the checkpoint file is removed; the output is
+ * identical to rc_json_get_buffer followed by rc_json_fwrite.
+ */
+
+/// @brief Store a paginated JSON response to file, resuming an interrupted run
+/// @param token pointer to a BearerToken (can be just a skeleton)
+/// @param file full path & file name to be written
+/// @param url full url
+/// @return if the page loop completed, the file name (same as the file argument);
+///         otherwise, NULL (and the checkpoint is kept for the next call)
+const char* rc_json_get_resumable(BearerToken* token, const char* file, const char* url);
+
+#endif // RC_CHECKPOINT_H
@@ -0,0 +1,352 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "checksum.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define CHECKSUM_X86 1
+#endif
+
+static const uint32_t rc_sha256_k[64] = {
+
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+
+};
+
+static uint32_t rc_crc32c_table[256];
+static bool rc_crc32c_hw = false;
+static bool rc_sha256_hw = false;
+static pthread_once_t rc_checksum_once = PTHREAD_ONCE_INIT;
+
+static void rc_checksum_detect(void) {
+
+#ifdef CHECKSUM_X86
+    __builtin_cpu_init();
+    rc_crc32c_hw = __builtin_cpu_supports("sse4.2");
+    rc_sha256_hw = __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+#endif
+
+}
+
+static void rc_checksum_setup(void) {
+
+    for (uint32_t i = 0; i < 256; i++) {
+
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) { crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1; }
+        rc_crc32c_table[i] = crc;
+
+    }
+
+    rc_checksum_detect();
+
+}
+
+static uint32_t rc_crc32c_sw(uint32_t crc, const uint8_t* data, size_t n) {
+
+    for (size_t i = 0; i < n; i++) { crc = rc_crc32c_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8); }
+    return crc;
+
+}
+
+#define ROR(X, N) (((X) >> (N)) | ((X) << (32 - (N))))
+
+static void rc_sha256_sw(uint32_t state[8], const uint8_t* data, size_t n_blocks) {
+
+    for (; n_blocks; n_blocks--, data += 64) {
+
+        uint32_t w[64];
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int i = 0; i < 16; i++)
+        { w[i] = (uint32_t)data[4 * i] << 24 | (uint32_t)data[4 * i + 1] << 16 | (uint32_t)data[4 * i + 2] << 8 | data[4 * i + 3]; }
+
+        for (int i = 16; i < 64; i++) {
+
+            const uint32_t s0 = ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+
+        }
+
+        for (int i = 0; i < 64; i++) {
+
+            const uint32_t t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + rc_sha256_k[i] + w[i];
+            const uint32_t t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+
+    }
+
+}
+
+static void rc_sha1_block(uint32_t state[5], const uint8_t* data) {
+
+    uint32_t w[80];
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+    for (int i = 0; i < 16; i++)
+    { w[i] = (uint32_t)data[4 * i] << 24 | (uint32_t)data[4 * i + 1] << 16 | (uint32_t)data[4 * i + 2] << 8 | data[4 * i + 3]; }
+
+    for (int i = 16; i < 80; i++) { w[i] = ROR(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 31); }
+
+    for (int i = 0; i < 80; i++) {
+
+        const uint32_t f = i < 20 ? ((b & c) | (~b & d)) + 0x5a827999
+                         : i < 40 ? (b ^ c ^ d) + 0x6ed9eba1
+                         : i < 60 ? ((b & c) | (b & d) | (c & d)) + 0x8f1bbcdc
+                         : (b ^ c ^ d) + 0xca62c1d6;
+        const uint32_t t = ROR(a, 27) + f + e + w[i];
+
+        e = d; d = c; c = ROR(b, 2); b = a; a = t;
+
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d; state[4] += e;
+
+}
+
+#undef ROR
+
+#ifdef CHECKSUM_X86
+
+__attribute__((target("sse4.2")))
+static uint32_t rc_crc32c_x86(uint32_t crc, const uint8_t* data, size_t n) {
+
+    uint64_t crc64 = crc;
+
+    for (; n >= 8; n -= 8, data += 8) {
+
+        uint64_t word;
+        memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+
+    }
+
+    crc = (uint32_t)crc64;
+    for (; n; n--, data++) { crc = _mm_crc32_u8(crc, *data); }
+    return crc;
+
+}
+
+// four rounds per step; state is kept as ABEF / CDGH as the SHA extensions expect
+__attribute__((target("sha,sse4.1")))
+static void rc_sha256_x86(uint32_t state[8], const uint8_t* data, size_t n_blocks) {
+
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0xb1);  // CDAB
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(state + 4)), 0x1b); // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);     // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);          // CDGH
+
+    for (; n_blocks; n_blocks--, data += 64) {
+
+        const __m128i abef = state0, cdgh = state1;
+        __m128i w[4];
+
+        for (int i = 0; i < 16; i++) {
+
+            __m128i x;
+
+            if (i < 4) { x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16 * i)), mask); }
+            else {
+
+                x = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+                x = _mm_add_epi32(x, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                x = _mm_sha256msg2_epu32(x, w[(i + 3) & 3]);
+
+            }
+
+            w[i & 3] = x;
+
+            const __m128i message = _mm_add_epi32(x, _mm_loadu_si128((const __m128i*)(rc_sha256_k + 4 * i)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0e));
+
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);                // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xb1);             // DCHG
+    _mm_storeu_si128((__m128i*)state, _mm_blend_epi16(tmp, state1, 0xf0));         // DCBA
+    _mm_storeu_si128((__m128i*)(state + 4), _mm_alignr_epi8(state1, tmp, 8));      // HGFE
+
+}
+
+#endif // CHECKSUM_X86
+
+static inline uint32_t rc_crc32c(uint32_t crc, const uint8_t* data, size_t n) {
+
+#ifdef CHECKSUM_X86
+    if (rc_crc32c_hw) { return rc_crc32c_x86(crc, data, n); }
+#endif
+    return rc_crc32c_sw(crc, data, n);
+
+}
+
+static inline void rc_sha256(uint32_t state[8], const uint8_t* data, size_t n_blocks) {
+
+#ifdef CHECKSUM_X86
+    if (rc_sha256_hw) { rc_sha256_x86(state, data, n_blocks); return; }
+#endif
+    rc_sha256_sw(state, data, n_blocks);
+
+}
+
+bool rc_checksum_portable(bool portable) {
+
+    pthread_once(&rc_checksum_once, rc_checksum_setup);
+
+    if (portable) { rc_crc32c_hw = rc_sha256_hw = false; }
+    else { rc_checksum_detect(); }
+
+    return rc_crc32c_hw || rc_sha256_hw;
+
+}
+
+void rc_checksum_init(Checksum* checksum) {
+
+    static const uint32_t init[8] = {
+
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+
+    };
+
+    pthread_once(&rc_checksum_once, rc_checksum_setup);
+
+    checksum->crc32c = 0xffffffff;
+    memcpy(checksum->state, init, sizeof(init));
+    checksum->n_block = 0;
+    checksum->n_bytes = 0;
+
+}
+
+void rc_checksum_update(Checksum* checksum, const void* data, size_t n) {
+
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    checksum->crc32c = rc_crc32c(checksum->crc32c, bytes, n);
+    checksum->n_bytes += n;
+
+    // top up a partial block first, then hash whole blocks in place
+    if (checksum->n_block) {
+
+        const size_t n_copy = 64 - checksum->n_block < n ? 64 - checksum->n_block : n;
+        memcpy(checksum->block + checksum->n_block, bytes, n_copy);
+
+        checksum->n_block += n_copy;
+        bytes += n_copy;
+        n -= n_copy;
+
+        if (checksum->n_block < 64) { return; }
+
+        rc_sha256(checksum->state, checksum->block, 1);
+        checksum->n_block = 0;
+
+    }
+
+    rc_sha256(checksum->state, bytes, n / 64);
+    memcpy(checksum->block, bytes + n / 64 * 64, n % 64);
+    checksum->n_block = n % 64;
+
+}
+
+void rc_checksum_final(Checksum* checksum, uint8_t digest[SHA256_SIZE]) {
+
+    const uint64_t n_bits = checksum->n_bytes * 8;
+    uint8_t* block = checksum->block;
+
+    block[checksum->n_block++] = 0x80;
+
+    if (checksum->n_block > 56) {
+
+        memset(block + checksum->n_block, 0, 64 - checksum->n_block);
+        rc_sha256(checksum->state, block, 1);
+        checksum->n_block = 0;
+
+    }
+
+    memset(block + checksum->n_block, 0, 56 - checksum->n_block);
+    for (int i = 0; i < 8; i++) { block[56 + i] = (uint8_t)(n_bits >> (56 - 8 * i)); }
+    rc_sha256(checksum->state, block, 1);
+
+    for (int i = 0; i < 8; i++) {
+
+        digest[4 * i] = (uint8_t)(checksum->state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(checksum->state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(checksum->state[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)checksum->state[i];
+
+    }
+
+    checksum->crc32c ^= 0xffffffff;
+
+}
+
+void rc_sha1(const void* data, size_t n, uint8_t digest[SHA1_SIZE]) {
+
+    uint32_t state[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+    const uint8_t* bytes = (const uint8_t*)data;
+    const uint64_t n_bits = (uint64_t)n * 8;
+    uint8_t block[64];
+
+    for (; n >= 64; n -= 64, bytes += 64) { rc_sha1_block(state, bytes); }
+
+    // same padding as SHA-256: 0x80, zeros, then the message length in bits
+    memcpy(block, bytes, n);
+    block[n++] = 0x80;
+
+    if (n > 56) { memset(block + n, 0, 64 - n); rc_sha1_block(state, block); n = 0; }
+
+    memset(block + n, 0, 56 - n);
+    for (int i = 0; i < 8; i++) { block[56 + i] = (uint8_t)(n_bits >> (56 - 8 * i)); }
+    rc_sha1_block(state, block);
+
+    for (int i = 0; i < 5; i++) {
+
+        digest[4 * i] = (uint8_t)(state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(state[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)state[i];
+
+    }
+
+}
@@ -0,0 +1,78 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_CHECKSUM_H
+#define RC_CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SHA256_SIZE 32
+#define SHA1_SIZE 20
+
+/**
+ * Incremental CRC32C and SHA-256 over a byte stream
+ *
+ * Both are updated in a single pass as bytes are written, using the CPU's
+ * CRC32 (SSE4.2) and SHA extensions when available, and portable code
+ * otherwise. SHA-1, which the WebSocket handshake requires, is only needed
+ * over a few dozen bytes, so it is one-shot and portable only.
+ */
+typedef struct Checksum {
+
+    uint32_t crc32c;
+    uint32_t state[8];
+    uint8_t block[64];
+    size_t n_block;
+    uint64_t n_bytes;
+
+} Checksum;
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief reset a checksum to the empty stream
+/// @param checksum pointer to a Checksum
+void rc_checksum_init(Checksum* checksum);
+
+/// @brief add bytes to the stream
+/// @param checksum pointer to a Checksum
+/// @param data bytes to add
+/// @param n number of bytes
+void rc_checksum_update(Checksum* checksum, const void* data, size_t n);
+
+/// @brief finish the SHA-256 of the stream (the checksum must not be updated afterwards)
+/// @param checksum pointer to a Checksum
+/// @param digest destination for the 32 byte digest
+void rc_checksum_final(Checksum* checksum, uint8_t digest[SHA256_SIZE]);
+
+/// @brief switch between the portable code and the CPU extensions (e.g. to compare the two)
+/// @param portable true to use the portable code only; false to use the extensions where available
+/// @return true if any of the extensions is now in use
+/// @note Must not be called while other threads are computing checksums
+bool rc_checksum_portable(bool portable);
+
+/// @brief SHA-1 of a short message (e.g. the Sec-WebSocket-Accept of a handshake)
+/// @param data bytes to hash
+/// @param n number of bytes
+/// @param digest destination for the 20 byte digest
+void rc_sha1(const void* data, size_t n, uint8_t digest[SHA1_SIZE]);
+
+#endif // RINGEXTRACT_H
+
+#endif // RC_CHECKSUM_H
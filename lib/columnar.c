@@ -0,0 +1,513 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "columnar.h"
+#include "json_scan.h"
+
+#define MUL(X, Y) (((X) / (Y) + 1) * (Y))
+#define ALIGN(X) (((X) + 7) & ~(size_t)7)
+
+#define COL_MAGIC "RCCOL1\0\0"
+#define COL_INIT_SIZE (1 << 16)
+#define COL_LABEL_SIZE 128
+
+typedef struct {
+
+    const char* path;
+    ColumnType type;
+
+} ColumnDef;
+
+static const ColumnDef rc_col_call_log[RC_CALL_N_COLUMNS] = {
+
+    [RC_CALL_ID]           = { "id",                RC_COL_TEXT  },
+    [RC_CALL_SESSION_ID]   = { "sessionId",         RC_COL_TEXT  },
+    [RC_CALL_START_TIME]   = { "startTime",         RC_COL_TIME  },
+    [RC_CALL_DURATION]     = { "duration",          RC_COL_INT64 },
+    [RC_CALL_TYPE]         = { "type",              RC_COL_ENUM  },
+    [RC_CALL_DIRECTION]    = { "direction",         RC_COL_ENUM  },
+    [RC_CALL_ACTION]       = { "action",            RC_COL_ENUM  },
+    [RC_CALL_RESULT]       = { "result",            RC_COL_ENUM  },
+    [RC_CALL_EXTENSION_ID] = { "extension.id",      RC_COL_INT64 },
+    [RC_CALL_FROM_NUMBER]  = { "from.phoneNumber",  RC_COL_TEXT  },
+    [RC_CALL_FROM_NAME]    = { "from.name",         RC_COL_TEXT  },
+    [RC_CALL_TO_NUMBER]    = { "to.phoneNumber",    RC_COL_TEXT  },
+    [RC_CALL_TO_NAME]      = { "to.name",           RC_COL_TEXT  }
+
+};
+
+static const ColumnDef rc_col_extension[RC_EXT_N_COLUMNS] = {
+
+    [RC_EXT_ID]            = { "id",                RC_COL_INT64 },
+    [RC_EXT_NUMBER]        = { "extensionNumber",   RC_COL_TEXT  },
+    [RC_EXT_NAME]          = { "name",              RC_COL_TEXT  },
+    [RC_EXT_TYPE]          = { "type",              RC_COL_ENUM  },
+    [RC_EXT_STATUS]        = { "status",            RC_COL_ENUM  },
+    [RC_EXT_EMAIL]         = { "contact.email",     RC_COL_TEXT  },
+    [RC_EXT_SITE_ID]       = { "site.id",           RC_COL_INT64 }
+
+};
+
+typedef struct ColumnBuffer {
+
+    ColumnType type;
+
+    uint8_t* data; // values, codes or string offsets
+    size_t n_bytes;
+    size_t total_size;
+
+    char* heap; // dictionary labels or strings
+    size_t n_heap;
+    size_t heap_size;
+
+    size_t labels[COL_MAX_LABELS + 1]; // heap offset of each label, by code
+    size_t n_labels;
+
+} ColumnBuffer;
+
+typedef struct ColumnEntry {
+
+    uint32_t type;
+    uint32_t n_labels;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t heap_offset;
+    uint64_t heap_size;
+
+} ColumnEntry;
+
+typedef struct {
+
+    char magic[8];
+    uint32_t schema;
+    uint32_t n_columns;
+    uint64_t n_rows;
+
+} ColumnHeader;
+
+static inline const ColumnDef* rc_col_schema(ColumnSchema schema, size_t* n_columns) {
+
+    switch (schema) {
+
+    case RC_SCHEMA_CALL_LOG:
+        *n_columns = RC_CALL_N_COLUMNS;
+        return rc_col_call_log;
+
+    case RC_SCHEMA_EXTENSION:
+        *n_columns = RC_EXT_N_COLUMNS;
+        return rc_col_extension;
+
+    default:
+        *n_columns = 0;
+        return NULL;
+
+    }
+
+}
+
+static bool rc_col_reserve(void** buffer, size_t* total_size, size_t size) {
+
+    if (size <= *total_size) { return true; }
+
+    const size_t new_size = MUL(size, COL_INIT_SIZE);
+    void* data = realloc(*buffer, new_size);
+
+    if (data) { *buffer = data; *total_size = new_size; return true; }
+    else { return false; }
+
+}
+
+static bool rc_col_data(ColumnBuffer* column, const void* value, size_t n) {
+
+    if (!rc_col_reserve((void**)&column->data, &column->total_size, column->n_bytes + n)) { return false; }
+
+    memcpy(column->data + column->n_bytes, value, n);
+    column->n_bytes += n;
+    return true;
+
+}
+
+static bool rc_col_heap(ColumnBuffer* column, const char* value, size_t n, bool decode) {
+
+    if (!rc_col_reserve((void**)&column->heap, &column->heap_size, column->n_heap + n + 1)) { return false; }
+
+    char* dest = column->heap + column->n_heap;
+    const size_t length = decode ? rc_scan_string(value, n, dest) : (memcpy(dest, value, n), n);
+
+    dest[length] = '\0';
+    column->n_heap += length + 1;
+    return true;
+
+}
+
+// intern a label into the column dictionary; 0 if absent or the dictionary is full
+static uint8_t rc_col_code(ColumnBuffer* column, const char* value, size_t n) {
+
+    char label[COL_LABEL_SIZE];
+
+    if (value == NULL || n < 2 || *value != '"' || n > COL_LABEL_SIZE) { return 0; }
+
+    const size_t length = rc_scan_string(value, n, label);
+    label[length] = '\0';
+
+    for (size_t code = 1; code <= column->n_labels; code++)
+    { if (strcmp(column->heap + column->labels[code], label) == 0) { return (uint8_t)code; } }
+
+    if (column->n_labels == COL_MAX_LABELS) { return 0; }
+
+    const size_t offset = column->n_heap;
+    if (!rc_col_heap(column, label, length, false)) { return 0; }
+
+    column->labels[++column->n_labels] = offset;
+    return (uint8_t)column->n_labels;
+
+}
+
+static bool rc_col_push(ColumnBuffer* column, const char* value, size_t n) {
+
+    switch (column->type) {
+
+    case RC_COL_INT64: {
+
+        const int64_t number = value ? rc_scan_int(value, n) : 0;
+        return rc_col_data(column, &number, sizeof(int64_t));
+
+    }
+
+    case RC_COL_TIME: {
+
+        const int64_t time = value ? rc_scan_time(value, n) : 0;
+        return rc_col_data(column, &time, sizeof(int64_t));
+
+    }
+
+    case RC_COL_ENUM: {
+
+        const uint8_t code = rc_col_code(column, value, n);
+        return rc_col_data(column, &code, sizeof(uint8_t));
+
+    }
+
+    case RC_COL_TEXT: {
+
+        const bool string = value && n >= 2 && *value == '"';
+        const bool literal = value && !string && !(n == 4 && memcmp(value, "null", 4) == 0);
+
+        if (!rc_col_heap(column, value, string || literal ? n : 0, string)) { return false; }
+
+        const uint64_t end = column->n_heap;
+        return rc_col_data(column, &end, sizeof(uint64_t));
+
+    }
+
+    default:
+        return false;
+
+    }
+
+}
+
+ColumnWriter* rc_col_writer(ColumnSchema schema) {
+
+    size_t n_columns = 0;
+    const ColumnDef* defs = rc_col_schema(schema, &n_columns);
+    if (defs == NULL) { return NULL; }
+
+    ColumnWriter* writer = calloc(1, sizeof(ColumnWriter));
+    if (writer == NULL) { return NULL; }
+
+    writer->schema = schema;
+    writer->n_columns = n_columns;
+    writer->columns = calloc(n_columns, sizeof(ColumnBuffer));
+
+    if (writer->columns == NULL) { free(writer); return NULL; }
+
+    for (size_t i = 0; i < n_columns; i++) {
+
+        ColumnBuffer* column = writer->columns + i;
+        const uint64_t start = 0;
+        column->type = defs[i].type;
+
+        // code 0 is the empty label; row 0 of a text column starts at offset 0
+        if (column->type == RC_COL_ENUM) { writer->failed |= !rc_col_heap(column, "", 0, false); }
+        if (column->type == RC_COL_TEXT) { writer->failed |= !rc_col_data(column, &start, sizeof(uint64_t)); }
+
+    }
+
+    return writer;
+
+}
+
+size_t rc_col_append(ColumnWriter* writer, const char* json, size_t n) {
+
+    JsonScan scan;
+    size_t n_rows = 0;
+    size_t n_columns = 0;
+    const ColumnDef* defs = rc_col_schema(writer->schema, &n_columns);
+
+    if (writer->failed || !rc_scan_records(&scan, json, n)) { return 0; }
+
+    for (const char* record; (record = rc_scan_next(&scan, &n)); ) {
+
+        if (*record != '{') { continue; }
+
+        for (size_t i = 0; i < n_columns; i++) {
+
+            size_t length = 0;
+            const char* value = rc_scan_path(record, n, defs[i].path, &length);
+
+            // a partial row would misalign every column after it
+            if (!rc_col_push(writer->columns + i, value, length)) { writer->failed = true; return n_rows; }
+
+        }
+
+        writer->n_rows++;
+        n_rows++;
+
+    }
+
+    return n_rows;
+
+}
+
+static bool rc_col_section(FILE* f, const void* data, size_t n, size_t* offset) {
+
+    static const uint8_t padding[8] = {0};
+    const size_t aligned = ALIGN(n);
+
+    if (n && fwrite(data, 1, n, f) != n) { return false; }
+    if (aligned > n && fwrite(padding, 1, aligned - n, f) != aligned - n) { return false; }
+
+    *offset += aligned;
+    return true;
+
+}
+
+const char* rc_col_fwrite(ColumnWriter* writer, const char* file) {
+
+    if (writer->failed) { return NULL; }
+
+    const size_t n_columns = writer->n_columns;
+    ColumnEntry directory[n_columns];
+    ColumnHeader header = { .schema = writer->schema, .n_columns = n_columns, .n_rows = writer->n_rows };
+
+    memcpy(header.magic, COL_MAGIC, sizeof(header.magic));
+    size_t offset = ALIGN(sizeof(ColumnHeader) + sizeof(directory));
+
+    for (size_t i = 0; i < n_columns; i++) {
+
+        const ColumnBuffer* column = writer->columns + i;
+        directory[i] = (ColumnEntry){ .type = column->type, .n_labels = column->n_labels,
+                                      .offset = offset, .size = column->n_bytes };
+        offset += ALIGN(column->n_bytes);
+
+    }
+
+    for (size_t i = 0; i < n_columns; i++) {
+
+        directory[i].heap_offset = offset;
+        directory[i].heap_size = writer->columns[i].n_heap;
+        offset += ALIGN(writer->columns[i].n_heap);
+
+    }
+
+    FILE* f = fopen(file, "wb");
+    if (f == NULL) { return NULL; }
+
+    size_t written = 0;
+    bool ok = rc_col_section(f, &header, sizeof(header), &written)
+           && rc_col_section(f, directory, sizeof(directory), &written);
+
+    for (size_t i = 0; i < n_columns && ok; i++)
+    { ok = rc_col_section(f, writer->columns[i].data, writer->columns[i].n_bytes, &written); }
+
+    for (size_t i = 0; i < n_columns && ok; i++)
+    { ok = rc_col_section(f, writer->columns[i].heap, writer->columns[i].n_heap, &written); }
+
+    ok = fclose(f) == 0 && ok;
+    return ok ? file : NULL;
+
+}
+
+void rc_col_writer_free(ColumnWriter* writer) {
+
+    for (size_t i = 0; i < writer->n_columns; i++) {
+
+        free(writer->columns[i].data);
+        free(writer->columns[i].heap);
+
+    }
+
+    free(writer->columns);
+    free(writer);
+
+}
+
+static bool rc_col_valid(const ColumnFile* cf, const ColumnEntry* entry) {
+
+    const size_t n_rows = cf->n_rows;
+    size_t expected = 0;
+
+    if (entry->offset > cf->size || entry->size > cf->size - entry->offset) { return false; }
+    if (entry->heap_offset > cf->size || entry->heap_size > cf->size - entry->heap_offset) { return false; }
+    if (entry->offset % 8 != 0) { return false; }
+
+    switch (entry->type) {
+
+    case RC_COL_INT64:
+    case RC_COL_TIME:
+        expected = n_rows * sizeof(int64_t);
+        break;
+
+    case RC_COL_ENUM:
+        expected = n_rows;
+        if (entry->n_labels > COL_MAX_LABELS || entry->heap_size == 0) { return false; }
+        break;
+
+    case RC_COL_TEXT:
+        expected = (n_rows + 1) * sizeof(uint64_t);
+        break;
+
+    default:
+        return false;
+
+    }
+
+    if (entry->heap_size && cf->base[entry->heap_offset + entry->heap_size - 1] != '\0') { return false; }
+    return entry->size == expected;
+
+}
+
+ColumnFile* rc_col_open(const char* file) {
+
+    struct stat st;
+    const int fd = open(file, O_RDONLY);
+    if (fd < 0) { return NULL; }
+
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ColumnHeader)) { close(fd); return NULL; }
+
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) { return NULL; }
+
+    ColumnFile* cf = calloc(1, sizeof(ColumnFile));
+    const ColumnHeader* header = (const ColumnHeader*)base;
+
+    if (cf) {
+
+        cf->base = base;
+        cf->size = st.st_size;
+        cf->schema = header->schema;
+        cf->n_columns = header->n_columns;
+        cf->n_rows = header->n_rows;
+        cf->directory = (const ColumnEntry*)(cf->base + sizeof(ColumnHeader));
+
+        bool ok = memcmp(header->magic, COL_MAGIC, sizeof(header->magic)) == 0
+               && cf->n_columns <= (cf->size - sizeof(ColumnHeader)) / sizeof(ColumnEntry)
+               && cf->n_rows <= cf->size;
+
+        for (size_t i = 0; i < cf->n_columns && ok; i++) { ok = rc_col_valid(cf, cf->directory + i); }
+        if (ok) { return cf; }
+
+    }
+
+    munmap(base, st.st_size);
+    free(cf);
+    return NULL;
+
+}
+
+ColumnType rc_col_type(const ColumnFile* cf, size_t column) {
+
+    return column < cf->n_columns ? (ColumnType)cf->directory[column].type : RC_COL_INT64;
+
+}
+
+const int64_t* rc_col_int64(const ColumnFile* cf, size_t column) {
+
+    if (column >= cf->n_columns) { return NULL; }
+
+    const ColumnEntry* entry = cf->directory + column;
+    if (entry->type != RC_COL_INT64 && entry->type != RC_COL_TIME) { return NULL; }
+
+    return (const int64_t*)(cf->base + entry->offset);
+
+}
+
+const uint8_t* rc_col_codes(const ColumnFile* cf, size_t column) {
+
+    if (column >= cf->n_columns || cf->directory[column].type != RC_COL_ENUM) { return NULL; }
+    else { return cf->base + cf->directory[column].offset; }
+
+}
+
+size_t rc_col_n_labels(const ColumnFile* cf, size_t column) {
+
+    if (column >= cf->n_columns || cf->directory[column].type != RC_COL_ENUM) { return 0; }
+    else { return cf->directory[column].n_labels; }
+
+}
+
+const char* rc_col_label(const ColumnFile* cf, size_t column, uint8_t code) {
+
+    if (code > rc_col_n_labels(cf, column)) { return NULL; }
+
+    const ColumnEntry* entry = cf->directory + column;
+    const char* label = (const char*)cf->base + entry->heap_offset;
+    const char* end = label + entry->heap_size;
+
+    for (; code && label < end; code--) { label += strlen(label) + 1; }
+    return label < end ? label : NULL;
+
+}
+
+const char* rc_col_text(const ColumnFile* cf, size_t column, size_t row, size_t* length) {
+
+    if (column >= cf->n_columns || row >= cf->n_rows) { return NULL; }
+
+    const ColumnEntry* entry = cf->directory + column;
+    if (entry->type != RC_COL_TEXT) { return NULL; }
+
+    const uint64_t* offsets = (const uint64_t*)(cf->base + entry->offset);
+    const uint64_t begin = offsets[row];
+    const uint64_t end = offsets[row + 1];
+
+    if (begin >= end || end > entry->heap_size) { return NULL; }
+    if (length) { *length = end - begin - 1; }
+
+    return (const char*)cf->base + entry->heap_offset + begin;
+
+}
+
+void rc_col_close(ColumnFile* cf) {
+
+    munmap((void*)cf->base, cf->size);
+    free(cf);
+
+}
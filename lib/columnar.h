@@ -0,0 +1,204 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_COLUMNAR_H
+#define RC_COLUMNAR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define COL_MAX_LABELS 255
+
+/**
+ * Columnar binary export of call-log and extension records
+ *
+ * A ColumnWriter converts the records of list responses into typed columns
+ * as they are fetched; rc_col_fwrite then writes them to a single file:
+ *
+ * - RC_COL_INT64: int64_t per row (numeric ids, durations)
+ * - RC_COL_TIME:  int64_t per row, milliseconds since the Unix epoch (UTC)
+ * - RC_COL_ENUM:  uint8_t code per row into a dictionary of up to 255
+ *                 labels (direction, result, type, ...); 0 is "absent"
+ * - RC_COL_TEXT:  uint64_t offset per row (plus one) into a string heap;
+ *                 strings are unescaped UTF-8, each followed by a '\0'
+ *                 (names, numbers, and call-log ids, which are alphanumeric)
+ *
+ * A ColumnFile maps such a file into memory: columns are read in place,
+ * as arrays, without parsing or copying.
+ *
+ * -- File layout (native byte order, all sections 8-byte aligned) --
+ * "RCCOL1\0\0" | uint32 schema | uint32 n_columns | uint64 n_rows
+ * n_columns x { uint32 type | uint32 n_labels | uint64 offset | uint64 size
+ *               | uint64 heap_offset | uint64 heap_size }
+ * column sections, then heap sections (dictionary labels / strings)
+ *
+ * -- Writing during extraction --
+ * ColumnWriter* writer = rc_col_writer(RC_SCHEMA_CALL_LOG);
+ * rc_json_pipeline(token, RC_GET_CALL_LOG, 0, consumer, writer);
+ *     // consumer: rc_col_append(writer, page->buffer, page->n_bytes);
+ * rc_col_fwrite(writer, "calls.col");
+ * rc_col_writer_free(writer);
+ *
+ * -- Reading --
+ * ColumnFile* calls = rc_col_open("calls.col");
+ * const int64_t* duration = rc_col_int64(calls, RC_CALL_DURATION);
+ * for (size_t i = 0; i < calls->n_rows; i++) { total += duration[i]; }
+ * rc_col_close(calls);
+ */
+
+typedef enum { RC_SCHEMA_CALL_LOG, RC_SCHEMA_EXTENSION } ColumnSchema;
+
+typedef enum { RC_COL_INT64, RC_COL_TIME, RC_COL_ENUM, RC_COL_TEXT } ColumnType;
+
+typedef enum {
+
+    RC_CALL_ID,            // id (text)
+    RC_CALL_SESSION_ID,    // sessionId (text)
+    RC_CALL_START_TIME,    // startTime
+    RC_CALL_DURATION,      // duration (seconds)
+    RC_CALL_TYPE,          // type
+    RC_CALL_DIRECTION,     // direction
+    RC_CALL_ACTION,        // action
+    RC_CALL_RESULT,        // result
+    RC_CALL_EXTENSION_ID,  // extension.id
+    RC_CALL_FROM_NUMBER,   // from.phoneNumber
+    RC_CALL_FROM_NAME,     // from.name
+    RC_CALL_TO_NUMBER,     // to.phoneNumber
+    RC_CALL_TO_NAME,       // to.name
+    RC_CALL_N_COLUMNS
+
+} CallLogColumn;
+
+typedef enum {
+
+    RC_EXT_ID,             // id
+    RC_EXT_NUMBER,         // extensionNumber
+    RC_EXT_NAME,           // name
+    RC_EXT_TYPE,           // type
+    RC_EXT_STATUS,         // status
+    RC_EXT_EMAIL,          // contact.email
+    RC_EXT_SITE_ID,        // site.id
+    RC_EXT_N_COLUMNS
+
+} ExtensionColumn;
+
+/**
+ * Builds the columns of one file in memory
+ * Created by rc_col_writer, freed by rc_col_writer_free
+ */
+typedef struct {
+
+    ColumnSchema schema;
+    size_t n_columns;
+    size_t n_rows;
+
+    struct ColumnBuffer* columns;
+    bool failed; // out of memory; rc_col_fwrite will fail
+
+} ColumnWriter;
+
+/**
+ * A columnar file mapped into memory
+ * Opened by rc_col_open, closed by rc_col_close
+ */
+typedef struct {
+
+    const uint8_t* base;
+    size_t size;
+
+    ColumnSchema schema;
+    size_t n_columns;
+    size_t n_rows;
+
+    const struct ColumnEntry* directory;
+
+} ColumnFile;
+
+/// @brief Create a writer for a record schema
+/// @param schema RC_SCHEMA_CALL_LOG or RC_SCHEMA_EXTENSION
+/// @return a pointer to the writer; NULL if out of memory
+ColumnWriter* rc_col_writer(ColumnSchema schema);
+
+/// @brief Convert the records of a list response (one page or a whole page loop)
+/// @param writer pointer to a ColumnWriter
+/// @param json response text, e.g. the buffer of a JsonContent
+/// @param n number of bytes in json
+/// @return number of records appended
+size_t rc_col_append(ColumnWriter* writer, const char* json, size_t n);
+
+/// @brief Write all appended records to a columnar file
+/// @param writer pointer to a ColumnWriter
+/// @param file full path & file name to be written
+/// @return if written successfully, the file name (same as the file argument);
+///         otherwise, NULL
+const char* rc_col_fwrite(ColumnWriter* writer, const char* file);
+
+/// @brief Free a ColumnWriter
+/// @param writer pointer to a ColumnWriter
+void rc_col_writer_free(ColumnWriter* writer);
+
+/// @brief Map a columnar file into memory
+/// @param file full path & file name
+/// @return a pointer to the mapped file; NULL if it is missing or malformed
+ColumnFile* rc_col_open(const char* file);
+
+/// @brief Type of a column
+/// @param cf pointer to a ColumnFile
+/// @param column column index, e.g. RC_CALL_DURATION
+/// @return type of the column
+ColumnType rc_col_type(const ColumnFile* cf, size_t column);
+
+/// @brief Values of an RC_COL_INT64 or RC_COL_TIME column
+/// @param cf pointer to a ColumnFile
+/// @param column column index
+/// @return n_rows values; NULL if the column has another type
+const int64_t* rc_col_int64(const ColumnFile* cf, size_t column);
+
+/// @brief Codes of an RC_COL_ENUM column
+/// @param cf pointer to a ColumnFile
+/// @param column column index
+/// @return n_rows codes; NULL if the column has another type
+const uint8_t* rc_col_codes(const ColumnFile* cf, size_t column);
+
+/// @brief Label of a code of an RC_COL_ENUM column
+/// @param cf pointer to a ColumnFile
+/// @param column column index
+/// @param code a code returned by rc_col_codes
+/// @return the label ("" for code 0); NULL if the code or column is invalid
+const char* rc_col_label(const ColumnFile* cf, size_t column, uint8_t code);
+
+/// @brief Number of labels of an RC_COL_ENUM column (codes 1 to n)
+/// @param cf pointer to a ColumnFile
+/// @param column column index
+/// @return number of labels; 0 if the column has another type
+size_t rc_col_n_labels(const ColumnFile* cf, size_t column);
+
+/// @brief Value of a row of an RC_COL_TEXT column
+/// @param cf pointer to a ColumnFile
+/// @param column column index
+/// @param row row index
+/// @param length set to the length of the string (without the '\0'); may be NULL
+/// @return the null-terminated string; NULL if the column or row is invalid
+const char* rc_col_text(const ColumnFile* cf, size_t column, size_t row, size_t* length);
+
+/// @brief Unmap and free a ColumnFile
+/// @param cf pointer to a ColumnFile
+void rc_col_close(ColumnFile* cf);
+
+#endif // RC_COLUMNAR_H
@@ -0,0 +1,166 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "endpoint.h"
+#include "ringextract.h"
+
+#define ENDPOINT(X, GROUP, PAGING, CACHE, IDS) { #X, RC_GET_##X, RC_GROUP_##GROUP, RC_PAGING_##PAGING, CACHE, IDS }
+
+static const Endpoint rc_endpoints[] = {
+
+#ifndef RC_V1_DISABLE
+    // Voice
+    ENDPOINT(BUSINESS_HOURS,      LIGHT,  NONE,  false, 0),
+    ENDPOINT(ANSWERING_RULE,      MEDIUM, PAGES, false, 0),
+    ENDPOINT(FORWARD_ALL_CALLS,   LIGHT,  NONE,  false, 0),
+    ENDPOINT(CALL_LOG,            HEAVY,  LINKS, false, 0),
+    ENDPOINT(ACTIVE_CALLS,        HEAVY,  LINKS, false, 0),
+    ENDPOINT(CALL_GROUPS,         MEDIUM, PAGES, false, 0),
+    ENDPOINT(CALL_GROUP_MEMBERS,  MEDIUM, PAGES, false, 1),
+    ENDPOINT(CALL_QUEUES,         MEDIUM, PAGES, false, 0),
+    ENDPOINT(CALL_QUEUE_MEMBERS,  MEDIUM, PAGES, false, 1),
+    ENDPOINT(CALL_RECORDING,      LIGHT,  NONE,  false, 0),
+    ENDPOINT(CALL_RECORDING_EXT,  MEDIUM, PAGES, false, 0),
+    ENDPOINT(CUSTOM_GREETINGS,    LIGHT,  PAGES, false, 0),
+    ENDPOINT(GREETING,            MEDIUM, PAGES, true,  0),
+    ENDPOINT(IVR_PROMPTS,         MEDIUM, PAGES, false, 0),
+    ENDPOINT(IVR_MENUS,           MEDIUM, PAGES, false, 0),
+
+    // Account
+    ENDPOINT(ACCOUNT,             LIGHT,  NONE,  false, 0),
+    ENDPOINT(BUSINESS_ADDRESS,    LIGHT,  NONE,  false, 0),
+    ENDPOINT(SERVICE_INFO,        MEDIUM, NONE,  false, 0),
+    ENDPOINT(CUSTOM_FIELDS,       LIGHT,  PAGES, false, 0),
+    ENDPOINT(SITES,               MEDIUM, PAGES, false, 0),
+    ENDPOINT(SITE_MEMBERS,        MEDIUM, PAGES, false, 1),
+    ENDPOINT(SITE_IVR,            MEDIUM, NONE,  false, 1),
+    ENDPOINT(PHONE_NUMBER,        HEAVY,  PAGES, false, 0),
+    ENDPOINT(PRESENCE,            HEAVY,  PAGES, false, 0),
+    ENDPOINT(CALL_QUEUE_PRESENCE, LIGHT,  PAGES, false, 1),
+    ENDPOINT(LANGUAGE,            LIGHT,  PAGES, true,  0),
+    ENDPOINT(COUNTRY,             LIGHT,  PAGES, true,  0),
+    ENDPOINT(LOCATION,            LIGHT,  PAGES, true,  1),
+    ENDPOINT(STATE,               LIGHT,  PAGES, true,  0),
+    ENDPOINT(TIMEZONE,            LIGHT,  PAGES, true,  0),
+    ENDPOINT(PERMISSION,          LIGHT,  PAGES, true,  0),
+    ENDPOINT(PERMISSION_CATEGORY, LIGHT,  PAGES, true,  0),
+
+    // Provisioning
+    ENDPOINT(USERS,               HEAVY,  PAGES, false, 0),
+    ENDPOINT(WIRELESS_POINTS,     HEAVY,  PAGES, false, 0),
+    ENDPOINT(NETWORKS,            HEAVY,  PAGES, false, 0),
+    ENDPOINT(DEVICES,             HEAVY,  PAGES, false, 0),
+    ENDPOINT(SWITCHES,            HEAVY,  PAGES, false, 0),
+    ENDPOINT(EMERGENCY_LOCATIONS, HEAVY,  PAGES, false, 0),
+    ENDPOINT(EXTENSION,           MEDIUM, PAGES, false, 0),
+    ENDPOINT(TEMPLATES,           LIGHT,  PAGES, false, 0),
+
+    // Roles and Permissions
+    ENDPOINT(ASSIGNED_ROLE,       HEAVY,  PAGES, false, 0),
+    ENDPOINT(USER_ROLE,           MEDIUM, PAGES, false, 0),
+    ENDPOINT(USER_ROLE_DEFAULT,   LIGHT,  NONE,  false, 0),
+#endif // RC_V1_DISABLE
+
+    { NULL, NULL, RC_GROUP_LIGHT, RC_PAGING_LINKS, false, 0 }
+
+};
+
+#undef ENDPOINT
+
+#define RC_ENDPOINTS (sizeof(rc_endpoints) / sizeof(rc_endpoints[0]) - 1)
+
+static const char* rc_endpoint_path(const char* url) {
+
+    const char* scheme = strstr(url, "://");
+    if (scheme) { url = scheme + 3; }
+
+    const char* path = strchr(url, '/');
+    return path ? path : url + strlen(url);
+
+}
+
+static inline bool rc_endpoint_end(char c) { return c == '\0' || c == '?' || c == '#'; }
+
+// ~ and %li in the preset match an id (or ~) in the url
+static bool rc_endpoint_match(const char* preset, const char* path) {
+
+    while (!rc_endpoint_end(*preset) && !rc_endpoint_end(*path)) {
+
+        const bool id = *preset == '~' || strncmp(preset, "%li", 3) == 0;
+
+        if (id && *path == '~') { path++; }
+        else if (id && *path >= '0' && *path <= '9') { while (*path >= '0' && *path <= '9') { path++; } }
+        else if (*preset == *path) { preset++; path++; continue; }
+        else { return false; }
+
+        preset += *preset == '~' ? 1 : 3;
+
+    }
+
+    return rc_endpoint_end(*preset) && rc_endpoint_end(*path);
+
+}
+
+const Endpoint* rc_endpoint_find(const char* url) {
+
+    const char* path = rc_endpoint_path(url);
+
+    for (size_t i = 0; i < RC_ENDPOINTS; i++)
+    { if (rc_endpoint_match(rc_endpoint_path(rc_endpoints[i].url), path)) { return rc_endpoints + i; } }
+
+    return NULL;
+
+}
+
+const Endpoint* rc_endpoint_named(const char* name) {
+
+    if (strncmp(name, "RC_GET_", 7) == 0) { name += 7; }
+
+    for (size_t i = 0; i < RC_ENDPOINTS; i++)
+    { if (strcmp(name, rc_endpoints[i].name) == 0) { return rc_endpoints + i; } }
+
+    return NULL;
+
+}
+
+const char* rc_endpoint_group_name(UsageGroup group) {
+
+    static const char* const names[] = { "Light", "Medium", "Heavy", "Auth" };
+    return names[group];
+
+}
+
+uint64_t rc_endpoint_hash(const char* url) {
+
+    uint64_t hash = 0xcbf29ce484222325ULL; // FNV-1a
+
+    const char* scheme = strstr(url, "://");
+    if (scheme) { url = scheme + 3; }
+
+    for (; *url && *url != '?' && *url != '#'; url++) {
+
+        if (*url >= '0' && *url <= '9') { continue; }
+        hash = (hash ^ (uint8_t)*url) * 0x100000001b3ULL;
+
+    }
+
+    return hash ? hash : 1;
+
+}
@@ -0,0 +1,96 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_ENDPOINT_H
+#define RC_ENDPOINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum { RC_GROUP_LIGHT, RC_GROUP_MEDIUM, RC_GROUP_HEAVY, RC_GROUP_AUTH } UsageGroup;
+
+typedef enum {
+
+    RC_PAGING_NONE,  // a single response, no page loop
+    RC_PAGING_LINKS, // follow navigation.nextPage, one page after another (e.g. call log)
+    RC_PAGING_PAGES  // numbered pages, paging.totalPages known from the first page
+
+} PagingStyle;
+
+/**
+ * Descriptor of a preset endpoint
+ *
+ * Every RC_GET_ preset is registered at compile time, along with what the
+ * library cannot tell from a bare URL. The data fetching APIs look up the
+ * URL they are given and pick their strategy from it:
+ *
+ * - RC_PAGING_NONE: rc_json_get_buffer makes a single request and does not
+ *   look for a next page
+ * - RC_PAGING_PAGES: once the first page tells how many pages there are,
+ *   rc_json_get_buffer fetches the others concurrently if the token has a
+ *   SharedLimiter attached (so they draw from one budget) and the
+ *   JsonContent has no memory cap, with the same combined result
+ * - usage group: a SharedLimiter charges requests to their group's budget
+ *   before the server has reported the group of the endpoint
+ * - cacheable: an attached SingleFlight keeps the response for later
+ *   requests, as dictionaries do not change during an extraction
+ *
+ * URLs are matched by path, so that query parameters, ids and RC_PRODUCTION
+ * do not matter: ~ and %li in a preset match an id or ~ in the URL. URLs
+ * that match no preset are fetched as before (one page after another).
+ *
+ * const Endpoint* endpoint = rc_endpoint_find(url);
+ * if (endpoint && endpoint->group == RC_GROUP_HEAVY) { ... }
+ */
+typedef struct Endpoint {
+
+    const char* name; // preset name without RC_GET_, e.g. "CALL_LOG"
+    const char* url;  // RC_GET_ preset
+    UsageGroup group; // X-Rate-Limit-Group (the server's response still decides)
+    PagingStyle paging;
+    bool cacheable;
+    size_t n_ids;     // number of %li parameters
+
+} Endpoint;
+
+/// @brief Look up the preset endpoint a url belongs to
+/// @param url full url, e.g. a preset with its ids filled in
+/// @return pointer to the endpoint's descriptor; NULL if not a preset endpoint
+const Endpoint* rc_endpoint_find(const char* url);
+
+/// @brief Look up a preset endpoint by name
+/// @param name preset name, with or without RC_GET_ (e.g. "RC_GET_SITES" or "SITES")
+/// @return pointer to the endpoint's descriptor; NULL if there is no such preset
+const Endpoint* rc_endpoint_named(const char* name);
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief name of a usage group as sent in X-Rate-Limit-Group
+/// @param group usage group
+/// @return e.g. "Heavy"
+const char* rc_endpoint_group_name(UsageGroup group);
+
+/// @brief hash of the host and path of a url, with ids (digits) left out
+/// @param url full url
+/// @return the same value for /extension/123/call-log and /extension/~/call-log; never 0
+uint64_t rc_endpoint_hash(const char* url);
+
+#endif // RINGEXTRACT_H
+
+#endif // RC_ENDPOINT_H
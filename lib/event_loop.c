@@ -0,0 +1,485 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "event_loop.h"
+#include "rate_limiter.h"
+#include "tracer.h"
+
+#define LOOP_NO_DEADLINE UINT64_MAX
+
+typedef enum { LOOP_JSON, LOOP_MEDIA, LOOP_FILE, LOOP_TOKEN } LoopKind;
+
+typedef enum {
+
+    LOOP_ACTIVE,  // added to the multi handle
+    LOOP_DELAYED, // waiting out a rate limit until wake_at
+    LOOP_WAITING, // waiting for its token to be refreshed
+    LOOP_DONE
+
+} LoopState;
+
+typedef struct LoopRequest {
+
+    EventLoop* loop;
+    BearerToken* token;
+    CURL* curl;
+
+    LoopKind kind;
+    LoopState state;
+    void* content;
+
+    LoopCallback callback;
+    void* userdata;
+
+    uint64_t attempt;
+    uint64_t timeout;
+    uint64_t wake_at;
+    uint64_t start;
+    uint64_t page_start;
+
+    TokenError s_token;
+    char error[CURL_ERROR_SIZE];
+
+    struct LoopRequest* next;
+
+} LoopRequest;
+
+static void rc_loop_start(LoopRequest* request);
+
+static inline uint64_t rc_loop_clock(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+
+}
+
+static int rc_loop_socket(CURL* curl, curl_socket_t fd, int what, void* userdata, void* socketp) {
+
+    (void)curl;
+    (void)socketp;
+
+    EventLoop* loop = (EventLoop*)userdata;
+    loop->on_socket(fd, what, loop->userdata);
+    return 0;
+
+}
+
+static int rc_loop_timer(CURLM* multi, long timeout_ms, void* userdata) {
+
+    (void)multi;
+
+    EventLoop* loop = (EventLoop*)userdata;
+    loop->deadline = timeout_ms < 0 ? LOOP_NO_DEADLINE : rc_loop_clock() + (uint64_t)timeout_ms;
+    return 0;
+
+}
+
+// report the earliest of libcurl's timer and the delayed requests to the host
+static void rc_loop_arm(EventLoop* loop) {
+
+    uint64_t deadline = loop->deadline;
+
+    for (LoopRequest* request = loop->requests; request; request = request->next) {
+
+        if (request->state == LOOP_DELAYED && request->wake_at < deadline)
+        { deadline = request->wake_at; }
+
+    }
+
+    if (deadline == LOOP_NO_DEADLINE) { loop->on_timer(-1, loop->userdata); return; }
+
+    const uint64_t now = rc_loop_clock();
+    loop->on_timer(deadline > now ? (long)(deadline - now) : 0, loop->userdata);
+
+}
+
+static LoopRequest* rc_loop_request(EventLoop* loop, BearerToken* token, LoopKind kind,
+                                    void* content, LoopCallback callback, void* userdata) {
+
+    LoopRequest* request = calloc(1, sizeof(LoopRequest));
+    if (request == NULL) { return NULL; }
+
+    request->curl = curl_easy_init();
+    if (request->curl == NULL) { free(request); return NULL; }
+
+    request->loop = loop;
+    request->token = token;
+    request->kind = kind;
+    request->state = LOOP_DONE;
+    request->content = content;
+    request->callback = callback;
+    request->userdata = userdata;
+    request->attempt = MAX_RETRY_ATTEMPT;
+    request->timeout = MIN_RETRY_TIMEOUT;
+    request->s_token = RC_TOKEN_OK;
+
+    // negotiate HTTP/2 over TLS and wait for a multiplexed stream
+    // rather than opening another connection
+    curl_easy_setopt(request->curl, CURLOPT_PRIVATE, request);
+    curl_easy_setopt(request->curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(request->curl, CURLOPT_PIPEWAIT, 1L);
+
+    request->next = loop->requests;
+    loop->requests = request;
+    if (kind != LOOP_TOKEN) { loop->n_pending++; }
+    return request;
+
+}
+
+static void rc_loop_release(LoopRequest* request) {
+
+    EventLoop* loop = request->loop;
+    LoopRequest** cursor = &loop->requests;
+
+    while (*cursor != request) { cursor = &(*cursor)->next; }
+    *cursor = request->next;
+
+    if (request->state == LOOP_ACTIVE) { curl_multi_remove_handle(loop->multi, request->curl); }
+    if (request->kind == LOOP_FILE) { fclose((FILE*)request->content); }
+    if (request->kind != LOOP_TOKEN) { loop->n_pending--; }
+
+    curl_easy_cleanup(request->curl);
+    free(request);
+
+}
+
+static void rc_loop_finish(LoopRequest* request) {
+
+    char error[CURL_ERROR_SIZE];
+    const LoopCallback callback = request->callback;
+    void* const userdata = request->userdata;
+    const TokenError s_token = request->s_token;
+
+    if (s_token == RC_TOKEN_OK) { error[0] = '\0'; }
+    else { memcpy(error, request->error, CURL_ERROR_SIZE); }
+
+    rc_loop_release(request);
+    if (callback) { callback(s_token, error, userdata); }
+
+}
+
+static void rc_loop_fail(LoopRequest* request, TokenError s_token, const char* message) {
+
+    request->s_token = s_token;
+    if (message) { snprintf(request->error, CURL_ERROR_SIZE, "%s", message); }
+    rc_loop_finish(request);
+
+}
+
+static void rc_loop_delay(LoopRequest* request, unsigned int seconds) {
+
+    if (seconds == 0) { rc_loop_start(request); return; }
+
+    request->state = LOOP_DELAYED;
+    request->wake_at = rc_loop_clock() + (uint64_t)seconds * 1000;
+
+}
+
+// every request waiting for this token either starts or fails with it
+static void rc_loop_wake(EventLoop* loop, BearerToken* token, unsigned int seconds) {
+
+    LoopRequest* request = loop->requests;
+
+    while (request) {
+
+        if (request->state == LOOP_WAITING && request->token == token) {
+
+            rc_loop_delay(request, seconds);
+            request = loop->requests; // the list may have changed
+
+        } else { request = request->next; }
+
+    }
+
+}
+
+static void rc_loop_refresh(LoopRequest* request) {
+
+    EventLoop* loop = request->loop;
+    BearerToken* token = request->token;
+    request->state = LOOP_WAITING;
+
+    // a single access token request is shared by all requests using the token
+    for (LoopRequest* other = loop->requests; other; other = other->next)
+    { if (other->kind == LOOP_TOKEN && other->token == token) { return; } }
+
+    LoopRequest* refresh = rc_loop_request(loop, token, LOOP_TOKEN, NULL, NULL, NULL);
+    if (refresh == NULL) { rc_loop_fail(request, RC_CURL_INIT_FAILED, "CURL initialization failed."); return; }
+
+    rc_token_prepare(token, refresh->curl);
+    refresh->start = rc_trace_clock();
+
+    if (curl_multi_add_handle(loop->multi, refresh->curl) == CURLM_OK) { refresh->state = LOOP_ACTIVE; return; }
+
+    rc_loop_release(refresh);
+    token->s_token = RC_CURL_INIT_FAILED;
+    rc_curl_set_error(token);
+    rc_loop_wake(loop, token, 0);
+
+}
+
+static void rc_loop_start(LoopRequest* request) {
+
+    BearerToken* token = request->token;
+
+    if (rc_token_expired(token)) { rc_loop_refresh(request); return; }
+
+    if (rc_curl_set_token(token, request->curl) != RC_TOKEN_OK) {
+
+        rc_curl_set_error(token);
+        rc_loop_fail(request, token->s_token, token->error);
+        return;
+
+    }
+
+    // keep transfer errors with the request; they do not invalidate the token
+    curl_easy_setopt(request->curl, CURLOPT_ERRORBUFFER, request->error);
+    request->start = rc_trace_clock();
+
+    if (curl_multi_add_handle(request->loop->multi, request->curl) == CURLM_OK) { request->state = LOOP_ACTIVE; }
+    else { rc_loop_fail(request, RC_CURL_INIT_FAILED, "CURL initialization failed."); }
+
+}
+
+static void rc_loop_token_done(LoopRequest* refresh, CURLcode result) {
+
+    EventLoop* loop = refresh->loop;
+    BearerToken* token = refresh->token;
+    uint64_t timeout = 0;
+    unsigned int delay = 0;
+
+    rc_trace_transfer(refresh->curl, refresh->start);
+
+    if (rc_curl_check_limit(refresh->curl, result, &timeout, &delay) != RC_LIMIT_DONE)
+    { token->s_token = RC_CURL_TRANSFER_FAILED; }
+
+    rc_token_parse(token);
+    rc_curl_set_error(token);
+    rc_trace_span(RC_TRACE_TOKEN, refresh->start, token->s_token);
+
+    rc_loop_release(refresh);
+    rc_loop_wake(loop, token, delay);
+
+}
+
+static void rc_loop_done(LoopRequest* request, unsigned int delay) {
+
+    if (request->kind == LOOP_JSON) {
+
+        JsonContent* json = (JsonContent*)request->content;
+        const size_t page = json->n_pages;
+
+        rc_curl_next_page(json);
+        rc_trace_span(RC_TRACE_PAGE, request->page_start, page);
+
+        if (json->url_next_page) {
+
+            curl_easy_setopt(request->curl, CURLOPT_URL, json->url_next_page);
+            request->attempt = MAX_RETRY_ATTEMPT;
+            request->timeout = MIN_RETRY_TIMEOUT;
+            request->page_start = rc_trace_clock();
+            rc_loop_delay(request, delay);
+            return;
+
+        }
+
+    }
+
+    rc_loop_finish(request);
+
+}
+
+static void rc_loop_complete(EventLoop* loop) {
+
+    CURLMsg* message;
+    int n_messages = 0;
+
+    while ((message = curl_multi_info_read(loop->multi, &n_messages))) {
+
+        if (message->msg != CURLMSG_DONE) { continue; }
+
+        LoopRequest* request = NULL;
+        unsigned int delay = 0;
+        const CURLcode result = message->data.result;
+
+        curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char**)&request);
+        curl_multi_remove_handle(loop->multi, request->curl);
+        request->state = LOOP_DONE;
+
+        if (request->kind == LOOP_TOKEN) { rc_loop_token_done(request, result); continue; }
+
+        rc_trace_transfer(request->curl, request->start);
+
+        switch (rc_curl_check_limit(request->curl, result, &request->timeout, &delay)) {
+
+        case RC_LIMIT_DONE:
+            rc_loop_done(request, delay);
+            break;
+
+        case RC_LIMIT_RETRY:
+            if (request->attempt--) { rc_loop_delay(request, delay); }
+            else { rc_loop_fail(request, RC_CURL_TRANSFER_FAILED, NULL); }
+            break;
+
+        default:
+            rc_loop_fail(request, RC_CURL_TRANSFER_FAILED, NULL);
+            break;
+
+        }
+
+    }
+
+}
+
+EventLoop* rc_loop_init(LoopSocketFunction on_socket, LoopTimerFunction on_timer, void* userdata) {
+
+    EventLoop* loop = calloc(1, sizeof(EventLoop));
+    if (loop == NULL) { return NULL; }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    loop->multi = curl_multi_init();
+    loop->on_socket = on_socket;
+    loop->on_timer = on_timer;
+    loop->userdata = userdata;
+    loop->deadline = LOOP_NO_DEADLINE;
+
+    if (loop->multi) {
+
+        curl_multi_setopt(loop->multi, CURLMOPT_SOCKETFUNCTION, rc_loop_socket);
+        curl_multi_setopt(loop->multi, CURLMOPT_SOCKETDATA, loop);
+        curl_multi_setopt(loop->multi, CURLMOPT_TIMERFUNCTION, rc_loop_timer);
+        curl_multi_setopt(loop->multi, CURLMOPT_TIMERDATA, loop);
+        curl_multi_setopt(loop->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        return loop;
+
+    }
+
+    curl_global_cleanup();
+    free(loop);
+    return NULL;
+
+}
+
+void rc_loop_action(EventLoop* loop, curl_socket_t fd, int events) {
+
+    int n_running = 0;
+    uint64_t now = rc_loop_clock();
+
+    if (fd != CURL_SOCKET_TIMEOUT) { curl_multi_socket_action(loop->multi, fd, events, &n_running); }
+    else if (loop->deadline <= now) {
+
+        loop->deadline = LOOP_NO_DEADLINE; // one-shot; libcurl sets it again if needed
+        curl_multi_socket_action(loop->multi, CURL_SOCKET_TIMEOUT, 0, &n_running);
+
+    }
+
+    rc_loop_complete(loop);
+
+    LoopRequest* request = loop->requests;
+    now = rc_loop_clock();
+
+    while (request) {
+
+        if (request->state == LOOP_DELAYED && request->wake_at <= now) {
+
+            rc_loop_start(request);
+            request = loop->requests; // the list may have changed
+
+        } else { request = request->next; }
+
+    }
+
+    rc_loop_arm(loop);
+
+}
+
+size_t rc_loop_pending(const EventLoop* loop) { return loop->n_pending; }
+
+TokenError rc_loop_json_get_buffer(EventLoop* loop, BearerToken* token, JsonContent* json,
+                                   const char* url, LoopCallback callback, void* userdata) {
+
+    LoopRequest* request = rc_loop_request(loop, token, LOOP_JSON, json, callback, userdata);
+    if (request == NULL) { return RC_CURL_INIT_FAILED; }
+
+    rc_json_reset(json);
+
+    curl_easy_setopt(request->curl, CURLOPT_URL, url);
+    curl_easy_setopt(request->curl, CURLOPT_WRITEFUNCTION, rc_curl_write_json);
+    curl_easy_setopt(request->curl, CURLOPT_WRITEDATA, json);
+
+    request->page_start = rc_trace_clock();
+    rc_loop_start(request);
+    rc_loop_arm(loop);
+    return RC_TOKEN_OK;
+
+}
+
+TokenError rc_loop_media_get_buffer(EventLoop* loop, BearerToken* token, MediaContent* media,
+                                    const char* url, LoopCallback callback, void* userdata) {
+
+    LoopRequest* request = rc_loop_request(loop, token, LOOP_MEDIA, media, callback, userdata);
+    if (request == NULL) { return RC_CURL_INIT_FAILED; }
+
+    media->n_bytes = 0;
+
+    curl_easy_setopt(request->curl, CURLOPT_URL, url);
+    curl_easy_setopt(request->curl, CURLOPT_WRITEFUNCTION, rc_curl_write_media);
+    curl_easy_setopt(request->curl, CURLOPT_WRITEDATA, media);
+
+    rc_loop_start(request);
+    rc_loop_arm(loop);
+    return RC_TOKEN_OK;
+
+}
+
+TokenError rc_loop_media_get_file(EventLoop* loop, BearerToken* token, const char* file,
+                                  const char* url, LoopCallback callback, void* userdata) {
+
+    FILE* f = fopen(file, "wb");
+    if (f == NULL) { return RC_CURL_INIT_FAILED; }
+
+    LoopRequest* request = rc_loop_request(loop, token, LOOP_FILE, f, callback, userdata);
+    if (request == NULL) { fclose(f); return RC_CURL_INIT_FAILED; }
+
+    curl_easy_setopt(request->curl, CURLOPT_URL, url);
+    curl_easy_setopt(request->curl, CURLOPT_WRITEFUNCTION, NULL);
+    curl_easy_setopt(request->curl, CURLOPT_WRITEDATA, f);
+
+    rc_loop_start(request);
+    rc_loop_arm(loop);
+    return RC_TOKEN_OK;
+
+}
+
+void rc_loop_free(EventLoop* loop) {
+
+    while (loop->requests) { rc_loop_release(loop->requests); }
+
+    curl_multi_cleanup(loop->multi);
+    curl_global_cleanup();
+    free(loop);
+
+}
@@ -0,0 +1,147 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_EVENT_LOOP_H
+#define RC_EVENT_LOOP_H
+
+#include <stdint.h>
+#include "json_content.h"
+#include "media_content.h"
+
+/// @brief Called when the loop needs a socket watched (or no longer watched)
+/// @param fd socket to watch
+/// @param what CURL_POLL_IN, CURL_POLL_OUT, CURL_POLL_INOUT or CURL_POLL_REMOVE
+/// @param userdata userdata given to rc_loop_init
+typedef void (*LoopSocketFunction)(curl_socket_t fd, int what, void* userdata);
+
+/// @brief Called when the loop's single timer must be (re)armed
+/// @param timeout_ms milliseconds until rc_loop_action(loop, CURL_SOCKET_TIMEOUT, 0)
+///        must be called; -1 to disarm the timer
+/// @param userdata userdata given to rc_loop_init
+typedef void (*LoopTimerFunction)(long timeout_ms, void* userdata);
+
+/// @brief Called once a request has completed, including its page loop and retries
+/// @param status RC_TOKEN_OK on success, otherwise the TokenError of the request
+/// @param error human readable reason on failure, empty string on success
+/// @param userdata userdata given with the request
+typedef void (*LoopCallback)(TokenError status, const char* error, void* userdata);
+
+/**
+ * Event-loop integration (non-blocking data fetching)
+ *
+ * The blocking data fetching APIs each own the calling thread until their
+ * page loop completes, and wait out rate limits with sleep(). An EventLoop
+ * runs the same transfers as callbacks on the caller's own loop (epoll,
+ * libuv, libevent, ...) instead: the loop tells the host which sockets to
+ * watch and when its timer should fire; the host reports socket readiness
+ * and timer expiry back with rc_loop_action. Page loops, 429/503 retries,
+ * rate limit windows and access token refreshes all advance from there,
+ * without blocking or sleeping, and a LoopCallback is invoked once each
+ * request is done.
+ *
+ * Concurrent requests are multiplexed over HTTP/2 where possible. Requests
+ * sharing a token share a single access token refresh.
+ *
+ * EventLoop* loop = rc_loop_init(on_socket, on_timer, host);
+ * rc_loop_json_get_buffer(loop, token, json, RC_GET_CALL_LOG, on_done, NULL);
+ * while (rc_loop_pending(loop)) {
+ *     ... wait on the watched sockets / timer ...
+ *     rc_loop_action(loop, fd, CURL_CSELECT_IN); // or CURL_SOCKET_TIMEOUT, 0
+ * }
+ * rc_loop_free(loop);
+ *
+ * - All functions (and all callbacks) run on the thread calling them
+ * - The token, containers and file name of a request must remain valid,
+ *   and must not be used elsewhere, until its callback has been invoked
+ * - Requests may be started from within a LoopCallback
+ */
+typedef struct EventLoop {
+
+    CURLM* multi;
+
+    LoopSocketFunction on_socket;
+    LoopTimerFunction on_timer;
+    void* userdata;
+
+    uint64_t deadline; // libcurl's timer, UINT64_MAX if not set
+    struct LoopRequest* requests;
+    size_t n_pending;
+
+} EventLoop;
+
+/// @brief Create an event loop
+/// @param on_socket called whenever a socket must be watched or removed
+/// @param on_timer called whenever the timer must be rearmed
+/// @param userdata passed to on_socket and on_timer
+/// @return a pointer to the event loop; NULL if it could not be created
+EventLoop* rc_loop_init(LoopSocketFunction on_socket, LoopTimerFunction on_timer, void* userdata);
+
+/// @brief Report socket readiness or timer expiry to the loop
+/// @param loop pointer to an EventLoop
+/// @param fd ready socket, or CURL_SOCKET_TIMEOUT when the timer fired
+/// @param events bitmask of CURL_CSELECT_IN, CURL_CSELECT_OUT and CURL_CSELECT_ERR
+///        (0 for the timer)
+/// @note Completed requests invoke their LoopCallback before this returns
+void rc_loop_action(EventLoop* loop, curl_socket_t fd, int events);
+
+/// @brief Number of requests whose callback has not been invoked yet
+/// @param loop pointer to an EventLoop
+/// @return number of pending requests
+size_t rc_loop_pending(const EventLoop* loop);
+
+/// @brief Store JSON response in memory, same as rc_json_get_buffer
+/// @param loop pointer to an EventLoop
+/// @param token pointer to a BearerToken (can be just a skeleton)
+/// @param json pointer to a JsonContent container
+/// @param url full url
+/// @param callback called once the page loop has completed
+/// @param userdata passed to callback
+/// @return RC_TOKEN_OK if the request was started (callback will be invoked);
+///         RC_CURL_INIT_FAILED otherwise (callback will not be invoked)
+TokenError rc_loop_json_get_buffer(EventLoop* loop, BearerToken* token, JsonContent* json,
+                                   const char* url, LoopCallback callback, void* userdata);
+
+/// @brief Store binary media in memory, same as rc_media_get_buffer
+/// @param loop pointer to an EventLoop
+/// @param token pointer to a BearerToken (can be just a skeleton)
+/// @param media pointer to a MediaContent container
+/// @param url full url
+/// @param callback called once the download has completed
+/// @param userdata passed to callback
+/// @return RC_TOKEN_OK if the request was started (callback will be invoked);
+///         RC_CURL_INIT_FAILED otherwise (callback will not be invoked)
+TokenError rc_loop_media_get_buffer(EventLoop* loop, BearerToken* token, MediaContent* media,
+                                    const char* url, LoopCallback callback, void* userdata);
+
+/// @brief Write media response directly to file, same as rc_media_get_file
+/// @param loop pointer to an EventLoop
+/// @param token pointer to a BearerToken (can be just a skeleton)
+/// @param file full path & file name to be written
+/// @param url full url
+/// @param callback called once the download has completed and the file is closed
+/// @param userdata passed to callback
+/// @return RC_TOKEN_OK if the request was started (callback will be invoked);
+///         RC_CURL_INIT_FAILED otherwise (callback will not be invoked)
+TokenError rc_loop_media_get_file(EventLoop* loop, BearerToken* token, const char* file,
+                                  const char* url, LoopCallback callback, void* userdata);
+
+/// @brief Cancel all pending requests (without invoking their callbacks) and free the loop
+/// @param loop pointer to an EventLoop
+void rc_loop_free(EventLoop* loop);
+
+#endif // RC_EVENT_LOOP_H
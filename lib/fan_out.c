@@ -0,0 +1,405 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "fan_out.h"
+#include "json_scan.h"
+#include "media_content.h"
+#include "rate_limiter.h"
+#include "tracer.h"
+
+#define MUL(X, Y) (((X) / (Y) + 1) * (Y))
+
+#define FAN_URL_SIZE 512
+#define FAN_ID_SIZE 64
+
+typedef struct {
+
+    BearerToken* token;
+    const char* url;
+    const long* ids;
+    JsonContent* children;
+    size_t n_children;
+
+    atomic_size_t next;
+    pthread_mutex_t lock;
+    size_t n_failed;
+
+} FanState;
+
+typedef struct {
+
+    BearerToken* token;
+    const char* url;  // url of page 2
+    int n_head;       // bytes of url before the page number
+    const char* tail; // rest of url after the page number
+
+    MediaContent* slots; // raw responses of pages i, i + n_slots, ... (pages counted from 2)
+    bool* ready;         // slot holds its page, to be appended
+    size_t n_slots;
+    size_t n_pages;
+
+    size_t next;     // next page to request
+    size_t appended; // pages handed to the JsonContent so far
+    size_t n_ok;     // pages before the first one that failed
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+} PageState;
+
+bool rc_fan_ids(const JsonContent* parent, long** ids, size_t* n_ids) {
+
+    JsonScan scan;
+    size_t n = 0;
+    size_t length = 0;
+
+    if (!rc_scan_records(&scan, parent->buffer, parent->n_bytes)) { return true; }
+
+    for (const char* record; (record = rc_scan_next(&scan, &n)); ) {
+
+        const char* id = rc_scan_field(record, n, "id", &length);
+        if (id == NULL) { continue; }
+
+        if (*n_ids % FAN_ID_SIZE == 0) {
+
+            long* buffer = realloc(*ids, MUL(*n_ids, FAN_ID_SIZE) * sizeof(long));
+            if (buffer) { *ids = buffer; }
+            else { return false; }
+
+        }
+
+        (*ids)[(*n_ids)++] = (long)rc_scan_int(id, length);
+
+    }
+
+    return true;
+
+}
+
+static bool rc_fan_append(JsonContent* json, const char* contents, size_t n) {
+
+    if (json->n_bytes + n >= json->total_size) {
+
+        const size_t total_size = MUL(json->n_bytes + n, json->init_size);
+        char* buffer = realloc(json->buffer, total_size);
+
+        if (buffer) { json->buffer = buffer; json->total_size = total_size; }
+        else { return false; }
+
+    }
+
+    memcpy(json->buffer + json->n_bytes, contents, n);
+    json->n_bytes += n;
+    json->buffer[json->n_bytes] = '\0';
+    return true;
+
+}
+
+const char* rc_fan_merge(JsonContent* json, const long* ids, const JsonContent* children, size_t n) {
+
+    char tag[FAN_ID_SIZE];
+    bool ok = true;
+    bool first = true;
+
+    rc_json_reset(json);
+    ok = rc_fan_append(json, "{\"records\":[", 12);
+
+    for (size_t i = 0; i < n && ok; i++) {
+
+        JsonScan scan;
+        size_t length = 0;
+
+        json->n_pages += children[i].n_pages;
+        if (!rc_scan_records(&scan, children[i].buffer, children[i].n_bytes)) { continue; }
+
+        for (const char* record; ok && (record = rc_scan_next(&scan, &length)); ) {
+
+            if (*record != '{') { continue; }
+
+            const char* rest = record + 1;
+            while (*rest == ' ' || *rest == '\n' || *rest == '\r' || *rest == '\t') { rest++; }
+
+            const int size = snprintf(tag, FAN_ID_SIZE, "%s\n{\"parentId\":%li%s",
+                                      first ? "" : ",", ids[i], *rest == '}' ? "" : ",");
+
+            ok = rc_fan_append(json, tag, size)
+              && rc_fan_append(json, record + 1, length - 1);
+            first = false;
+
+        }
+
+    }
+
+    ok = ok && rc_fan_append(json, "\n]}", 3);
+    return ok ? json->buffer : NULL;
+
+}
+
+static void* rc_fan_worker(void* userdata) {
+
+    FanState* state = (FanState*)userdata;
+    char url[FAN_URL_SIZE];
+
+    for (size_t i; (i = atomic_fetch_add(&state->next, 1)) < state->n_children; ) {
+
+        BearerToken token;
+        JsonContent* child = state->children + i;
+        snprintf(url, FAN_URL_SIZE, state->url, state->ids[i]);
+
+        if (rc_token_fork(&token, state->token) == RC_TOKEN_OK) { rc_json_get_buffer(&token, child, url); }
+        if (token.s_token == RC_TOKEN_OK) { continue; }
+
+        child->n_bytes = 0;
+        pthread_mutex_lock(&state->lock);
+
+        if (state->n_failed++ == 0) {
+
+            state->token->s_token = token.s_token;
+            memcpy(state->token->error, token.error, CURL_ERROR_SIZE);
+
+        }
+
+        pthread_mutex_unlock(&state->lock);
+
+    }
+
+    return NULL;
+
+}
+
+static void* rc_fan_page_worker(void* userdata) {
+
+    PageState* state = (PageState*)userdata;
+    char url[FAN_URL_SIZE];
+    CURL* curl = curl_easy_init();
+
+    if (curl) { curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, rc_curl_write_media); }
+
+    for (;;) {
+
+        BearerToken token;
+        uint64_t attempt = MAX_RETRY_ATTEMPT;
+        uint64_t timeout = MIN_RETRY_TIMEOUT;
+
+        // pages are only requested while they fit in the window ahead of the last one appended
+        pthread_mutex_lock(&state->lock);
+
+        while (state->next < state->n_ok && state->next >= state->appended + state->n_slots)
+        { pthread_cond_wait(&state->cond, &state->lock); }
+
+        const size_t i = state->next < state->n_ok ? state->next++ : SIZE_MAX; // none needed after a failure
+        pthread_mutex_unlock(&state->lock);
+
+        if (i == SIZE_MAX) { break; }
+
+        MediaContent* page = state->slots + i % state->n_slots;
+        const uint64_t start = rc_trace_clock();
+        snprintf(url, FAN_URL_SIZE, "%.*s%zu%s", state->n_head, state->url, i + 2, state->tail);
+
+        if (rc_token_fork(&token, state->token) == RC_TOKEN_OK && curl == NULL)
+        { token.s_token = RC_CURL_INIT_FAILED; rc_curl_set_error(&token); }
+
+        if (token.s_token == RC_TOKEN_OK) {
+
+            curl_easy_setopt(curl, CURLOPT_URL, url);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, page);
+
+            // a failed page is dropped and requested again, same as in the sequential page loop
+            while (rc_curl_auto_perform(&token, curl) != RC_TOKEN_OK && rc_curl_retry(&token, &attempt, &timeout))
+            { page->n_bytes = 0; }
+
+        }
+
+        rc_trace_span(RC_TRACE_PAGE, start, i + 1);
+        pthread_mutex_lock(&state->lock);
+
+        if (token.s_token != RC_TOKEN_OK && i < state->n_ok) {
+
+            state->n_ok = i;
+            state->token->s_token = token.s_token;
+            memcpy(state->token->error, token.error, CURL_ERROR_SIZE);
+
+        }
+
+        state->ready[i % state->n_slots] = true;
+        pthread_cond_broadcast(&state->cond);
+        pthread_mutex_unlock(&state->lock);
+
+    }
+
+    curl_easy_cleanup(curl);
+    return NULL;
+
+}
+
+bool rc_fan_pages(BearerToken* token, JsonContent* json, size_t n_total, size_t n_threads) {
+
+    char url[FAN_URL_SIZE];
+    size_t n_workers = 0;
+    const char* number = NULL;
+
+    // the url of page 2 is copied, as json's buffer moves once pages are appended
+    if (snprintf(url, FAN_URL_SIZE, "%s", json->url_next_page) >= FAN_URL_SIZE) { return false; }
+
+    for (const char* p = strstr(url, "page="); p && number == NULL; p = strstr(p + 5, "page="))
+    { if (p > url && (p[-1] == '?' || p[-1] == '&')) { number = p + 5; } }
+
+    char* tail = NULL;
+    if (number == NULL || strtoul(number, &tail, 10) != 2) { return false; }
+
+    n_threads = n_threads > 0 ? n_threads : FAN_THREADS;
+    if (n_threads > n_total - 1) { n_threads = n_total - 1; }
+
+    pthread_t* threads = calloc(n_threads, sizeof(pthread_t));
+    const size_t n_slots = n_threads * FAN_WINDOW < n_total - 1 ? n_threads * FAN_WINDOW : n_total - 1;
+
+    PageState state = {
+
+        .token = token,
+        .url = url,
+        .n_head = (int)(number - url),
+        .tail = tail,
+        .slots = malloc(n_slots * sizeof(MediaContent)),
+        .ready = calloc(n_slots, sizeof(bool)),
+        .n_slots = n_slots,
+        .n_pages = n_total - 1,
+        .next = 0,
+        .appended = 0,
+        .n_ok = n_total - 1,
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .cond = PTHREAD_COND_INITIALIZER
+
+    };
+
+    if (state.slots == NULL || state.ready == NULL || threads == NULL)
+    { free(state.slots); free(state.ready); free(threads); return false; }
+
+    for (size_t i = 0; i < n_slots; i++)
+    { memcpy(state.slots + i, RC_MEDIA_INIT(FAN_INIT_SIZE), sizeof(MediaContent)); }
+
+    while (n_workers < n_threads && n_workers < state.n_pages) {
+
+        if (pthread_create(threads + n_workers, NULL, rc_fan_page_worker, &state) == 0) { n_workers++; }
+        else { break; }
+
+    }
+
+    // the calling thread appends pages, exactly as the sequential page loop would, while later ones are fetched
+    for (size_t i = 0; n_workers > 0; i++) {
+
+        pthread_mutex_lock(&state.lock);
+        while (i < state.n_ok && !state.ready[i % n_slots]) { pthread_cond_wait(&state.cond, &state.lock); }
+        const bool done = i >= state.n_ok;
+        pthread_mutex_unlock(&state.lock);
+
+        if (done) { break; }
+
+        MediaContent* page = state.slots + i % n_slots;
+        const bool ok = page->n_bytes == 0 || rc_curl_write_json((char*)page->buffer, 1, page->n_bytes, json) == page->n_bytes;
+
+        if (ok) { rc_curl_next_page(json); }
+        else { token->s_token = RC_CURL_TRANSFER_FAILED; snprintf(token->error, CURL_ERROR_SIZE, "Out of memory"); }
+
+        // the slot is free for page i + n_slots
+        page->n_bytes = 0;
+        pthread_mutex_lock(&state.lock);
+
+        state.ready[i % n_slots] = false;
+        state.appended = i + 1;
+        if (!ok) { state.n_ok = i; }
+
+        pthread_cond_broadcast(&state.cond);
+        pthread_mutex_unlock(&state.lock);
+
+    }
+
+    for (size_t i = 0; i < n_workers; i++) { pthread_join(threads[i], NULL); }
+
+    if (token->s_token != RC_TOKEN_OK) { json->url_next_page = NULL; }
+
+    for (size_t i = 0; i < n_slots; i++) { RC_MEDIA_FREE(state.slots + i); }
+
+    pthread_mutex_destroy(&state.lock);
+    pthread_cond_destroy(&state.cond);
+    free(state.slots);
+    free(state.ready);
+    free(threads);
+    return n_workers > 0; // with no thread to fetch them, the page loop requests the pages itself
+
+}
+
+size_t rc_json_fan_out(BearerToken* token, JsonContent* json, JsonContent* parent,
+                       const char* url, size_t n_threads) {
+
+    long* ids = NULL;
+    size_t n_ids = 0;
+    size_t n_workers = 0;
+
+    n_threads = n_threads > 0 ? n_threads : FAN_THREADS;
+
+    if (!rc_fan_ids(parent, &ids, &n_ids)) { free(ids); return 1; }
+    if (n_threads > n_ids) { n_threads = n_ids; }
+
+    pthread_t* threads = calloc(n_threads ? n_threads : 1, sizeof(pthread_t));
+
+    FanState state = {
+
+        .token = token,
+        .url = url,
+        .ids = ids,
+        .children = malloc((n_ids + 1) * sizeof(JsonContent)),
+        .n_children = n_ids,
+        .next = 0,
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .n_failed = 0
+
+    };
+
+    if (state.children == NULL || threads == NULL) { free(state.children); free(threads); free(ids); return n_ids + 1; }
+
+    for (size_t i = 0; i < n_ids; i++)
+    { memcpy(state.children + i, RC_JSON_INIT(FAN_INIT_SIZE), sizeof(JsonContent)); }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    while (n_workers < n_threads && n_workers < n_ids) {
+
+        if (pthread_create(threads + n_workers, NULL, rc_fan_worker, &state) == 0) { n_workers++; }
+        else { break; }
+
+    }
+
+    if (n_workers == 0) { rc_fan_worker(&state); } // run on the calling thread instead
+    for (size_t i = 0; i < n_workers; i++) { pthread_join(threads[i], NULL); }
+
+    if (rc_fan_merge(json, ids, state.children, n_ids) == NULL) { state.n_failed = n_ids + 1; }
+
+    for (size_t i = 0; i < n_ids; i++) { RC_JSON_FREE(state.children + i); }
+
+    curl_global_cleanup();
+    pthread_mutex_destroy(&state.lock);
+    free(state.children);
+    free(threads);
+    free(ids);
+    return state.n_failed;
+
+}
@@ -0,0 +1,80 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_FAN_OUT_H
+#define RC_FAN_OUT_H
+
+#define FAN_THREADS 4
+#define FAN_WINDOW 2 // pages fetched ahead of the JsonContent, per thread
+#define FAN_INIT_SIZE (1 << 16)
+
+#include <stdbool.h>
+#include "json_content.h"
+
+/// @brief Fetch a templated endpoint once per record id of a parent response
+/// @param token pointer to a BearerToken (can be just a skeleton)
+/// @param json pointer to a JsonContent container for the combined output
+/// @param parent pointer to a JsonContent holding a list response,
+///        e.g. filled by rc_json_get_buffer with RC_GET_CALL_QUEUES
+///        (ids are only read from its buffer, so it should not have spilled)
+/// @param url child url template with one %li, e.g. RC_GET_CALL_QUEUE_MEMBERS
+/// @param n_threads number of concurrent requests (0 for default of 4)
+/// @return number of child requests that failed (0 on success); the first
+///         failure is reported through token, same as rc_json_get_buffer
+/// @note Children are fetched with their page loops and combined, in the
+///       order of the parent records, into a single response:
+///       {"records":[{"parentId":23450001, ...child record...}, ...]}
+/// @note Do not use the token from other threads until this function returns
+size_t rc_json_fan_out(BearerToken* token, JsonContent* json, JsonContent* parent,
+                       const char* url, size_t n_threads);
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief append the id of every record in a list response to an array
+/// @param parent pointer to a JsonContent holding a list response
+/// @param ids pointer to a (possibly NULL) array allocated by this function
+/// @param n_ids pointer to the number of ids in the array
+/// @return false if out of memory
+bool rc_fan_ids(const JsonContent* parent, long** ids, size_t* n_ids);
+
+/// @brief combine child responses into one response, tagging each record
+/// @param json pointer to a JsonContent container for the combined output
+/// @param ids parent id of each child response
+/// @param children array of child responses (empty ones are skipped)
+/// @param n number of child responses
+/// @return the combined buffer; NULL if out of memory
+const char* rc_fan_merge(JsonContent* json, const long* ids, const JsonContent* children, size_t n);
+
+/// @brief fetch the remaining pages of a numbered page loop concurrently
+/// @param token pointer to a BearerToken
+/// @param json pointer to a JsonContent holding the first page, closed by
+///        rc_curl_next_page (json->url_next_page is the url of page 2)
+/// @param n_total number of pages (paging.totalPages of the first page)
+/// @param n_threads number of concurrent requests (0 for default of 4)
+/// @return false if the pages could not be requested by number, so the page
+///         loop should go on as usual; true once pages 2 to n_total have been
+///         appended to json, in order, up to the first one that failed
+///         (reported through token)
+/// @note Pages are appended as soon as every page before them has been; at
+///       most n_threads * FAN_WINDOW pages are held in memory meanwhile
+/// @note json->url_next_page is left as the last page fetched sets it
+bool rc_fan_pages(BearerToken* token, JsonContent* json, size_t n_total, size_t n_threads);
+
+#endif // RINGEXTRACT_H
+
+#endif // RC_FAN_OUT_H
@@ -0,0 +1,725 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include "file_writer.h"
+#include "manifest.h"
+
+#define OP_DATA(KIND, INDEX) ((uint64_t)(INDEX) << 3 | (KIND))
+#define OP_KIND(DATA) ((int)((DATA) & 7))
+#define OP_INDEX(DATA) ((size_t)((DATA) >> 3))
+
+enum { OP_OPEN, OP_WRITE, OP_FSYNC, OP_CLOSE, OP_WAKE };
+
+typedef struct WriterChunk {
+
+    size_t index; // buffer index, also the registered buffer index
+    size_t n;
+    off_t offset;
+    struct WriterFile* file;
+    struct WriterChunk* next;
+
+} WriterChunk;
+
+typedef struct WriterFile {
+
+    size_t index;
+    char* path;
+    int fd;
+    int error; // errno of the first failure; 0 if the transfer failed first
+    char transfer[CURL_ERROR_SIZE / 2]; // error of a failed transfer, leaving room for the path in writer->error
+
+    bool in_use;
+    bool open_done;
+    bool opened;
+    bool closing;
+    bool syncing;
+    bool failed;
+
+    off_t offset; // of the next chunk handed off
+    size_t n_inflight;
+    WriterChunk* current; // being filled by the transfer
+    WriterChunk* pending; // handed off before the file was open
+    WriterChunk** pending_tail;
+
+} WriterFile;
+
+typedef struct WriterRing {
+
+    int fd;
+    unsigned n_unsubmitted;
+
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+
+    void* sq_ptr;
+    void* cq_ptr;
+    size_t sq_size;
+    size_t cq_size;
+    size_t sqes_size;
+
+} WriterRing;
+
+typedef struct WriterQueue {
+
+    uint64_t* ops;
+    size_t head;
+    size_t n_ops;
+    size_t size;
+    pthread_cond_t cond;
+
+} WriterQueue;
+
+// state passed to the write callback of one transfer
+typedef struct WriterCall {
+
+    FileWriter* writer;
+    WriterFile* file;
+    bool manifest;
+    Checksum checksum;
+
+} WriterCall;
+
+/** io_uring ring (raw system calls) **/
+
+static void rc_ring_free(WriterRing* ring) {
+
+    if (ring->sqes) { munmap(ring->sqes, ring->sqes_size); }
+    if (ring->cq_ptr && ring->cq_ptr != ring->sq_ptr) { munmap(ring->cq_ptr, ring->cq_size); }
+    if (ring->sq_ptr) { munmap(ring->sq_ptr, ring->sq_size); }
+
+    close(ring->fd);
+    free(ring);
+
+}
+
+static bool rc_ring_supported(int fd) {
+
+    const size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = calloc(1, size);
+    if (probe == NULL) { return false; }
+
+    const int ops[] = { IORING_OP_OPENAT, IORING_OP_WRITE_FIXED, IORING_OP_FSYNC, IORING_OP_CLOSE, IORING_OP_NOP };
+    bool supported = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+
+    for (size_t i = 0; supported && i < sizeof(ops) / sizeof(ops[0]); i++)
+    { supported = ops[i] <= probe->last_op && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED); }
+
+    free(probe);
+    return supported;
+
+}
+
+static WriterRing* rc_ring_init(unsigned entries, unsigned char* memory, size_t n_buffers, size_t buffer_size) {
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    const int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) { return NULL; }
+
+    WriterRing* ring = calloc(1, sizeof(WriterRing));
+    if (ring == NULL) { close(fd); return NULL; }
+
+    ring->fd = fd;
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && ring->cq_size > ring->sq_size) { ring->sq_size = ring->cq_size; }
+
+    const int prot = PROT_READ | PROT_WRITE;
+    const int flags = MAP_SHARED | MAP_POPULATE;
+
+    void* sq_ptr = mmap(NULL, ring->sq_size, prot, flags, fd, IORING_OFF_SQ_RING);
+    ring->sq_ptr = sq_ptr == MAP_FAILED ? NULL : sq_ptr;
+
+    void* cq_ptr = single ? ring->sq_ptr : mmap(NULL, ring->cq_size, prot, flags, fd, IORING_OFF_CQ_RING);
+    ring->cq_ptr = cq_ptr == MAP_FAILED ? NULL : cq_ptr;
+
+    void* sqes = mmap(NULL, ring->sqes_size, prot, flags, fd, IORING_OFF_SQES);
+    ring->sqes = sqes == MAP_FAILED ? NULL : sqes;
+
+    if (!ring->sq_ptr || !ring->cq_ptr || !ring->sqes || !rc_ring_supported(fd)) { rc_ring_free(ring); return NULL; }
+
+    unsigned char* sq = ring->sq_ptr;
+    unsigned char* cq = ring->cq_ptr;
+
+    ring->sq_tail  = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask  = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->cq_head  = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail  = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask  = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes     = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // pin the buffers once instead of mapping them on every write
+    struct iovec* iov = malloc(n_buffers * sizeof(struct iovec));
+    bool registered = iov != NULL;
+
+    for (size_t i = 0; registered && i < n_buffers; i++)
+    { iov[i] = (struct iovec){ .iov_base = memory + i * buffer_size, .iov_len = buffer_size }; }
+
+    registered = registered && syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iov, n_buffers) == 0;
+    free(iov);
+
+    if (registered) { return ring; }
+    else { rc_ring_free(ring); return NULL; }
+
+}
+
+/** Operations (lock held) **/
+
+static void rc_writer_complete(FileWriter* writer, int kind, size_t index, int result);
+
+static void rc_ring_submit(FileWriter* writer, int kind, size_t index) {
+
+    WriterRing* ring = writer->ring;
+    const unsigned tail = *ring->sq_tail;
+    const unsigned slot = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = ring->sqes + slot;
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->user_data = OP_DATA(kind, index);
+
+    if (kind == OP_WRITE) {
+
+        const WriterChunk* chunk = writer->chunks + index;
+
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->fd = chunk->file->fd;
+        sqe->addr = (uintptr_t)(writer->memory + index * writer->buffer_size);
+        sqe->len = chunk->n;
+        sqe->off = chunk->offset;
+        sqe->buf_index = index;
+
+    } else if (kind == OP_OPEN) {
+
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uintptr_t)writer->files[index].path;
+        sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        sqe->len = 0644;
+
+    } else if (kind == OP_FSYNC) {
+
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = writer->files[index].fd;
+
+    } else if (kind == OP_CLOSE) {
+
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = writer->files[index].fd;
+
+    } else { sqe->opcode = IORING_OP_NOP; }
+
+    ring->sq_array[slot] = slot;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->n_unsubmitted++;
+
+    // does not wait for the operation, only queues it with the kernel
+    const long submitted = syscall(__NR_io_uring_enter, ring->fd, ring->n_unsubmitted, 0, 0, NULL, 0);
+    if (submitted > 0) { ring->n_unsubmitted -= submitted; }
+
+}
+
+static void rc_writer_submit(FileWriter* writer, int kind, size_t index) {
+
+    if (writer->uring) { rc_ring_submit(writer, kind, index); return; }
+
+    WriterQueue* queue = writer->queue;
+    queue->ops[(queue->head + queue->n_ops++) % queue->size] = OP_DATA(kind, index);
+    pthread_cond_signal(&queue->cond);
+
+}
+
+static void rc_writer_release(FileWriter* writer, WriterChunk* chunk) {
+
+    chunk->next = writer->free_chunks;
+    writer->free_chunks = chunk;
+    pthread_cond_broadcast(&writer->cond);
+
+}
+
+static void rc_writer_fail(WriterFile* file, int error) {
+
+    if (!file->failed) { file->failed = true; file->error = error; }
+
+}
+
+static void rc_writer_finish(FileWriter* writer, WriterFile* file) {
+
+    if (file->failed) {
+
+        writer->n_failed++;
+        snprintf(writer->error, CURL_ERROR_SIZE, "%s: %s", file->path, file->error ? strerror(file->error) : file->transfer);
+
+    } else { writer->n_written++; }
+
+    free(file->path);
+    file->path = NULL;
+    file->in_use = false;
+    writer->n_open--;
+    pthread_cond_broadcast(&writer->cond);
+
+}
+
+// fsync once the transfer is done and every write has completed, then close; a failed file is only closed
+static void rc_writer_advance(FileWriter* writer, WriterFile* file) {
+
+    if (!file->closing || !file->open_done || file->n_inflight || file->pending || file->syncing) { return; }
+
+    if (file->opened) { file->syncing = true; rc_writer_submit(writer, file->failed ? OP_CLOSE : OP_FSYNC, file->index); }
+    else { rc_writer_finish(writer, file); }
+
+}
+
+static void rc_writer_complete(FileWriter* writer, int kind, size_t index, int result) {
+
+    WriterChunk* chunk = kind == OP_WRITE ? writer->chunks + index : NULL;
+    WriterFile* file = chunk ? chunk->file : writer->files + index;
+
+    switch (kind) {
+
+    case OP_OPEN:
+
+        file->open_done = true;
+
+        if (result >= 0) { file->fd = result; file->opened = true; }
+        else { rc_writer_fail(file, -result); }
+
+        while (file->pending) {
+
+            WriterChunk* next = file->pending->next;
+
+            if (file->opened && !file->failed) { file->n_inflight++; rc_writer_submit(writer, OP_WRITE, file->pending->index); }
+            else { rc_writer_release(writer, file->pending); }
+
+            file->pending = next;
+
+        }
+
+        file->pending_tail = &file->pending;
+        rc_writer_advance(writer, file);
+        break;
+
+    case OP_WRITE:
+
+        file->n_inflight--;
+
+        if (result < 0) { rc_writer_fail(file, -result); }
+        else if ((size_t)result != chunk->n) { rc_writer_fail(file, EIO); }
+
+        rc_writer_release(writer, chunk);
+        rc_writer_advance(writer, file);
+        break;
+
+    case OP_FSYNC:
+
+        if (result < 0) { rc_writer_fail(file, -result); }
+        rc_writer_submit(writer, OP_CLOSE, file->index);
+        break;
+
+    case OP_CLOSE:
+
+        if (result < 0) { rc_writer_fail(file, -result); }
+        rc_writer_finish(writer, file);
+        break;
+
+    }
+
+}
+
+/** Backends **/
+
+static void* rc_ring_reaper(void* userdata) {
+
+    FileWriter* writer = (FileWriter*)userdata;
+    WriterRing* ring = writer->ring;
+    bool done = false;
+
+    while (!done) {
+
+        syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+        pthread_mutex_lock(&writer->lock);
+
+        unsigned head = *ring->cq_head;
+        const unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; head++) {
+
+            const struct io_uring_cqe* cqe = ring->cqes + (head & *ring->cq_mask);
+            const uint64_t data = cqe->user_data;
+
+            if (OP_KIND(data) == OP_WAKE) { done = !writer->running; }
+            else { rc_writer_complete(writer, OP_KIND(data), OP_INDEX(data), cqe->res); }
+
+        }
+
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&writer->lock);
+
+    }
+
+    return NULL;
+
+}
+
+static int rc_writer_syscall(FileWriter* writer, int kind, size_t index) {
+
+    if (kind == OP_WRITE) {
+
+        const WriterChunk* chunk = writer->chunks + index;
+        const unsigned char* data = writer->memory + index * writer->buffer_size;
+        size_t n = 0;
+
+        while (n < chunk->n) {
+
+            const ssize_t written = pwrite(chunk->file->fd, data + n, chunk->n - n, chunk->offset + n);
+
+            if (written < 0 && errno == EINTR) { continue; }
+            if (written <= 0) { return written < 0 ? -errno : (int)n; }
+
+            n += written;
+
+        }
+
+        return (int)n;
+
+    }
+
+    const WriterFile* file = writer->files + index;
+    int result = 0;
+
+    if (kind == OP_OPEN) { result = open(file->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); }
+    else if (kind == OP_FSYNC) { result = fsync(file->fd); }
+    else if (kind == OP_CLOSE) { result = close(file->fd); }
+
+    return result < 0 ? -errno : result;
+
+}
+
+static void* rc_writer_worker(void* userdata) {
+
+    FileWriter* writer = (FileWriter*)userdata;
+    WriterQueue* queue = writer->queue;
+
+    pthread_mutex_lock(&writer->lock);
+
+    while (true) {
+
+        while (queue->n_ops == 0 && writer->running) { pthread_cond_wait(&queue->cond, &writer->lock); }
+        if (queue->n_ops == 0) { break; }
+
+        const uint64_t data = queue->ops[queue->head];
+        queue->head = (queue->head + 1) % queue->size;
+        queue->n_ops--;
+
+        pthread_mutex_unlock(&writer->lock);
+        const int result = rc_writer_syscall(writer, OP_KIND(data), OP_INDEX(data));
+        pthread_mutex_lock(&writer->lock);
+
+        rc_writer_complete(writer, OP_KIND(data), OP_INDEX(data), result);
+
+    }
+
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+
+}
+
+/** Transfer side **/
+
+static WriterFile* rc_writer_open(FileWriter* writer, const char* path) {
+
+    char* copy = malloc(strlen(path) + 1);
+    if (copy == NULL) { return NULL; }
+
+    strcpy(copy, path);
+    pthread_mutex_lock(&writer->lock);
+
+    while (writer->n_open == WRITER_FILES) { pthread_cond_wait(&writer->cond, &writer->lock); }
+
+    WriterFile* file = writer->files;
+    while (file->in_use) { file++; }
+
+    *file = (WriterFile){ .index = file->index, .path = copy, .fd = -1, .in_use = true };
+    file->pending_tail = &file->pending;
+    writer->n_open++;
+
+    rc_writer_submit(writer, OP_OPEN, file->index);
+    pthread_mutex_unlock(&writer->lock);
+    return file;
+
+}
+
+static void rc_writer_handoff(FileWriter* writer, WriterFile* file) {
+
+    WriterChunk* chunk = file->current;
+    file->current = NULL;
+
+    chunk->offset = file->offset;
+    file->offset += chunk->n;
+
+    if (file->failed) { rc_writer_release(writer, chunk); }
+    else if (file->opened) { file->n_inflight++; rc_writer_submit(writer, OP_WRITE, chunk->index); }
+    else { chunk->next = NULL; *file->pending_tail = chunk; file->pending_tail = &chunk->next; }
+
+}
+
+static void rc_writer_close(FileWriter* writer, WriterFile* file, const BearerToken* token) {
+
+    pthread_mutex_lock(&writer->lock);
+
+    // the partial file is left behind, as rc_media_get_file leaves it, but not counted as written
+    if (token->s_token != RC_TOKEN_OK && !file->failed) {
+
+        if (token->error[0]) { memcpy(file->transfer, token->error, sizeof(file->transfer) - 1); } // zeroed by rc_writer_open
+        else { snprintf(file->transfer, sizeof(file->transfer), "HTTP status %ld", token->status); }
+
+        rc_writer_fail(file, 0);
+
+    }
+
+    if (file->current && file->current->n) { rc_writer_handoff(writer, file); }
+    else if (file->current) { rc_writer_release(writer, file->current); file->current = NULL; }
+
+    file->closing = true;
+    rc_writer_advance(writer, file);
+    pthread_mutex_unlock(&writer->lock);
+
+}
+
+static size_t rc_curl_write_file(char* contents, size_t size, size_t nitems, void* userdata) {
+
+    WriterCall* call = (WriterCall*)userdata;
+    FileWriter* writer = call->writer;
+    WriterFile* file = call->file;
+    const size_t n = size * nitems;
+
+    for (size_t left = n; left; ) {
+
+        if (file->current == NULL) {
+
+            // the only place the transfer waits: every buffer is queued for the disk
+            pthread_mutex_lock(&writer->lock);
+            while (writer->free_chunks == NULL && !file->failed) { pthread_cond_wait(&writer->cond, &writer->lock); }
+
+            if (file->failed) { pthread_mutex_unlock(&writer->lock); return 0; }
+
+            file->current = writer->free_chunks;
+            writer->free_chunks = file->current->next;
+            pthread_mutex_unlock(&writer->lock);
+
+            file->current->file = file;
+            file->current->n = 0;
+
+        }
+
+        WriterChunk* chunk = file->current;
+        const size_t room = writer->buffer_size - chunk->n;
+        const size_t bytes = left < room ? left : room;
+
+        memcpy(writer->memory + chunk->index * writer->buffer_size + chunk->n, contents + (n - left), bytes);
+        chunk->n += bytes;
+        left -= bytes;
+
+        if (chunk->n == writer->buffer_size) {
+
+            pthread_mutex_lock(&writer->lock);
+            rc_writer_handoff(writer, file);
+            pthread_mutex_unlock(&writer->lock);
+
+        }
+
+    }
+
+    if (call->manifest) { rc_checksum_update(&call->checksum, contents, n); }
+    return n;
+
+}
+
+const char* rc_writer_get_file(FileWriter* writer, BearerToken* token, CURL* curl,
+                               const char* file, const char* url) {
+
+    WriterCall call = { .writer = writer, .file = rc_writer_open(writer, file) };
+    if (call.file == NULL) { return NULL; }
+
+    call.manifest = rc_manifest_enabled();
+    if (call.manifest) { rc_checksum_init(&call.checksum); }
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, rc_curl_write_file);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &call);
+
+    rc_curl_auto_perform(token, curl);
+    rc_writer_close(writer, call.file, token);
+
+    if (call.manifest && token->s_token == RC_TOKEN_OK) { rc_manifest_append(file, &call.checksum, url, curl); }
+    return file;
+
+}
+
+/** Public **/
+
+FileWriter* rc_writer_init(size_t n_buffers, size_t buffer_size, WriterBackend backend) {
+
+    FileWriter* writer = calloc(1, sizeof(FileWriter));
+    if (writer == NULL) { return NULL; }
+
+    writer->n_buffers = n_buffers > 0 ? n_buffers : WRITER_BUFFERS;
+    writer->buffer_size = buffer_size > 0 ? (buffer_size + 4095) / 4096 * 4096 : WRITER_BUFFER_SIZE;
+    writer->running = true;
+
+    writer->memory = aligned_alloc(4096, writer->n_buffers * writer->buffer_size);
+    writer->chunks = calloc(writer->n_buffers, sizeof(WriterChunk));
+    writer->files = calloc(WRITER_FILES, sizeof(WriterFile));
+
+    if (!writer->memory || !writer->chunks || !writer->files) {
+
+        free(writer->memory);
+        free(writer->chunks);
+        free(writer->files);
+        free(writer);
+        return NULL;
+
+    }
+
+    for (size_t i = writer->n_buffers; i-- > 0; ) {
+
+        writer->chunks[i].index = i;
+        writer->chunks[i].next = writer->free_chunks;
+        writer->free_chunks = writer->chunks + i;
+
+    }
+
+    for (size_t i = 0; i < WRITER_FILES; i++) { writer->files[i].index = i; }
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->cond, NULL);
+
+    // every buffer and file can have one operation in flight, plus the wake-up
+    const size_t n_ops = writer->n_buffers + WRITER_FILES + 1;
+
+    if (backend == RC_WRITER_AUTO) {
+
+        unsigned entries = 1;
+        while (entries < n_ops) { entries <<= 1; }
+
+        writer->ring = rc_ring_init(entries, writer->memory, writer->n_buffers, writer->buffer_size);
+        writer->uring = writer->ring && pthread_create(writer->threads, NULL, rc_ring_reaper, writer) == 0;
+
+        if (writer->uring) { writer->n_threads = 1; return writer; }
+        if (writer->ring) { rc_ring_free(writer->ring); writer->ring = NULL; }
+
+    }
+
+    writer->queue = calloc(1, sizeof(WriterQueue));
+    if (writer->queue) { writer->queue->ops = malloc(n_ops * sizeof(uint64_t)); }
+
+    if (writer->queue && writer->queue->ops) {
+
+        writer->queue->size = n_ops;
+        pthread_cond_init(&writer->queue->cond, NULL);
+
+        for (size_t i = 0; i < WRITER_THREADS; i++)
+        { if (pthread_create(writer->threads + writer->n_threads, NULL, rc_writer_worker, writer) == 0) { writer->n_threads++; } }
+
+        if (writer->n_threads) { return writer; }
+        pthread_cond_destroy(&writer->queue->cond);
+
+    }
+
+    if (writer->queue) { free(writer->queue->ops); }
+    free(writer->queue);
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer->memory);
+    free(writer->chunks);
+    free(writer->files);
+    free(writer);
+    return NULL;
+
+}
+
+void rc_writer_attach(FileWriter* writer, BearerToken* token) { token->writer = writer; }
+
+size_t rc_writer_flush(FileWriter* writer) {
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->n_open) { pthread_cond_wait(&writer->cond, &writer->lock); }
+
+    const size_t n_failed = writer->n_failed;
+    pthread_mutex_unlock(&writer->lock);
+    return n_failed;
+
+}
+
+void rc_writer_free(FileWriter* writer) {
+
+    rc_writer_flush(writer);
+
+    pthread_mutex_lock(&writer->lock);
+    writer->running = false;
+
+    if (writer->uring) { rc_writer_submit(writer, OP_WAKE, 0); }
+    else { pthread_cond_broadcast(&writer->queue->cond); }
+
+    pthread_mutex_unlock(&writer->lock);
+
+    for (size_t i = 0; i < writer->n_threads; i++) { pthread_join(writer->threads[i], NULL); }
+
+    if (writer->ring) { rc_ring_free(writer->ring); }
+
+    if (writer->queue) {
+
+        pthread_cond_destroy(&writer->queue->cond);
+        free(writer->queue->ops);
+        free(writer->queue);
+
+    }
+
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer->memory);
+    free(writer->chunks);
+    free(writer->files);
+    free(writer);
+
+}
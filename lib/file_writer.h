@@ -0,0 +1,132 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_FILE_WRITER_H
+#define RC_FILE_WRITER_H
+
+#define WRITER_BUFFERS 64
+#define WRITER_BUFFER_SIZE (256 << 10)
+#define WRITER_FILES 32
+#define WRITER_THREADS 4
+
+#include <pthread.h>
+#include <stdbool.h>
+#include "bearer_token.h"
+
+typedef enum { RC_WRITER_AUTO, RC_WRITER_THREADS } WriterBackend;
+
+/**
+ * Asynchronous file writer for high-volume media downloads
+ *
+ * rc_media_get_file normally writes through stdio on the transferring
+ * thread, so every disk stall stalls the download. Once a FileWriter is
+ * attached to a token, rc_media_get_file copies each chunk into one of a
+ * fixed set of buffers and hands full buffers off; file creation, writes,
+ * fsync and close are carried out in the background, in that order, for
+ * every file. The network side only waits when every buffer is still
+ * queued for the disk (or every file slot is busy), which bounds memory.
+ *
+ * The backend is io_uring (raw system calls, no liburing): buffers are
+ * registered with the ring once and written with IORING_OP_WRITE_FIXED.
+ * Where io_uring is unavailable (old kernel, seccomp, io_uring_disabled),
+ * a pool of WRITER_THREADS threads issues the same operations with
+ * ordinary system calls. Registering pins every buffer against
+ * RLIMIT_MEMLOCK: the default 64 x 256 KiB (16 MiB) is more than many
+ * systems allow without CAP_IPC_LOCK, and the writer then also falls back
+ * to the thread pool. writer->uring tells which backend is in use; raise
+ * the limit (ulimit -l) or pass fewer/smaller buffers to keep io_uring.
+ *
+ * FileWriter* writer = rc_writer_init(0, 0, RC_WRITER_AUTO);
+ * rc_writer_attach(writer, token);
+ * for (...) { rc_media_get_file(token, file, url); }
+ * size_t n_failed = rc_writer_flush(writer); // wait for the disk
+ * rc_writer_free(writer);
+ *
+ * - rc_media_get_file returns once its last buffer has been handed off;
+ *   files that could not be written, or whose transfer failed, are counted
+ *   by rc_writer_flush (not in n_written), and the last failure is
+ *   described in writer->error. The partial file of a failed transfer is
+ *   closed without fsync and left in place, as without a writer
+ * - The writer is thread-safe: tokens forked for other threads (fan-out,
+ *   job runner) share it
+ */
+typedef struct FileWriter {
+
+    bool uring; // false: thread-pool backend
+    bool running;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond; // a buffer or file slot was released
+    pthread_t threads[WRITER_THREADS];
+    size_t n_threads;
+
+    struct WriterRing* ring;
+    struct WriterQueue* queue;
+
+    unsigned char* memory; // n_buffers * buffer_size, registered with the ring
+    struct WriterChunk* chunks;
+    struct WriterChunk* free_chunks;
+    size_t n_buffers;
+    size_t buffer_size;
+
+    struct WriterFile* files;
+    size_t n_open;
+
+    size_t n_written;
+    size_t n_failed;
+    char error[CURL_ERROR_SIZE];
+
+} FileWriter;
+
+/// @brief Create a file writer
+/// @param n_buffers number of write buffers (0 for default of 64)
+/// @param buffer_size bytes per buffer (0 for default of 256 KiB)
+/// @param backend RC_WRITER_AUTO for io_uring when available, RC_WRITER_THREADS
+///        for the thread pool
+/// @return a pointer to the writer; NULL if it could not be created
+FileWriter* rc_writer_init(size_t n_buffers, size_t buffer_size, WriterBackend backend);
+
+/// @brief Make rc_media_get_file write through the writer
+/// @param writer pointer to a FileWriter (NULL to detach)
+/// @param token pointer to a BearerToken (can be just a skeleton)
+void rc_writer_attach(FileWriter* writer, BearerToken* token);
+
+/// @brief Wait until every file handed to the writer has been written and closed
+/// @param writer pointer to a FileWriter
+/// @return number of files that could not be written, or whose transfer failed, so far
+size_t rc_writer_flush(FileWriter* writer);
+
+/// @brief Flush and free the writer
+/// @param writer pointer to a FileWriter
+void rc_writer_free(FileWriter* writer);
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief download a url into a file through the writer, same as rc_media_get_file
+/// @param writer pointer to a FileWriter
+/// @param token pointer to a BearerToken
+/// @param curl a CURL handle
+/// @param file full path & file name to be written
+/// @param url full url
+/// @return the file name once handed off; NULL if no file could be started
+const char* rc_writer_get_file(FileWriter* writer, BearerToken* token, CURL* curl,
+                               const char* file, const char* url);
+
+#endif // RINGEXTRACT_H
+
+#endif // RC_FILE_WRITER_H
@@ -0,0 +1,481 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "fleet_runner.h"
+#include "json_content.h"
+#include "rate_limiter.h"
+#include "tracer.h"
+
+#define MUL(X, Y) (((X) / (Y) + 1) * (Y))
+
+#define FLEET_INIT_SIZE 16
+#define FLEET_JSON_SIZE (1 << 16)
+#define FLEET_BASE_LIMIT 50 // requests per window of the Light usage group
+#define FLEET_NEVER UINT64_MAX
+
+typedef struct {
+
+    CURL* curl;
+    size_t task;  // next task of the account
+    bool started; // page loop of the task in progress
+    bool busy;    // a thread is fetching a page for the account
+
+    long deficit;
+    long cost;
+    uint64_t blocked_until;
+
+    uint64_t attempt;
+    uint64_t timeout;
+
+    // outcome of the last page, applied with the lock held
+    unsigned int delay;
+    bool finished;
+
+} FleetSlot;
+
+typedef struct {
+
+    FleetRunner* fleet;
+    FleetSlot* slots;
+    JsonContent* results;
+
+    size_t cursor;
+    size_t n_left; // tasks not yet completed
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+
+} FleetState;
+
+static inline uint64_t rc_fleet_clock(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+
+}
+
+static const char* rc_fleet_fail(FleetRunner* fleet, const char* message, const char* detail) {
+
+    snprintf(fleet->error, CURL_ERROR_SIZE, "%s: %s", message, detail);
+    return NULL;
+
+}
+
+static FleetAccount* rc_fleet_find(FleetRunner* fleet, const char* name) {
+
+    for (size_t i = 0; i < fleet->n_accounts; i++)
+    { if (strcmp(fleet->accounts[i].name, name) == 0) { return fleet->accounts + i; } }
+
+    return NULL;
+
+}
+
+const char* rc_fleet_account(FleetRunner* fleet, const char* name, BearerToken* token) {
+
+    if (rc_fleet_find(fleet, name)) { return rc_fleet_fail(fleet, "Duplicate account", name); }
+
+    if (fleet->n_accounts == fleet->total_size) {
+
+        const size_t total_size = MUL(fleet->n_accounts, FLEET_INIT_SIZE);
+        FleetAccount* accounts = realloc(fleet->accounts, total_size * sizeof(FleetAccount));
+
+        if (accounts) { fleet->accounts = accounts; fleet->total_size = total_size; }
+        else { return rc_fleet_fail(fleet, "Out of memory", name); }
+
+    }
+
+    FleetAccount* account = fleet->accounts + fleet->n_accounts;
+    memset(account, 0, sizeof(FleetAccount));
+
+    account->name = strdup(name);
+    account->token = token;
+    account->s_token = RC_TOKEN_UNINITIALIZED;
+
+    if (account->name == NULL) { return rc_fleet_fail(fleet, "Out of memory", name); }
+
+    fleet->n_accounts++;
+    return name;
+
+}
+
+const char* rc_fleet_add(FleetRunner* fleet, const char* name, const char* url, const char* output) {
+
+    FleetAccount* account = rc_fleet_find(fleet, name);
+    if (account == NULL) { return rc_fleet_fail(fleet, "Unknown account", name); }
+
+    if (output && strcmp(output, "-") == 0) { output = NULL; }
+
+    if (account->n_tasks == account->total_size) {
+
+        const size_t total_size = MUL(account->n_tasks, FLEET_INIT_SIZE);
+        FleetTask* tasks = realloc(account->tasks, total_size * sizeof(FleetTask));
+
+        if (tasks) { account->tasks = tasks; account->total_size = total_size; }
+        else { return rc_fleet_fail(fleet, "Out of memory", name); }
+
+    }
+
+    FleetTask* task = account->tasks + account->n_tasks;
+    task->url = strdup(url);
+    task->output = output ? strdup(output) : NULL;
+
+    if (task->url == NULL || (output && task->output == NULL)) {
+
+        free(task->url);
+        free(task->output);
+        return rc_fleet_fail(fleet, "Out of memory", name);
+
+    }
+
+    account->n_tasks++;
+    return name;
+
+}
+
+void rc_fleet_free(FleetRunner* fleet) {
+
+    for (size_t i = 0; i < fleet->n_accounts; i++) {
+
+        FleetAccount* account = fleet->accounts + i;
+
+        for (size_t j = 0; j < account->n_tasks; j++) {
+
+            free(account->tasks[j].url);
+            free(account->tasks[j].output);
+
+        }
+
+        free(account->tasks);
+        free(account->name);
+
+    }
+
+    free(fleet->accounts);
+    fleet->accounts = NULL;
+    fleet->n_accounts = 0;
+    fleet->total_size = 0;
+
+}
+
+// cost of a page in request slots, from the rate limit of its usage group
+static long rc_fleet_cost(CURL* curl) {
+
+    struct curl_header* header;
+    long limit = 0;
+
+    if (curl_easy_header(curl, "x-rate-limit-limit", 0, CURLH_HEADER, 0, &header) == CURLHE_OK)
+    { limit = strtol(header->value, NULL, 10); }
+
+    return limit > 0 && limit < FLEET_BASE_LIMIT ? FLEET_BASE_LIMIT / limit : 1;
+
+}
+
+static void rc_fleet_task_failed(FleetAccount* account, FleetSlot* slot, TokenError s_token, const char* error) {
+
+    if (account->n_failed++ == 0) {
+
+        account->s_token = s_token;
+        snprintf(account->error, CURL_ERROR_SIZE, "%s", error);
+
+    }
+
+    slot->finished = true;
+
+}
+
+// fetch one page of the account's current task; called without the lock held
+static void rc_fleet_page(FleetAccount* account, FleetSlot* slot, JsonContent* json) {
+
+    const FleetTask* task = account->tasks + slot->task;
+    BearerToken* token = account->token;
+
+    slot->delay = 0;
+    slot->finished = false;
+
+    if (slot->curl == NULL) { rc_fleet_task_failed(account, slot, RC_CURL_INIT_FAILED, "CURL initialization failed."); return; }
+
+    if (!slot->started) {
+
+        rc_json_reset(json);
+
+        curl_easy_setopt(slot->curl, CURLOPT_URL, task->url);
+        curl_easy_setopt(slot->curl, CURLOPT_WRITEFUNCTION, rc_curl_write_json);
+        curl_easy_setopt(slot->curl, CURLOPT_WRITEDATA, json);
+
+        slot->attempt = MAX_RETRY_ATTEMPT;
+        slot->timeout = MIN_RETRY_TIMEOUT;
+        slot->started = true;
+
+    }
+
+    if (rc_curl_set_token(token, slot->curl) != RC_TOKEN_OK) {
+
+        rc_curl_set_error(token);
+        rc_fleet_task_failed(account, slot, token->s_token, token->error);
+        return;
+
+    }
+
+    const uint64_t start = rc_trace_clock();
+    CURLcode result = token->pool ? rc_pool_perform(token->pool, slot->curl) : curl_easy_perform(slot->curl);
+    rc_trace_transfer(slot->curl, start);
+
+    // the account is set aside for the delay instead of sleeping on it
+    switch (rc_curl_check_limit(slot->curl, result, &slot->timeout, &slot->delay)) {
+
+    case RC_LIMIT_DONE:
+        slot->cost = rc_fleet_cost(slot->curl);
+        account->n_pages++;
+        rc_curl_next_page(json);
+        break;
+
+    case RC_LIMIT_RETRY:
+        slot->cost = rc_fleet_cost(slot->curl);
+        account->n_throttled++;
+        if (slot->attempt--) { return; }
+        rc_fleet_task_failed(account, slot, RC_CURL_TRANSFER_FAILED, token->error);
+        return;
+
+    default:
+        rc_fleet_task_failed(account, slot, RC_CURL_TRANSFER_FAILED, token->error);
+        return;
+
+    }
+
+    if (json->url_next_page) {
+
+        curl_easy_setopt(slot->curl, CURLOPT_URL, json->url_next_page);
+        slot->attempt = MAX_RETRY_ATTEMPT;
+        slot->timeout = MIN_RETRY_TIMEOUT;
+        return;
+
+    }
+
+    slot->finished = true;
+
+    if (task->output && rc_json_fwrite(json, task->output) == NULL) {
+
+        char error[CURL_ERROR_SIZE];
+        snprintf(error, CURL_ERROR_SIZE, "FILE error: %.200s", task->output);
+        rc_fleet_task_failed(account, slot, RC_CURL_TRANSFER_FAILED, error);
+
+    }
+
+}
+
+// the following functions must be called with state->lock held
+
+static inline bool rc_fleet_ready(const FleetState* state, size_t index, uint64_t now) {
+
+    const FleetSlot* slot = state->slots + index;
+    const FleetAccount* account = state->fleet->accounts + index;
+
+    return slot->task < account->n_tasks && !slot->busy && slot->blocked_until <= now;
+
+}
+
+// deficit round-robin over the accounts that can send a request now
+static FleetSlot* rc_fleet_pick(FleetState* state, uint64_t now, uint64_t* wake) {
+
+    const size_t n = state->fleet->n_accounts;
+    bool ready = false;
+    *wake = FLEET_NEVER;
+
+    for (size_t i = 0; i < n; i++) {
+
+        const FleetSlot* slot = state->slots + i;
+
+        if (rc_fleet_ready(state, i, now)) { ready = true; }
+        else if (slot->task < state->fleet->accounts[i].n_tasks && !slot->busy && slot->blocked_until < *wake)
+        { *wake = slot->blocked_until; }
+
+    }
+
+    if (!ready) { return NULL; }
+
+    while (true) {
+
+        FleetSlot* slot = state->slots + state->cursor;
+
+        if (rc_fleet_ready(state, state->cursor, now)) {
+
+            if (slot->deficit >= slot->cost) { slot->deficit -= slot->cost; return slot; }
+            else { slot->deficit += FLEET_QUANTUM; }
+
+        }
+
+        state->cursor = (state->cursor + 1) % n;
+
+    }
+
+}
+
+static void rc_fleet_apply(FleetState* state, FleetSlot* slot) {
+
+    slot->busy = false;
+    slot->blocked_until = slot->delay ? rc_fleet_clock() + (uint64_t)slot->delay * 1000 : 0;
+
+    if (slot->finished) {
+
+        slot->task++;
+        slot->started = false;
+        state->n_left--;
+
+        // an idle account does not keep its deficit (standard DRR)
+        if (slot->task == state->fleet->accounts[slot - state->slots].n_tasks) { slot->deficit = 0; }
+
+    }
+
+    pthread_cond_broadcast(&state->ready);
+
+}
+
+static void* rc_fleet_worker(void* userdata) {
+
+    FleetState* state = (FleetState*)userdata;
+    uint64_t wake = FLEET_NEVER;
+
+    pthread_mutex_lock(&state->lock);
+
+    while (state->n_left > 0) {
+
+        FleetSlot* slot = rc_fleet_pick(state, rc_fleet_clock(), &wake);
+
+        if (slot) {
+
+            const size_t index = slot - state->slots;
+            slot->busy = true;
+            pthread_mutex_unlock(&state->lock);
+
+            rc_fleet_page(state->fleet->accounts + index, slot, state->results + index);
+
+            pthread_mutex_lock(&state->lock);
+            rc_fleet_apply(state, slot);
+
+        } else if (wake == FLEET_NEVER) { pthread_cond_wait(&state->ready, &state->lock); }
+        else {
+
+            const struct timespec until = { .tv_sec = wake / 1000, .tv_nsec = (wake % 1000) * 1000000 };
+            pthread_cond_timedwait(&state->ready, &state->lock, &until);
+
+        }
+
+    }
+
+    pthread_mutex_unlock(&state->lock);
+    return NULL;
+
+}
+
+size_t rc_fleet_run(FleetRunner* fleet, HttpPool* pool) {
+
+    const size_t n = fleet->n_accounts;
+    size_t n_failed = 0;
+    size_t n_threads = 0;
+    pthread_t* threads = calloc((fleet->n_threads < n ? fleet->n_threads : n) + 1, sizeof(pthread_t)); // no more threads than accounts
+    struct HttpPool** pools = malloc((n + 1) * sizeof(struct HttpPool*));
+    pthread_condattr_t attr;
+
+    FleetState state = {
+
+        .fleet = fleet,
+        .slots = calloc(n + 1, sizeof(FleetSlot)),
+        .results = malloc((n + 1) * sizeof(JsonContent)),
+        .cursor = 0,
+        .n_left = 0,
+        .lock = PTHREAD_MUTEX_INITIALIZER
+
+    };
+
+    if (state.slots == NULL || state.results == NULL || threads == NULL || pools == NULL) {
+
+        free(state.slots);
+        free(state.results);
+        free(threads);
+        free(pools);
+        rc_fleet_fail(fleet, "Out of memory", "fleet state");
+        return n;
+
+    }
+
+    // timed waits on blocked accounts use the same clock as blocked_until
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&state.ready, &attr);
+    pthread_condattr_destroy(&attr);
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    for (size_t i = 0; i < n; i++) {
+
+        FleetAccount* account = fleet->accounts + i;
+
+        account->n_pages = 0;
+        account->n_throttled = 0;
+        account->n_failed = 0;
+        account->s_token = RC_TOKEN_OK;
+        memset(account->error, 0, CURL_ERROR_SIZE);
+
+        pools[i] = account->token->pool;
+        if (pool) { account->token->pool = pool; }
+
+        memcpy(state.results + i, RC_JSON_INIT(FLEET_JSON_SIZE), sizeof(JsonContent));
+        state.slots[i].curl = curl_easy_init();
+        state.slots[i].cost = 1;
+        state.n_left += account->n_tasks;
+
+    }
+
+    while (n_threads < fleet->n_threads && n_threads < n) {
+
+        if (pthread_create(threads + n_threads, NULL, rc_fleet_worker, &state) == 0) { n_threads++; }
+        else { break; }
+
+    }
+
+    if (n_threads == 0) { rc_fleet_worker(&state); } // run on the calling thread instead
+    for (size_t i = 0; i < n_threads; i++) { pthread_join(threads[i], NULL); }
+
+    for (size_t i = 0; i < n; i++) {
+
+        fleet->accounts[i].token->pool = pools[i];
+        n_failed += fleet->accounts[i].n_failed;
+
+        curl_easy_cleanup(state.slots[i].curl);
+        RC_JSON_FREE(state.results + i);
+
+    }
+
+    free(state.slots);
+    free(state.results);
+    free(threads);
+    free(pools);
+    pthread_mutex_destroy(&state.lock);
+    pthread_cond_destroy(&state.ready);
+    curl_global_cleanup();
+    return n_failed;
+
+}
@@ -0,0 +1,158 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_FLEET_RUNNER_H
+#define RC_FLEET_RUNNER_H
+
+#define FLEET_THREADS 8
+#define FLEET_QUANTUM 5
+
+#include <stdbool.h>
+#include "bearer_token.h"
+#include "http_pool.h"
+
+/**
+ * Multi-account extraction runner
+ *
+ * Each account has its own BearerToken (credentials) and its own list of
+ * endpoints to extract, and the server rate-limits each account on its own.
+ * rc_fleet_run interleaves the page loops of all accounts on a pool of
+ * threads, one page at a time, instead of running accounts one after
+ * another:
+ *
+ * - Each account has at most one request in flight, so its own rate limits
+ *   apply as if it ran alone
+ * - A throttled account (429/503, or an exhausted rate limit window) is set
+ *   aside until its wait is over, and its thread moves on to other accounts
+ *   instead of sleeping
+ * - Accounts are picked by deficit round-robin: every round adds a quantum
+ *   of FLEET_QUANTUM to an account's deficit, and each page costs in
+ *   proportion to the rate limit of its usage group (1 for Light/Medium,
+ *   5 for Heavy), so each account gets a fair share of request slots
+ *
+ * FleetRunner* fleet = RC_FLEET_INIT(0);
+ * rc_fleet_account(fleet, "acme", RC_TOKEN_CREDENTIALS(id, secret, jwt));
+ * rc_fleet_add(fleet, "acme", RC_GET_CALL_LOG, "acme_calls.json");
+ * ...
+ * rc_fleet_run(fleet, pool); // pool may be NULL
+ * RC_FLEET_FREE(fleet);
+ */
+
+typedef struct {
+
+    char* url;
+    char* output;
+
+} FleetTask;
+
+/**
+ * A single account and its endpoints
+ * Status members are written by rc_fleet_run
+ */
+typedef struct {
+
+    char* name;
+    BearerToken* token;
+
+    FleetTask* tasks;
+    size_t n_tasks;
+    size_t total_size;
+
+    size_t n_pages;
+    size_t n_throttled;
+    size_t n_failed;
+
+    TokenError s_token;
+    char error[CURL_ERROR_SIZE];
+
+} FleetAccount;
+
+/**
+ * Container struct for a set of accounts and the thread pool size
+ * Can be run repeatedly; status of each account is reset on every run
+ *
+ * -- Declaration & Initialization --
+ * RIGHT: FleetRunner* fleet = RC_FLEET_INIT(0);
+ * WRONG: FleetRunner* fleet; // this will cause a crash later.
+ *
+ * -- Freeing Memory --
+ * RIGHT: RC_FLEET_FREE(fleet);
+ *
+ * - Do not assume/directly modify its member variables
+ * - Must be freed with RC_FLEET_FREE when done
+ */
+typedef struct {
+
+    FleetAccount* accounts;
+    size_t n_accounts;
+    size_t total_size;
+
+    const size_t n_threads;
+    char error[CURL_ERROR_SIZE];
+
+} FleetRunner;
+
+/// @brief Add an account
+/// @param fleet pointer to a FleetRunner container
+/// @param name unique account name
+/// @param token pointer to a BearerToken with the account's credentials,
+///        e.g. RC_TOKEN_CREDENTIALS(id, secret, jwt); must outlive the fleet
+/// @return if added successfully, the account name (same as the name argument);
+///         otherwise, NULL and the reason is written to fleet->error
+const char* rc_fleet_account(FleetRunner* fleet, const char* name, BearerToken* token);
+
+/// @brief Add an endpoint to extract for an account
+/// @param fleet pointer to a FleetRunner container
+/// @param name name of a previously added account
+/// @param url full url (with its page loop)
+/// @param output file name; NULL or "-" to skip writing
+/// @return if added successfully, the account name (same as the name argument);
+///         otherwise, NULL and the reason is written to fleet->error
+const char* rc_fleet_add(FleetRunner* fleet, const char* name, const char* url, const char* output);
+
+/// @brief Extract all endpoints of all accounts and wait for them to complete
+/// @param fleet pointer to a FleetRunner container
+/// @param pool pointer to an HttpPool shared by all accounts for the run (NULL if none)
+/// @return number of endpoints that failed (0 on success); see n_failed,
+///         s_token and error of each account for details
+/// @note Do not use the accounts' tokens elsewhere while the fleet is running
+size_t rc_fleet_run(FleetRunner* fleet, HttpPool* pool);
+
+/// @brief Free all accounts of a fleet (not their tokens)
+/// @param fleet pointer to a FleetRunner container
+void rc_fleet_free(FleetRunner* fleet);
+
+/// @brief Create and initialize a FleetRunner container on the stack
+/// @param X number of threads (default is 8)
+/// @return a pointer to the initialized FleetRunner
+/// @note To accept default number of threads (8), pass in 0;
+///       Otherwise, pass in the desired number of threads as a size_t
+#define RC_FLEET_INIT(X) &(FleetRunner)       \
+{                                             \
+    .accounts = NULL,                         \
+    .n_accounts = 0,                          \
+    .total_size = 0,                          \
+    .n_threads = X > 0 ? X : FLEET_THREADS,   \
+    .error = {0}                              \
+}
+
+/// @brief Free a FleetRunner's accounts
+/// @param X pointer to a FleetRunner container
+#define RC_FLEET_FREE(X) rc_fleet_free(X)
+
+#endif // RC_FLEET_RUNNER_H
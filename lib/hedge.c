@@ -0,0 +1,392 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hedge.h"
+#include "http_pool.h"
+#include "shared_limiter.h"
+#include "endpoint.h"
+
+#define HEDGE_POLL_MS 1000
+
+typedef struct HedgeEndpoint {
+
+    uint64_t hash; // rc_endpoint_hash; 0 for a free slot
+    uint32_t samples[HEDGE_SAMPLES]; // ms until the response started, the last HEDGE_SAMPLES kept
+    size_t n_samples;
+    long long remaining; // X-Rate-Limit-Remaining of the last response; -1 if unknown
+
+} HedgeEndpoint;
+
+typedef struct HedgeRace {
+
+    CURL* winner;     // first handle to receive a response header
+    int64_t start;
+    int64_t answered; // ms from start until the winner's first header
+
+} HedgeRace;
+
+typedef struct HedgeLeg {
+
+    HedgeRace* race;
+    CURL* curl;
+    bool running;
+    CURLcode result;
+    char error[CURL_ERROR_SIZE];
+
+} HedgeLeg;
+
+static inline int64_t rc_hedge_now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+}
+
+static void rc_hedge_lock(CURL* curl, curl_lock_data data, curl_lock_access access, void* userdata)
+{ (void)curl; (void)access; pthread_mutex_lock(((Hedger*)userdata)->share_lock + data); }
+
+static void rc_hedge_unlock(CURL* curl, curl_lock_data data, void* userdata)
+{ (void)curl; pthread_mutex_unlock(((Hedger*)userdata)->share_lock + data); }
+
+Hedger* rc_hedge_init(bool hedging) {
+
+    Hedger* hedger = calloc(1, sizeof(Hedger));
+    if (hedger == NULL) { return NULL; }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    hedger->hedging = hedging;
+    hedger->share = curl_share_init();
+    hedger->endpoints = calloc(HEDGE_ENDPOINTS, sizeof(HedgeEndpoint));
+
+    if (hedger->share && hedger->endpoints) {
+
+        for (size_t i = 0; i < CURL_LOCK_DATA_LAST; i++) { pthread_mutex_init(hedger->share_lock + i, NULL); }
+        pthread_mutex_init(&hedger->lock, NULL);
+
+        curl_share_setopt(hedger->share, CURLSHOPT_LOCKFUNC, rc_hedge_lock);
+        curl_share_setopt(hedger->share, CURLSHOPT_UNLOCKFUNC, rc_hedge_unlock);
+        curl_share_setopt(hedger->share, CURLSHOPT_USERDATA, hedger);
+        curl_share_setopt(hedger->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+        curl_share_setopt(hedger->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(hedger->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        return hedger;
+
+    }
+
+    if (hedger->share) { curl_share_cleanup(hedger->share); } // no handle has used it yet
+    free(hedger->endpoints);
+    curl_global_cleanup();
+    free(hedger);
+    return NULL;
+
+}
+
+void rc_hedge_timeouts(Hedger* hedger, long connect_ms, long total_ms, long low_speed_limit, long low_speed_time) {
+
+    hedger->connect_timeout = connect_ms;
+    hedger->total_timeout = total_ms;
+    hedger->low_speed_limit = low_speed_limit;
+    hedger->low_speed_time = low_speed_time;
+
+}
+
+void rc_hedge_attach(Hedger* hedger, BearerToken* token) { token->hedger = hedger; }
+
+bool rc_hedge_free(Hedger* hedger) {
+
+    // a share still in use must outlive its handles, and so must the locks it calls
+    if (curl_share_cleanup(hedger->share) != CURLSHE_OK) { return false; }
+
+    for (size_t i = 0; i < CURL_LOCK_DATA_LAST; i++) { pthread_mutex_destroy(hedger->share_lock + i); }
+    pthread_mutex_destroy(&hedger->lock);
+
+    free(hedger->endpoints);
+    curl_global_cleanup();
+    free(hedger);
+    return true;
+
+}
+
+// must be called with hedger->lock held; NULL if the table is full
+static HedgeEndpoint* rc_hedge_endpoint(Hedger* hedger, uint64_t hash, bool insert) {
+
+    for (size_t i = 0; i < HEDGE_ENDPOINTS; i++) {
+
+        HedgeEndpoint* endpoint = hedger->endpoints + (hash + i) % HEDGE_ENDPOINTS;
+
+        if (endpoint->hash == hash) { return endpoint; }
+        if (endpoint->hash) { continue; }
+        if (!insert) { return NULL; }
+
+        endpoint->hash = hash;
+        endpoint->remaining = -1;
+        return endpoint;
+
+    }
+
+    return NULL;
+
+}
+
+// ms until the endpoint's responses started, at the given percentile; -1 without enough samples
+static long rc_hedge_percentile(Hedger* hedger, uint64_t hash, unsigned int percentile, long long* remaining) {
+
+    uint32_t samples[HEDGE_SAMPLES];
+    size_t n = 0;
+
+    pthread_mutex_lock(&hedger->lock);
+    const HedgeEndpoint* endpoint = rc_hedge_endpoint(hedger, hash, false);
+
+    if (endpoint) {
+
+        n = endpoint->n_samples < HEDGE_SAMPLES ? endpoint->n_samples : HEDGE_SAMPLES;
+        memcpy(samples, endpoint->samples, n * sizeof(uint32_t));
+        if (remaining) { *remaining = endpoint->remaining; }
+
+    }
+
+    pthread_mutex_unlock(&hedger->lock);
+    if (n < HEDGE_MIN_SAMPLES) { return -1; }
+
+    for (size_t i = 1; i < n; i++) {
+
+        const uint32_t sample = samples[i];
+        size_t j = i;
+
+        for (; j > 0 && samples[j - 1] > sample; j--) { samples[j] = samples[j - 1]; }
+        samples[j] = sample;
+
+    }
+
+    const size_t rank = (n * (percentile > 100 ? 100 : percentile) + 99) / 100;
+    return (long)samples[rank ? rank - 1 : 0];
+
+}
+
+long rc_hedge_latency(Hedger* hedger, const char* url, unsigned int percentile)
+{ return rc_hedge_percentile(hedger, rc_endpoint_hash(url), percentile, NULL); }
+
+static void rc_hedge_record(Hedger* hedger, CURL* curl, int64_t ms) {
+
+    const char* url = NULL;
+    struct curl_header* header;
+    long long remaining = -1;
+
+    if (curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url) != CURLE_OK || url == NULL || *url == '\0') { return; }
+
+    if (curl_easy_header(curl, "x-rate-limit-remaining", 0, CURLH_HEADER, 0, &header) == CURLHE_OK)
+    { remaining = strtoll(header->value, NULL, 10); }
+
+    pthread_mutex_lock(&hedger->lock);
+    HedgeEndpoint* endpoint = rc_hedge_endpoint(hedger, rc_endpoint_hash(url), true);
+
+    if (endpoint) {
+
+        endpoint->samples[endpoint->n_samples++ % HEDGE_SAMPLES] = ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms;
+        endpoint->remaining = remaining;
+
+    }
+
+    pthread_mutex_unlock(&hedger->lock);
+
+}
+
+// the first leg to receive the status line of its final response writes the response; the other
+// is stopped before any body. 1xx responses (100 Continue, 103 Early Hints) are not answers, and a
+// proxy's "200 Connection established" is kept from this callback (CURLOPT_SUPPRESS_CONNECT_HEADERS)
+static size_t rc_hedge_header(char* buffer, size_t size, size_t nitems, void* userdata) {
+
+    HedgeLeg* leg = (HedgeLeg*)userdata;
+    HedgeRace* race = leg->race;
+    const size_t n = size * nitems;
+
+    if (race->winner == NULL && n > 12 && memcmp(buffer, "HTTP/", 5) == 0) {
+
+        const char* code = memchr(buffer, ' ', n - 1);
+        if (code && code[1] != '1') { race->winner = leg->curl; race->answered = rc_hedge_now() - race->start; }
+
+    }
+
+    return race->winner == NULL || race->winner == leg->curl ? n : 0;
+
+}
+
+static void rc_hedge_leg(HedgeLeg* leg, HedgeRace* race, CURL* curl) {
+
+    leg->race = race;
+    leg->curl = curl;
+    leg->running = true;
+    leg->result = CURLE_OK;
+    leg->error[0] = '\0';
+
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, rc_hedge_header);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, leg);
+    curl_easy_setopt(curl, CURLOPT_SUPPRESS_CONNECT_HEADERS, 1L);
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, leg->error);
+
+}
+
+// only a GET may be sent twice: a POST (access or WebSocket token request) could take effect twice
+static bool rc_hedge_idempotent(CURL* curl) {
+
+    const char* method = NULL;
+    return curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_METHOD, &method) == CURLE_OK && method && strcmp(method, "GET") == 0;
+
+}
+
+// a duplicate may be sent if it does not spend the last requests of the window
+static bool rc_hedge_quota(BearerToken* token, CURL* curl, long long remaining) {
+
+    if (token->limiter) { return rc_shared_try(token->limiter, curl); }
+    else { return remaining < 0 || remaining > HEDGE_HEADROOM; }
+
+}
+
+static CURLcode rc_hedge_race(Hedger* hedger, BearerToken* token, CURL* curl, CURL** done) {
+
+    CURLM* multi = curl_multi_init();
+    if (multi == NULL) { return curl_easy_perform(curl); }
+
+    HedgeRace race = { .winner = NULL, .start = rc_hedge_now(), .answered = 0 };
+    HedgeLeg legs[2] = { { .curl = NULL }, { .curl = NULL } };
+    HedgeLeg* finished = NULL;
+    long long remaining = -1;
+    long deadline = -2; // not looked up yet; -1 once no duplicate is to be sent
+
+    curl_easy_setopt(curl, CURLOPT_SHARE, hedger->share);
+    rc_hedge_leg(legs, &race, curl);
+    curl_multi_add_handle(multi, curl);
+
+    for (;;) {
+
+        CURLMsg* message;
+        int n_messages = 0;
+        int n_running = 0;
+
+        curl_multi_perform(multi, &n_running);
+
+        while ((message = curl_multi_info_read(multi, &n_messages))) {
+
+            if (message->msg != CURLMSG_DONE) { continue; }
+
+            HedgeLeg* leg = message->easy_handle == curl ? legs : legs + 1;
+            leg->running = false;
+            leg->result = message->data.result;
+            curl_multi_remove_handle(multi, message->easy_handle);
+
+        }
+
+        // the race ends with the leg that answered first, or once neither is left running
+        if (race.winner) { HedgeLeg* leg = race.winner == curl ? legs : legs + 1; if (!leg->running) { finished = leg; } }
+        else if (!legs[0].running && !legs[1].running) { finished = legs; }
+
+        if (finished) { break; }
+
+        // the URL and method are known to libcurl once the transfer has started
+        const char* url = NULL;
+
+        if (deadline == -2 && curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url) == CURLE_OK && url && *url)
+        { deadline = rc_hedge_idempotent(curl) ? rc_hedge_percentile(hedger, rc_endpoint_hash(url), HEDGE_PERCENTILE, &remaining) : -1; }
+
+        const int64_t elapsed = rc_hedge_now() - race.start;
+        long wait = HEDGE_POLL_MS;
+
+        if (race.winner == NULL && legs[0].running && deadline >= 0 && elapsed >= deadline) {
+
+            CURL* duplicate = rc_hedge_quota(token, curl, remaining) ? curl_easy_duphandle(curl) : NULL;
+
+            if (duplicate) {
+
+                // curl_easy_duphandle does not carry the share over
+                curl_easy_setopt(duplicate, CURLOPT_SHARE, hedger->share);
+                rc_hedge_leg(legs + 1, &race, duplicate);
+                curl_multi_add_handle(multi, duplicate);
+
+                pthread_mutex_lock(&hedger->lock);
+                hedger->n_hedged++;
+                pthread_mutex_unlock(&hedger->lock);
+
+            }
+
+            deadline = -1; // at most one duplicate
+
+        } else if (race.winner == NULL && deadline >= 0 && deadline - elapsed < wait) { wait = (long)(deadline - elapsed); }
+
+        curl_multi_poll(multi, NULL, 0, (int)wait, NULL);
+
+    }
+
+    // the loser is cancelled; its connection is closed
+    for (size_t i = 0; i < 2; i++) { if (legs[i].running) { curl_multi_remove_handle(multi, legs[i].curl); } }
+    curl_multi_cleanup(multi);
+
+    if (finished->result != CURLE_OK) { memcpy(token->error, finished->error, CURL_ERROR_SIZE); }
+    if (race.winner) { rc_hedge_record(hedger, race.winner, race.answered); }
+
+    if (finished == legs + 1) {
+
+        pthread_mutex_lock(&hedger->lock);
+        hedger->n_won++;
+        pthread_mutex_unlock(&hedger->lock);
+
+    }
+
+    for (size_t i = 0; i < 2; i++) {
+
+        if (legs[i].curl == NULL) { continue; }
+
+        // detached from the share, so no handle outside a race keeps it in use for rc_hedge_free
+        curl_easy_setopt(legs[i].curl, CURLOPT_HEADERFUNCTION, NULL);
+        curl_easy_setopt(legs[i].curl, CURLOPT_HEADERDATA, NULL);
+        curl_easy_setopt(legs[i].curl, CURLOPT_SUPPRESS_CONNECT_HEADERS, 0L);
+        curl_easy_setopt(legs[i].curl, CURLOPT_ERRORBUFFER, legs[i].curl == curl ? token->error : NULL);
+        curl_easy_setopt(legs[i].curl, CURLOPT_SHARE, NULL);
+
+    }
+
+    // a duplicate that lost is not needed for evaluating the response
+    if (legs[1].curl && finished != legs + 1) { curl_easy_cleanup(legs[1].curl); }
+
+    *done = finished->curl;
+    return finished->result;
+
+}
+
+CURLcode rc_hedge_perform(Hedger* hedger, BearerToken* token, CURL* curl, CURL** done) {
+
+    *done = curl;
+
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, hedger->connect_timeout);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, hedger->total_timeout);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, hedger->low_speed_limit);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, hedger->low_speed_time);
+
+    if (hedger->hedging) { return rc_hedge_race(hedger, token, curl, done); }
+    else { return token->pool ? rc_pool_perform(token->pool, curl) : curl_easy_perform(curl); }
+
+}
+
+void rc_hedge_release(CURL* curl, CURL* done) { if (done != curl) { curl_easy_cleanup(done); } }
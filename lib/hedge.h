@@ -0,0 +1,136 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_HEDGE_H
+#define RC_HEDGE_H
+
+#define HEDGE_ENDPOINTS 64
+#define HEDGE_SAMPLES 64
+#define HEDGE_MIN_SAMPLES 20
+#define HEDGE_PERCENTILE 95
+#define HEDGE_HEADROOM 2
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "bearer_token.h"
+
+/**
+ * Transfer timeouts and hedged requests
+ *
+ * By default, transfers have no timeouts: a request whose response never
+ * comes holds up its page loop for as long as the connection stays open.
+ * Once a Hedger is attached to a token, every transfer made with it
+ * (including its copies used by the job runner and rc_json_fan_out) gets
+ * the connect, total and low-speed timeouts set with rc_hedge_timeouts. A
+ * transfer that times out fails like any other interrupted transfer, so
+ * the page loop drops the page and requests it again.
+ *
+ * With hedging turned on, the hedger also records how long each endpoint
+ * takes to start answering (the last HEDGE_SAMPLES responses of every
+ * endpoint). Once an endpoint has HEDGE_MIN_SAMPLES samples, a request to
+ * it that has not started answering after the endpoint's 95th percentile
+ * is sent a second time, unless that would spend the last requests of the
+ * rate limit window. The response whose final status line comes first
+ * (not a 1xx, nor a proxy's CONNECT reply) is written to the container;
+ * the other request is cancelled. Only GET requests are sent
+ * twice; POSTs (access and WebSocket token requests) only get the timeouts.
+ *
+ * Hedger* hedger = rc_hedge_init(true);
+ * rc_hedge_timeouts(hedger, 10000, 0, 1024, 30); // 10s to connect, 30s below 1 KiB/s
+ * rc_hedge_attach(hedger, token);
+ * rc_json_get_buffer(token, json, RC_GET_CALL_LOG);
+ * rc_hedge_free(hedger);
+ *
+ * - With hedging on, requests and their duplicates use connections shared
+ *   among the hedger's requests instead of an attached HttpPool's
+ * - With a SharedLimiter attached, a duplicate is only sent if it can take
+ *   a unit of the shared budget at once, outside the interactive headroom
+ * - The hedger is thread-safe: tokens forked for other threads share it
+ */
+typedef struct Hedger {
+
+    bool hedging; // false: timeouts only
+
+    long connect_timeout; // ms; 0 for libcurl's default
+    long total_timeout;   // ms; 0 for none
+    long low_speed_limit; // bytes per second
+    long low_speed_time;  // seconds below low_speed_limit before giving up; 0 for none
+
+    CURLSH* share; // connections of hedged requests
+    pthread_mutex_t share_lock[CURL_LOCK_DATA_LAST];
+
+    pthread_mutex_t lock;
+    struct HedgeEndpoint* endpoints;
+
+    size_t n_hedged; // duplicates sent
+    size_t n_won;    // duplicates that answered first
+
+} Hedger;
+
+/// @brief Create a hedger
+/// @param hedging true to send duplicates of slow requests; false for timeouts only
+/// @return a pointer to the hedger; NULL if it could not be created
+Hedger* rc_hedge_init(bool hedging);
+
+/// @brief Set the timeouts of every transfer made through the hedger
+/// @param hedger pointer to a Hedger
+/// @param connect_ms time allowed to connect (0 for libcurl's default of 300 seconds)
+/// @param total_ms time allowed for a whole transfer (0 for none)
+/// @param low_speed_limit average bytes per second below which a transfer is too slow
+/// @param low_speed_time seconds a transfer may stay too slow (0 for no low-speed limit)
+void rc_hedge_timeouts(Hedger* hedger, long connect_ms, long total_ms, long low_speed_limit, long low_speed_time);
+
+/// @brief Make every transfer of a token go through the hedger
+/// @param hedger pointer to a Hedger (NULL to detach)
+/// @param token pointer to a BearerToken (can be just a skeleton)
+void rc_hedge_attach(Hedger* hedger, BearerToken* token);
+
+/// @brief Time an endpoint takes to start answering, as recorded by the hedger
+/// @param hedger pointer to a Hedger
+/// @param url any url of the endpoint
+/// @param percentile e.g. 50 or 95
+/// @return time in milliseconds; -1 until the endpoint has HEDGE_MIN_SAMPLES samples
+long rc_hedge_latency(Hedger* hedger, const char* url, unsigned int percentile);
+
+/// @brief Free the hedger
+/// @param hedger pointer to a Hedger
+/// @return false if a transfer still uses the hedger's connections; the hedger
+///         is then left as it is, and must be freed again once it has returned
+/// @note Must only be called once all transfers using the hedger have returned
+bool rc_hedge_free(Hedger* hedger);
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief perform a transfer with the hedger's timeouts, hedged if the endpoint is slow to answer
+/// @param hedger pointer to a Hedger
+/// @param token pointer to the BearerToken of the transfer
+/// @param curl a CURL handle with its access token set
+/// @param done set to the handle that answered (curl, or its duplicate); its
+///        response code and headers describe the transfer
+/// @return result of the transfer, same as curl_easy_perform
+/// @note done must be handed to rc_hedge_release once it has been evaluated
+CURLcode rc_hedge_perform(Hedger* hedger, BearerToken* token, CURL* curl, CURL** done);
+
+/// @brief free the duplicate returned by rc_hedge_perform, if any
+/// @param curl the CURL handle given to rc_hedge_perform
+/// @param done the handle returned in done
+void rc_hedge_release(CURL* curl, CURL* done);
+
+#endif // RINGEXTRACT_H
+
+#endif // RC_HEDGE_H
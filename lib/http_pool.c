@@ -0,0 +1,188 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include "http_pool.h"
+
+#define POOL_POLL_TIMEOUT 1000
+
+typedef struct PoolRequest {
+
+    CURL* curl;
+    CURLcode result;
+    bool done;
+
+    pthread_cond_t cond;
+    struct PoolRequest* next;
+
+} PoolRequest;
+
+static void rc_pool_submit(HttpPool* pool) {
+
+    pthread_mutex_lock(&pool->lock);
+    PoolRequest* request = pool->queue;
+    pool->queue = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    while (request) {
+
+        PoolRequest* next = request->next; // request is gone once signaled
+        curl_easy_setopt(request->curl, CURLOPT_PRIVATE, request);
+        const CURLMcode code = curl_multi_add_handle(pool->multi, request->curl);
+
+        if (code == CURLM_OK) { request = next; continue; }
+
+        pthread_mutex_lock(&pool->lock);
+        request->result = CURLE_FAILED_INIT;
+        request->done = true;
+        pthread_cond_signal(&request->cond);
+        pthread_mutex_unlock(&pool->lock);
+        request = next;
+
+    }
+
+}
+
+static void rc_pool_complete(HttpPool* pool) {
+
+    CURLMsg* message;
+    int n_messages = 0;
+
+    while ((message = curl_multi_info_read(pool->multi, &n_messages))) {
+
+        if (message->msg != CURLMSG_DONE) { continue; }
+
+        PoolRequest* request = NULL;
+        curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char**)&request);
+        const CURLcode result = message->data.result;
+        curl_multi_remove_handle(pool->multi, message->easy_handle);
+
+        pthread_mutex_lock(&pool->lock);
+        request->result = result;
+        request->done = true;
+        pthread_cond_signal(&request->cond);
+        pthread_mutex_unlock(&pool->lock);
+
+    }
+
+}
+
+static void* rc_pool_driver(void* userdata) {
+
+    HttpPool* pool = (HttpPool*)userdata;
+    int n_running = 0;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (pool->running || pool->queue) {
+
+        pthread_mutex_unlock(&pool->lock);
+
+        rc_pool_submit(pool);
+        curl_multi_perform(pool->multi, &n_running);
+        rc_pool_complete(pool);
+        curl_multi_poll(pool->multi, NULL, 0, POOL_POLL_TIMEOUT, NULL);
+
+        pthread_mutex_lock(&pool->lock);
+
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+
+}
+
+HttpPool* rc_pool_init(size_t n_connections, size_t n_streams) {
+
+    HttpPool* pool = calloc(1, sizeof(HttpPool));
+    if (pool == NULL) { return NULL; }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    pool->multi = curl_multi_init();
+    pool->running = true;
+    pool->n_connections = n_connections > 0 ? (long)n_connections : POOL_CONNECTIONS;
+    pool->n_streams = n_streams > 0 ? (long)n_streams : POOL_STREAMS;
+    pthread_mutex_init(&pool->lock, NULL);
+
+    if (pool->multi) {
+
+        curl_multi_setopt(pool->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(pool->multi, CURLMOPT_MAX_HOST_CONNECTIONS, pool->n_connections);
+        curl_multi_setopt(pool->multi, CURLMOPT_MAX_CONCURRENT_STREAMS, pool->n_streams);
+
+        if (pthread_create(&pool->thread, NULL, rc_pool_driver, pool) == 0) { return pool; }
+        else { curl_multi_cleanup(pool->multi); }
+
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    curl_global_cleanup();
+    free(pool);
+    return NULL;
+
+}
+
+void rc_pool_attach(HttpPool* pool, BearerToken* token) { token->pool = pool; }
+
+void rc_pool_free(HttpPool* pool) {
+
+    pthread_mutex_lock(&pool->lock);
+    pool->running = false;
+    pthread_mutex_unlock(&pool->lock);
+
+    curl_multi_wakeup(pool->multi);
+    pthread_join(pool->thread, NULL);
+
+    curl_multi_cleanup(pool->multi);
+    pthread_mutex_destroy(&pool->lock);
+    curl_global_cleanup();
+    free(pool);
+
+}
+
+CURLcode rc_pool_perform(HttpPool* pool, CURL* curl) {
+
+    PoolRequest request = {
+
+        .curl = curl,
+        .result = CURLE_OK,
+        .done = false,
+        .next = NULL
+
+    };
+
+    // negotiate HTTP/2 over TLS and wait for a multiplexed stream
+    // rather than opening another connection
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+
+    pthread_cond_init(&request.cond, NULL);
+    pthread_mutex_lock(&pool->lock);
+
+    request.next = pool->queue;
+    pool->queue = &request;
+    curl_multi_wakeup(pool->multi);
+
+    while (!request.done) { pthread_cond_wait(&request.cond, &pool->lock); }
+
+    pthread_mutex_unlock(&pool->lock);
+    pthread_cond_destroy(&request.cond);
+    return request.result;
+
+}
@@ -0,0 +1,88 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_HTTP_POOL_H
+#define RC_HTTP_POOL_H
+
+#define POOL_CONNECTIONS 2
+#define POOL_STREAMS 100
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "bearer_token.h"
+
+/**
+ * Shared connection pool with HTTP/2 multiplexing
+ *
+ * By default, every data fetching API creates its own CURL handle, and with
+ * it its own connection to the platform host. Once a pool is attached to a
+ * token, every transfer made with that token (including its copies used by
+ * the job runner and rc_json_fan_out, and its access token requests) is
+ * handed to the pool instead. The pool negotiates HTTP/2 and multiplexes
+ * concurrent transfers as streams over a small number of connections,
+ * which are kept alive and reused between calls.
+ *
+ * The calling thread still blocks until its own transfer completes;
+ * transfers are driven by a single background thread owned by the pool.
+ *
+ * HttpPool* pool = rc_pool_init(0, 0);
+ * rc_pool_attach(pool, token);
+ * rc_jobs_run(token, runner); // all requests share up to 2 connections
+ * rc_pool_free(pool);
+ */
+typedef struct HttpPool {
+
+    CURLM* multi;
+    pthread_t thread;
+    pthread_mutex_t lock;
+
+    struct PoolRequest* queue; // submitted, not yet added to multi
+    bool running;
+
+    long n_connections;
+    long n_streams;
+
+} HttpPool;
+
+/// @brief Create a connection pool and start its transfer thread
+/// @param n_connections maximum connections per host (0 for default of 2)
+/// @param n_streams maximum concurrent HTTP/2 streams per connection (0 for default of 100)
+/// @return a pointer to the pool; NULL if it could not be created
+HttpPool* rc_pool_init(size_t n_connections, size_t n_streams);
+
+/// @brief Route all transfers made with a token through a pool
+/// @param pool pointer to an HttpPool (NULL to detach)
+/// @param token pointer to a BearerToken (can be just a skeleton)
+void rc_pool_attach(HttpPool* pool, BearerToken* token);
+
+/// @brief Stop the transfer thread, close all connections and free the pool
+/// @param pool pointer to an HttpPool
+/// @note Must only be called once all transfers using the pool have returned
+void rc_pool_free(HttpPool* pool);
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief perform a transfer through a pool, blocking until it completes
+/// @param pool pointer to an HttpPool
+/// @param curl a CURL handle (must not be in use by any other multi handle)
+/// @return result of the transfer, same as curl_easy_perform
+CURLcode rc_pool_perform(HttpPool* pool, CURL* curl);
+
+#endif // RINGEXTRACT_H
+
+#endif // RC_HTTP_POOL_H
@@ -0,0 +1,525 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "bearer_token.h"
+#include "json_content.h"
+#include "fan_out.h"
+#include "job_runner.h"
+#include "endpoint.h"
+
+#define MUL(X, Y) (((X) / (Y) + 1) * (Y))
+
+#define JOB_INIT_SIZE 16
+#define JOB_NO_ID ((size_t)-1)
+#define JOB_ID_SIZE 20 // digits of the largest long, with its sign
+
+typedef struct {
+
+    size_t node;
+    size_t index; // index into the ids of the first dependency
+
+} JobTask;
+
+typedef struct {
+
+    JobRunner* runner;
+    BearerToken* token;
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+
+    JobTask* queue;
+    size_t head;
+    size_t tail;
+    size_t total_size;
+
+    size_t* n_wait; // dependencies not yet completed, per node
+    size_t* n_left; // tasks not yet completed, per node
+    size_t n_pending; // tasks queued or running
+
+    JsonContent** results; // per id responses of nodes with combined output
+
+} JobState;
+
+static const char* rc_jobs_preset(const char* name) {
+
+    const Endpoint* endpoint = rc_endpoint_named(name);
+    if (endpoint) { return endpoint->url; }
+
+    return strstr(name, "://") ? name : NULL;
+
+}
+
+static const char* rc_jobs_fail(JobRunner* runner, const char* message, const char* detail) {
+
+    snprintf(runner->error, CURL_ERROR_SIZE, "%s: %.200s", message, detail);
+    return NULL;
+
+}
+
+static size_t rc_jobs_find(JobRunner* runner, const char* name, size_t n) {
+
+    for (size_t i = 0; i < runner->n_nodes; i++) {
+
+        const char* node = runner->nodes[i].name;
+        if (strncmp(node, name, n) == 0 && node[n] == '\0') { return i; }
+
+    }
+
+    return runner->n_nodes;
+
+}
+
+const char* rc_jobs_add(JobRunner* runner, const char* name, const char* url,
+                        const char* output, const char* after) {
+
+    const char* full_url = rc_jobs_preset(url);
+    const bool template = full_url && strstr(full_url, "%li");
+
+    if (full_url == NULL) { return rc_jobs_fail(runner, "Unknown endpoint", url); }
+    if (strlen(full_url) + JOB_ID_SIZE >= JOB_URL_SIZE) { return rc_jobs_fail(runner, "Endpoint too long", name); }
+    if (output && strlen(output) + JOB_ID_SIZE >= JOB_URL_SIZE) { return rc_jobs_fail(runner, "Output too long", name); }
+    if (rc_jobs_find(runner, name, strlen(name)) < runner->n_nodes)
+    { return rc_jobs_fail(runner, "Duplicate node", name); }
+
+    if (output && strcmp(output, "-") == 0) { output = NULL; }
+
+    if (runner->n_nodes == runner->total_size) {
+
+        const size_t total_size = MUL(runner->n_nodes, JOB_INIT_SIZE);
+        JobNode* nodes = realloc(runner->nodes, total_size * sizeof(JobNode));
+
+        if (nodes) { runner->nodes = nodes; runner->total_size = total_size; }
+        else { return rc_jobs_fail(runner, "Out of memory", name); }
+
+    }
+
+    JobNode* node = runner->nodes + runner->n_nodes;
+    memset(node, 0, sizeof(JobNode));
+
+    while (after && *after) {
+
+        const size_t n = strcspn(after, ",");
+        const size_t dep = rc_jobs_find(runner, after, n);
+
+        if (dep == runner->n_nodes) { return rc_jobs_fail(runner, "Unknown dependency", after); }
+        if (node->n_deps == JOB_MAX_DEPS) { return rc_jobs_fail(runner, "Too many dependencies", name); }
+
+        node->deps[node->n_deps++] = dep;
+        after += n + (after[n] == ',');
+
+    }
+
+    if (template && node->n_deps == 0)
+    { return rc_jobs_fail(runner, "Templated endpoint requires a dependency", name); }
+
+    node->name = strdup(name);
+    node->url = strdup(full_url);
+    node->output = output ? strdup(output) : NULL;
+    node->s_token = RC_TOKEN_UNINITIALIZED;
+
+    if (node->name == NULL || node->url == NULL || (output && node->output == NULL)) {
+
+        free(node->name);
+        free(node->url);
+        free(node->output);
+        return rc_jobs_fail(runner, "Out of memory", name);
+
+    }
+
+    if (template) { runner->nodes[node->deps[0]].collect_ids = true; }
+
+    runner->n_nodes++;
+    return name;
+
+}
+
+const char* rc_jobs_load(JobRunner* runner, const char* file) {
+
+    char line[JOB_URL_SIZE * 2];
+    FILE* f = fopen(file, "r");
+
+    if (f == NULL) { return rc_jobs_fail(runner, "Cannot open manifest", file); }
+
+    while (fgets(line, sizeof(line), f)) {
+
+        // a line that does not fit would otherwise be read as two nodes
+        if (strchr(line, '\n') == NULL && !feof(f)) {
+
+            rc_jobs_fail(runner, "Manifest line too long", line);
+            fclose(f);
+            return NULL;
+
+        }
+
+        char* comment = strchr(line, '#');
+        if (comment) { comment[0] = '\0'; }
+
+        const char* delim = " \t\r\n";
+        char* state = NULL;
+
+        const char* name   = strtok_r(line, delim, &state);
+        const char* url    = strtok_r(NULL, delim, &state);
+        const char* output = strtok_r(NULL, delim, &state);
+        const char* after  = strtok_r(NULL, delim, &state);
+
+        if (name == NULL) { continue; }
+        if (url == NULL || rc_jobs_add(runner, name, url, output, after) == NULL) {
+
+            if (url == NULL) { rc_jobs_fail(runner, "Missing endpoint", name); }
+            fclose(f);
+            return NULL;
+
+        }
+
+    }
+
+    fclose(f);
+    return file;
+
+}
+
+void rc_jobs_free(JobRunner* runner) {
+
+    for (size_t i = 0; i < runner->n_nodes; i++) {
+
+        free(runner->nodes[i].name);
+        free(runner->nodes[i].url);
+        free(runner->nodes[i].output);
+        free(runner->nodes[i].ids);
+
+    }
+
+    free(runner->nodes);
+    runner->nodes = NULL;
+    runner->n_nodes = 0;
+    runner->total_size = 0;
+
+}
+
+// the following functions must be called with state->lock held
+
+static void rc_jobs_push(JobState* state, size_t node, size_t index) {
+
+    if (state->tail == state->total_size) {
+
+        const size_t total_size = MUL(state->tail, JOB_INIT_SIZE);
+        JobTask* queue = realloc(state->queue, total_size * sizeof(JobTask));
+
+        if (queue) { state->queue = queue; state->total_size = total_size; }
+        else { state->runner->nodes[node].n_failed++; return; }
+
+    }
+
+    state->queue[state->tail++] = (JobTask){ .node = node, .index = index };
+    state->n_left[node]++;
+    state->n_pending++;
+
+}
+
+static void rc_jobs_schedule(JobState* state, size_t index);
+static TokenError rc_jobs_merge(JobState* state, size_t index, char* error);
+
+static void rc_jobs_complete(JobState* state, size_t index) {
+
+    JobRunner* runner = state->runner;
+
+    for (size_t i = index + 1; i < runner->n_nodes; i++) {
+
+        for (size_t d = 0; d < runner->nodes[i].n_deps; d++) {
+
+            if (runner->nodes[i].deps[d] != index) { continue; }
+            if (--state->n_wait[i] == 0) { rc_jobs_schedule(state, i); }
+
+        }
+
+    }
+
+    pthread_cond_broadcast(&state->ready);
+
+}
+
+static void rc_jobs_schedule(JobState* state, size_t index) {
+
+    JobRunner* runner = state->runner;
+    JobNode* node = runner->nodes + index;
+
+    for (size_t d = 0; d < node->n_deps; d++) {
+
+        const JobNode* dep = runner->nodes + node->deps[d];
+        if (dep->n_failed == 0 && dep->s_token == RC_TOKEN_OK) { continue; }
+
+        snprintf(node->error, CURL_ERROR_SIZE, "Skipped: dependency %s failed.", dep->name);
+        rc_jobs_complete(state, index);
+        return;
+
+    }
+
+    node->s_token = RC_TOKEN_OK;
+
+    if (strstr(node->url, "%li")) {
+
+        const JobNode* source = runner->nodes + node->deps[0];
+        const bool combined = node->output == NULL || strstr(node->output, "%li") == NULL;
+
+        if (combined && source->n_ids) {
+
+            JsonContent* results = malloc(source->n_ids * sizeof(JsonContent));
+            state->results[index] = results;
+
+            if (results == NULL) { node->n_failed++; rc_jobs_complete(state, index); return; }
+
+            for (size_t i = 0; i < source->n_ids; i++)
+            { memcpy(results + i, RC_JSON_INIT(FAN_INIT_SIZE), sizeof(JsonContent)); }
+
+        }
+
+        // no ids: the combined output is still written, as an empty list of records
+        if (combined && source->n_ids == 0) {
+
+            const TokenError status = rc_jobs_merge(state, index, node->error);
+            if (status != RC_TOKEN_OK) { node->s_token = status; node->n_failed++; }
+
+        }
+
+        for (size_t i = 0; i < source->n_ids; i++) { rc_jobs_push(state, index, i); }
+
+    } else { rc_jobs_push(state, index, JOB_NO_ID); }
+
+    if (state->n_left[index] == 0) { rc_jobs_complete(state, index); }
+
+}
+
+static TokenError rc_jobs_write(const JobNode* node, JsonContent* json, long id, char* error) {
+
+    char file[JOB_URL_SIZE];
+
+    if (node->output) {
+
+        if (strstr(node->output, "%li")) { snprintf(file, JOB_URL_SIZE, node->output, id); }
+        else { snprintf(file, JOB_URL_SIZE, "%s", node->output); }
+
+        if (rc_json_fwrite(json, file) == NULL) {
+
+            snprintf(error, CURL_ERROR_SIZE, "FILE error: %.200s", file);
+            return RC_CURL_TRANSFER_FAILED;
+
+        }
+
+    }
+
+    return RC_TOKEN_OK;
+
+}
+
+static TokenError rc_jobs_perform(JobState* state, JobTask* task, JsonContent* json, bool combined, char* error) {
+
+    const JobRunner* runner = state->runner;
+    const JobNode* node = runner->nodes + task->node;
+    const long id = task->index == JOB_NO_ID ? 0 : runner->nodes[node->deps[0]].ids[task->index];
+
+    BearerToken token;
+    char url[JOB_URL_SIZE];
+
+    if (task->index == JOB_NO_ID) { snprintf(url, JOB_URL_SIZE, "%s", node->url); }
+    else { snprintf(url, JOB_URL_SIZE, node->url, id); }
+
+    if (rc_token_fork(&token, state->token) == RC_TOKEN_OK) { rc_json_get_buffer(&token, json, url); }
+    memcpy(error, token.error, CURL_ERROR_SIZE);
+
+    if (token.s_token != RC_TOKEN_OK) { json->n_bytes = 0; return token.s_token; }
+    else if (combined) { return RC_TOKEN_OK; } // written once all ids complete
+    else { return rc_jobs_write(node, json, id, error); }
+
+}
+
+// combine per id responses of a node, then write them to its output file
+static TokenError rc_jobs_merge(JobState* state, size_t index, char* error) {
+
+    const JobNode* node = state->runner->nodes + index;
+    const JobNode* source = state->runner->nodes + node->deps[0];
+    JsonContent* results = state->results[index];
+    JsonContent* json = RC_JSON_INIT(0);
+    TokenError status = RC_TOKEN_OK;
+
+    if (rc_fan_merge(json, source->ids, results, source->n_ids) == NULL) {
+
+        snprintf(error, CURL_ERROR_SIZE, "Out of memory: %s", node->name);
+        status = RC_CURL_TRANSFER_FAILED;
+
+    } else { status = rc_jobs_write(node, json, 0, error); }
+
+    for (size_t i = 0; i < source->n_ids; i++) { RC_JSON_FREE(results + i); }
+
+    RC_JSON_FREE(json);
+    free(results);
+    state->results[index] = NULL;
+    return status;
+
+}
+
+static void* rc_jobs_worker(void* userdata) {
+
+    JobState* state = (JobState*)userdata;
+    JobRunner* runner = state->runner;
+    JsonContent* json = RC_JSON_INIT(0);
+    char error[CURL_ERROR_SIZE];
+
+    pthread_mutex_lock(&state->lock);
+
+    while (true) {
+
+        while (state->head == state->tail && state->n_pending > 0)
+        { pthread_cond_wait(&state->ready, &state->lock); }
+
+        if (state->head == state->tail) { break; }
+
+        JobTask task = state->queue[state->head++];
+        JobNode* node = runner->nodes + task.node;
+        JsonContent* results = state->results[task.node];
+        JsonContent* target = results ? results + task.index : json;
+        pthread_mutex_unlock(&state->lock);
+
+        TokenError status = rc_jobs_perform(state, &task, target, results != NULL, error);
+
+        pthread_mutex_lock(&state->lock);
+
+        if (status != RC_TOKEN_OK) {
+
+            if (node->n_failed++ == 0) { node->s_token = status; memcpy(node->error, error, CURL_ERROR_SIZE); }
+
+        } else if (node->collect_ids && !rc_fan_ids(target, &node->ids, &node->n_ids)) { node->n_failed++; }
+
+        node->n_tasks++;
+
+        if (--state->n_left[task.node] == 0 && results) {
+
+            pthread_mutex_unlock(&state->lock);
+            status = rc_jobs_merge(state, task.node, error);
+            pthread_mutex_lock(&state->lock);
+
+            if (status != RC_TOKEN_OK && node->n_failed++ == 0)
+            { node->s_token = status; memcpy(node->error, error, CURL_ERROR_SIZE); }
+
+        }
+
+        state->n_pending--;
+
+        if (state->n_left[task.node] == 0) { rc_jobs_complete(state, task.node); }
+        else if (state->n_pending == 0) { pthread_cond_broadcast(&state->ready); }
+
+    }
+
+    pthread_mutex_unlock(&state->lock);
+    RC_JSON_FREE(json);
+    return NULL;
+
+}
+
+size_t rc_jobs_run(BearerToken* token, JobRunner* runner) {
+
+    size_t n_failed = 0;
+    size_t n_threads = 0;
+    pthread_t* threads = calloc(runner->n_threads, sizeof(pthread_t));
+
+    JobState state = {
+
+        .runner = runner,
+        .token = token,
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .ready = PTHREAD_COND_INITIALIZER,
+        .queue = NULL,
+        .head = 0,
+        .tail = 0,
+        .total_size = 0,
+        .n_wait = calloc(runner->n_nodes + 1, sizeof(size_t)),
+        .n_left = calloc(runner->n_nodes + 1, sizeof(size_t)),
+        .n_pending = 0,
+        .results = calloc(runner->n_nodes + 1, sizeof(JsonContent*))
+
+    };
+
+    if (state.n_wait == NULL || state.n_left == NULL || state.results == NULL) {
+
+        free(threads);
+        free(state.n_wait);
+        free(state.n_left);
+        free(state.results);
+        rc_jobs_fail(runner, "Out of memory", "job state");
+        return runner->n_nodes;
+
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    pthread_mutex_lock(&state.lock);
+
+    for (size_t i = 0; i < runner->n_nodes; i++) {
+
+        JobNode* node = runner->nodes + i;
+
+        free(node->ids);
+        node->ids = NULL;
+        node->n_ids = 0;
+        node->n_tasks = 0;
+        node->n_failed = 0;
+        node->s_token = RC_TOKEN_UNINITIALIZED;
+        memset(node->error, 0, CURL_ERROR_SIZE);
+
+        state.n_wait[i] = node->n_deps;
+
+    }
+
+    for (size_t i = 0; i < runner->n_nodes; i++)
+    { if (state.n_wait[i] == 0) { rc_jobs_schedule(&state, i); } }
+
+    pthread_mutex_unlock(&state.lock);
+
+    while (threads && n_threads < runner->n_threads) {
+
+        if (pthread_create(threads + n_threads, NULL, rc_jobs_worker, &state) == 0) { n_threads++; }
+        else { break; }
+
+    }
+
+    if (n_threads == 0) { rc_jobs_worker(&state); } // run on the calling thread instead
+    for (size_t i = 0; i < n_threads; i++) { pthread_join(threads[i], NULL); }
+
+    for (size_t i = 0; i < runner->n_nodes; i++) {
+
+        const JobNode* node = runner->nodes + i;
+        if (node->n_failed || node->s_token != RC_TOKEN_OK) { n_failed++; }
+
+    }
+
+    free(threads);
+    free(state.queue);
+    free(state.n_wait);
+    free(state.n_left);
+    free(state.results);
+    pthread_mutex_destroy(&state.lock);
+    pthread_cond_destroy(&state.ready);
+    curl_global_cleanup();
+    return n_failed;
+
+}
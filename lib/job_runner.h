@@ -0,0 +1,154 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_JOB_RUNNER_H
+#define RC_JOB_RUNNER_H
+
+#define JOB_THREADS 4
+#define JOB_MAX_DEPS 8
+#define JOB_URL_SIZE 512
+
+#include <stdbool.h>
+#include "bearer_token.h"
+
+/**
+ * Declarative extraction job runner
+ *
+ * A job is a set of named nodes, each fetching one endpoint (with its page
+ * loop) and writing the result to a file. A node may run after one or more
+ * other nodes; if its endpoint is a template such as RC_GET_SITE_MEMBERS,
+ * it is expanded once per record id of its first dependency, e.g. once per
+ * site returned by RC_GET_SITES. Nodes run as a DAG on a pool of threads:
+ * independent nodes and expanded ids are fetched concurrently, and each
+ * node is started as soon as the nodes it depends on have completed.
+ *
+ * -- Manifest format (one node per line, '#' starts a comment) --
+ * # name        endpoint                     output              after
+ * sites         RC_GET_SITES                 sites.json
+ * site_members  RC_GET_SITE_MEMBERS          site_%li.json       sites
+ * queues        RC_GET_CALL_QUEUES           -
+ * members       RC_GET_CALL_QUEUE_MEMBERS    members.json        queues
+ *
+ * - endpoint: an RC_GET_ preset name or a full url (may contain one %li)
+ * - output: file name, or - to skip writing the result; for a templated
+ *   endpoint, a name containing %li writes one file per id, otherwise
+ *   all responses are combined as by rc_json_fan_out ({"records":[]} if
+ *   the dependency returned no ids)
+ * - after: comma separated names of nodes declared on earlier lines
+ */
+
+/**
+ * A single node of a job, as declared in the manifest
+ * Status members are written by rc_jobs_run
+ */
+typedef struct {
+
+    char* name;
+    char* url;
+    char* output;
+
+    size_t deps[JOB_MAX_DEPS];
+    size_t n_deps;
+    bool collect_ids;
+
+    long* ids;
+    size_t n_ids;
+
+    size_t n_tasks;
+    size_t n_failed;
+
+    TokenError s_token;
+    char error[CURL_ERROR_SIZE];
+
+} JobNode;
+
+/**
+ * Container struct for a job (set of nodes) and its thread pool size
+ * Can be run repeatedly; status of each node is reset on every run
+ *
+ * -- Declaration & Initialization --
+ * RIGHT: JobRunner* runner = RC_JOBS_INIT(0);
+ * WRONG: JobRunner* runner; // this will cause a crash later.
+ *
+ * -- Freeing Memory --
+ * RIGHT: RC_JOBS_FREE(runner);
+ *
+ * - Do not assume/directly modify its member variables
+ * - Must be freed with RC_JOBS_FREE when done
+ */
+typedef struct {
+
+    JobNode* nodes;
+    size_t n_nodes;
+    size_t total_size;
+
+    const size_t n_threads;
+    char error[CURL_ERROR_SIZE];
+
+} JobRunner;
+
+/// @brief Add a node to a job
+/// @param runner pointer to a JobRunner container
+/// @param name unique node name
+/// @param url RC_GET_ preset name or full url (may contain one %li)
+/// @param output file name (may contain %li); NULL or "-" to skip writing
+/// @param after comma separated names of previously added nodes; NULL if none
+/// @return if added successfully, the node name (same as the name argument);
+///         otherwise, NULL and the reason is written to runner->error
+const char* rc_jobs_add(JobRunner* runner, const char* name, const char* url,
+                        const char* output, const char* after);
+
+/// @brief Add all nodes declared in a manifest file
+/// @param runner pointer to a JobRunner container
+/// @param file full path & file name of the manifest
+/// @return if loaded successfully, the file name (same as the file argument);
+///         otherwise, NULL and the reason is written to runner->error
+const char* rc_jobs_load(JobRunner* runner, const char* file);
+
+/// @brief Run all nodes of a job and wait for them to complete
+/// @param token pointer to a BearerToken (can be just a skeleton)
+/// @param runner pointer to a JobRunner container
+/// @return number of nodes that failed or were skipped (0 on success);
+///         see s_token and error of each node for details
+/// @note Each thread refreshes the access token through the given token;
+///       do not use the token from other threads while the job is running
+size_t rc_jobs_run(BearerToken* token, JobRunner* runner);
+
+/// @brief Free all nodes of a job
+/// @param runner pointer to a JobRunner container
+void rc_jobs_free(JobRunner* runner);
+
+/// @brief Create and initialize a JobRunner container on the stack
+/// @param X number of threads (default is 4)
+/// @return a pointer to the initialized JobRunner
+/// @note To accept default number of threads (4), pass in 0;
+///       Otherwise, pass in the desired number of threads as a size_t
+#define RC_JOBS_INIT(X) &(JobRunner)       \
+{                                          \
+    .nodes = NULL,                         \
+    .n_nodes = 0,                          \
+    .total_size = 0,                       \
+    .n_threads = X > 0 ? X : JOB_THREADS,  \
+    .error = {0}                           \
+}
+
+/// @brief Free a JobRunner's nodes
+/// @param X pointer to a JobRunner container
+#define RC_JOBS_FREE(X) rc_jobs_free(X)
+
+#endif // RC_JOB_RUNNER_H
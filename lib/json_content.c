@@ -16,20 +16,55 @@
  *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <string.h>
+#include <unistd.h>
 
 #include "json_content.h"
+#include "manifest.h"
+#include "rate_limiter.h"
+#include "single_flight.h"
+#include "endpoint.h"
+#include "fan_out.h"
+#include "tracer.h"
 
 #define MUL(X, Y) (((X) / (Y) + 1) * (Y))
 
-static size_t rc_curl_write_json(char* contents, size_t size, size_t nitems, void* userdata) {
+#define JSON_READ_SIZE (1 << 16)
+
+// move completed pages out of memory, keeping the separator that
+// rc_json_bridge may still need to rewrite if the next page is empty
+static bool rc_json_spill(JsonContent* json) {
+
+    size_t n = json->n_bytes;
+    while (n > 0 && (json->buffer[n - 1] == ',' || json->buffer[n - 1] == ' ')) { n--; }
+
+    if (n == 0) { return true; }
+    if (json->spill == NULL) { json->spill = tmpfile(); }
+
+    if (json->spill == NULL || fwrite(json->buffer, 1, n, json->spill) != n) { return false; }
+    if (fflush(json->spill) != 0) { return false; }
+
+    memmove(json->buffer, json->buffer + n, json->n_bytes - n);
+    json->n_bytes -= n;
+    json->n_spilled += n;
+    return true;
+
+}
+
+size_t rc_curl_write_json(char* contents, size_t size, size_t nitems, void* userdata) {
 
     JsonContent* json = (JsonContent*)userdata;
     const size_t chunk_size = size * nitems;
-    const size_t old_size = json->n_bytes;
+    size_t old_size = json->n_bytes;
 
     if (!chunk_size) { return 0; }
     const char* head = NULL;
+
+    // the next page has started, so every byte in the buffer is final
+    if (json->max_size && json->n_pages > 0 && json->n_chunk == 0 && json->n_bytes > json->max_size)
+    { if (rc_json_spill(json)) { old_size = json->n_bytes; } else { return 0; } }
     size_t n_bytes = 0;
 
     if (json->n_pages == 0 || json->n_chunk > 0) {
@@ -77,16 +112,19 @@ static inline void rc_json_bridge(char* cursor, const char* buffer) {
 
 }
 
-static inline void rc_json_reset(JsonContent* json) {
+void rc_json_reset(JsonContent* json) {
 
     json->n_bytes = 0;
     json->n_pages = 0;
     json->n_chunk = 0;
     json->url_next_page = NULL;
 
+    if (json->spill) { fclose(json->spill); json->spill = NULL; }
+    json->n_spilled = 0;
+
 }
 
-static void rc_curl_next_page(JsonContent* json) {
+void rc_curl_next_page(JsonContent* json) {
 
     if (json->n_bytes) {
 
@@ -121,8 +159,55 @@ static void rc_curl_next_page(JsonContent* json) {
 
 }
 
+// close the only page of a non-paginated endpoint, without looking for a next one
+static void rc_json_last_page(JsonContent* json) {
+
+    if (json->n_bytes) {
+
+        json->n_pages++;
+        json->n_chunk = 0;
+        json->buffer[json->n_bytes] = '\0';
+
+    }
+
+    json->url_next_page = NULL;
+
+}
+
+// paging.totalPages of a first page not yet closed by rc_curl_next_page; 0 if not given
+static size_t rc_json_total_pages(JsonContent* json) {
+
+    if (json->n_bytes == 0) { return 0; }
+
+    char* cursor = json->buffer + json->n_bytes;
+    cursor[0] = '\0';
+
+    while (cursor-- > json->buffer && *cursor != ']');
+    if (cursor <= json->buffer) { return 0; }
+
+    const char* total = strstr(cursor, "\"totalPages\"");
+    if (total) { total = strchr(total + 12, ':'); }
+
+    return total ? strtoul(total + 1, NULL, 10) : 0;
+
+}
+
+// drop the partial data of a failed page, back to the page boundary at mark (see rc_json_size)
+static void rc_json_rollback(JsonContent* json, size_t mark) {
+
+    json->n_bytes = mark - json->n_spilled; // a spill only moves completed pages
+    json->n_chunk = 0;
+
+}
+
 void rc_json_get_buffer(BearerToken* token, JsonContent* json, const char* url) {
 
+    struct Flight* flight = NULL;
+    if (token->flight && rc_flight_join(token->flight, token, RC_FLIGHT_JSON, url, json, &flight)) { return; }
+
+    const Endpoint* endpoint = rc_endpoint_find(url);
+    const PagingStyle paging = endpoint ? endpoint->paging : RC_PAGING_LINKS;
+
     CURL* curl = curl_easy_init();
 
     if (curl) {
@@ -133,18 +218,42 @@ void rc_json_get_buffer(BearerToken* token, JsonContent* json, const char* url)
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, rc_curl_write_json);
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, json);
         
-    } else { token->s_token = RC_CURL_INIT_FAILED; return; }
+    } else { token->s_token = RC_CURL_INIT_FAILED; rc_flight_land(token->flight, flight, token); return; }
 
     do {
 
-        if (rc_curl_auto_perform(token, curl) != RC_TOKEN_OK) { break; }
+        const uint64_t start = rc_trace_clock();
+        const size_t page = json->n_pages;
+        const size_t mark = rc_json_size(json);
+        uint64_t attempt = MAX_RETRY_ATTEMPT;
+        uint64_t timeout = MIN_RETRY_TIMEOUT;
+        size_t n_total = 0;
+        TokenError result;
+
+        // a failed page is rolled back and requested again, not the whole loop
+        while ((result = rc_curl_auto_perform(token, curl)) != RC_TOKEN_OK && rc_curl_retry(token, &attempt, &timeout))
+        { rc_json_rollback(json, mark); }
+
+        if (result != RC_TOKEN_OK) { rc_trace_span(RC_TRACE_PAGE, start, page); break; }
+
+        // concurrent pages need a budget shared by their requests, or they would all draw 429s together
+        if (page == 0 && paging == RC_PAGING_PAGES && json->max_size == 0 && token->limiter) { n_total = rc_json_total_pages(json); }
+
+        if (paging == RC_PAGING_NONE) { rc_json_last_page(json); }
         else { rc_curl_next_page(json); }
 
+        rc_trace_span(RC_TRACE_PAGE, start, page);
+
+        // the other numbered pages are requested together; any left after them one by one
+        if (n_total > 2 && json->url_next_page && rc_fan_pages(token, json, n_total, 0)
+            && token->s_token != RC_TOKEN_OK) { break; }
+
         curl_easy_setopt(curl, CURLOPT_URL, json->url_next_page);
 
     } while (json->url_next_page);
     
     curl_easy_cleanup(curl);
+    rc_flight_land(token->flight, flight, token);
     
 }
 
@@ -157,11 +266,17 @@ const char* rc_json_get_file(BearerToken* token, const char* file, const char* u
 
     if (f) {
 
+        ChecksumFile checked = { .f = f };
+        const bool manifest = file && rc_manifest_enabled();
+        if (manifest) { rc_checksum_init(&checked.checksum); }
+
         curl_easy_setopt(curl, CURLOPT_URL, url);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, NULL);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, f);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, manifest ? rc_curl_write_checked : NULL);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, manifest ? (void*)&checked : (void*)f);
 
         rc_curl_auto_perform(token, curl);
+
+        if (manifest && token->s_token == RC_TOKEN_OK) { rc_manifest_append(file, &checked.checksum, url, curl); }
         curl_easy_cleanup(curl);
 
         if (file) { fclose(f); }   // If file is null, f is stdout. Do not close.
@@ -179,15 +294,41 @@ const char* rc_json_get_file(BearerToken* token, const char* file, const char* u
 
 const char* rc_json_fwrite(JsonContent* json, const char* file) {
 
-    if (json->n_bytes == 0) { return NULL; }
+    if (rc_json_size(json) == 0) { return NULL; }
 
     FILE* f = file ? fopen(file, "w") : stdout;
 
     if (f) {
 
+        char chunk[JSON_READ_SIZE];
+        size_t offset = 0;
+
+        Checksum checksum;
+        const bool manifest = file && rc_manifest_enabled();
+        if (manifest) { rc_checksum_init(&checksum); }
+
+        // spilled pages are copied through a small buffer, not reloaded at once
+        for (size_t n; offset < json->n_spilled; offset += n) {
+
+            n = rc_json_read(json, offset, chunk, json->n_spilled - offset < JSON_READ_SIZE
+                                                ? json->n_spilled - offset : JSON_READ_SIZE);
+            if (n) { fwrite(chunk, 1, n, f); }
+            else { break; }
+
+            if (manifest) { rc_checksum_update(&checksum, chunk, n); }
+
+        }
+
         fwrite(json->buffer, 1, json->n_bytes, f);
         fflush(f);
 
+        if (manifest) {
+
+            rc_checksum_update(&checksum, json->buffer, json->n_bytes);
+            rc_manifest_append(file, &checksum, NULL, NULL);
+
+        }
+
         if (file) { fclose(f); }   // If file is null, f is stdout. Do not close.
         else { fprintf(f, "\n"); } // For stdout, print an additional new line.
         return file;
@@ -195,3 +336,81 @@ const char* rc_json_fwrite(JsonContent* json, const char* file) {
     } else { return NULL; }
 
 }
+
+size_t rc_json_size(const JsonContent* json) { return json->n_spilled + json->n_bytes; }
+
+size_t rc_json_read(const JsonContent* json, size_t offset, char* dest, size_t n) {
+
+    size_t n_read = 0;
+
+    if (offset < json->n_spilled) {
+
+        const size_t n_file = json->n_spilled - offset < n ? json->n_spilled - offset : n;
+        const ssize_t result = pread(fileno(json->spill), dest, n_file, (off_t)offset);
+
+        if (result > 0) { n_read = (size_t)result; }
+        if (n_read < n_file) { return n_read; }
+
+    }
+
+    if (n_read < n && offset + n_read < rc_json_size(json)) {
+
+        const size_t begin = offset + n_read - json->n_spilled;
+        const size_t n_memory = json->n_bytes - begin < n - n_read ? json->n_bytes - begin : n - n_read;
+
+        memcpy(dest + n_read, json->buffer + begin, n_memory);
+        n_read += n_memory;
+
+    }
+
+    return n_read;
+
+}
+
+bool rc_json_copy(JsonContent* json, const JsonContent* source) {
+
+    rc_json_reset(json);
+
+    if (source->n_spilled) {
+
+        char chunk[JSON_READ_SIZE];
+        json->spill = tmpfile();
+        if (json->spill == NULL) { return false; }
+
+        for (size_t offset = 0, n; offset < source->n_spilled; offset += n) {
+
+            n = rc_json_read(source, offset, chunk, source->n_spilled - offset < JSON_READ_SIZE
+                                                    ? source->n_spilled - offset : JSON_READ_SIZE);
+            if (n == 0 || fwrite(chunk, 1, n, json->spill) != n) { return false; }
+
+        }
+
+        if (fflush(json->spill) != 0) { return false; }
+        json->n_spilled = source->n_spilled;
+
+    }
+
+    if (source->n_bytes >= json->total_size) {
+
+        const size_t total_size = MUL(source->n_bytes, json->init_size);
+        char* buffer = realloc(json->buffer, total_size);
+
+        if (buffer) { json->buffer = buffer; json->total_size = total_size; }
+        else { return false; }
+
+    }
+
+    if (source->n_bytes) { memcpy(json->buffer, source->buffer, source->n_bytes); }
+    json->buffer[source->n_bytes] = '\0';
+    json->n_bytes = source->n_bytes;
+    json->n_pages = source->n_pages;
+    return true;
+
+}
+
+void rc_json_free(JsonContent* json) {
+
+    if (json->spill) { fclose(json->spill); json->spill = NULL; }
+    free(json->buffer);
+
+}
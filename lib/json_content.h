@@ -21,6 +21,7 @@
 
 #define JSON_INIT_SIZE (1 << 20)
 
+#include <stdio.h>
 #include "bearer_token.h"
 
 /**
@@ -40,6 +41,13 @@
  * -- Freeing Memory --
  * RIGHT: RC_JSON_FREE(json);
  * 
+ * -- Bounded Memory --
+ * JsonContent* json = RC_JSON_INIT_CAPPED(0, 256 << 20);
+ * Once the buffer holds more than the cap (256 megabytes here) at a page
+ * boundary, the completed pages are moved to an anonymous temporary file;
+ * the buffer then only holds the pages fetched since. rc_json_fwrite and
+ * rc_json_read serve the combined contents from both.
+ *
  * - Do not assume/directly modify its member variables or buffer
  * - Must be freed with RC_JSON_FREE when done
  */
@@ -55,6 +63,10 @@ typedef struct {
 
     const char* url_next_page;
 
+    const size_t max_size; // 0 for no memory cap
+    size_t n_spilled;
+    FILE* spill;
+
 } JsonContent;
 
 /// @brief Store JSON response in memory
@@ -80,24 +92,74 @@ const char* rc_json_get_file(BearerToken* token, const char* file, const char* u
 ///         otherwise, NULL
 const char* rc_json_fwrite(JsonContent* json, const char* file);
 
+/// @brief Size of the combined contents of a JsonContent, in memory and spilled
+/// @param json pointer to a JsonContent container
+/// @return number of bytes
+size_t rc_json_size(const JsonContent* json);
+
+/// @brief Copy part of the combined contents of a JsonContent
+/// @param json pointer to a JsonContent container
+/// @param offset position in the combined contents to start from
+/// @param dest destination buffer
+/// @param n maximum number of bytes to copy
+/// @return number of bytes copied; 0 once offset reaches rc_json_size
+size_t rc_json_read(const JsonContent* json, size_t offset, char* dest, size_t n);
+
+/// @brief Free a JsonContent's buffer and remove its spill file
+/// @param json pointer to a JsonContent container
+void rc_json_free(JsonContent* json);
+
 /// @brief Create and initialize a JsonContent container on the stack
 /// @param X initial buffer size to reserve (default is 1 megabyte)
 /// @return a pointer to the initialized JsonContent
 /// @note To accept default reserve buffer size (1 megabyte), pass in 0;
 ///       Otherwise, pass in the desired reserve buffer size as a size_t
-#define RC_JSON_INIT(X) &(JsonContent)       \
-{                                            \
-    .buffer = NULL,                          \
-    .n_bytes = 0,                            \
-    .n_pages = 0,                            \
-    .n_chunk = 0,                            \
-    .init_size = X > 0 ? X : JSON_INIT_SIZE, \
-    .total_size = 0,                         \
-    .url_next_page = NULL                    \
+#define RC_JSON_INIT(X) RC_JSON_INIT_CAPPED(X, 0)
+
+/// @brief Create and initialize a JsonContent container with a memory cap on the stack
+/// @param X initial buffer size to reserve (default is 1 megabyte)
+/// @param Y buffer size past which completed pages spill to a temporary file
+/// @return a pointer to the initialized JsonContent
+/// @note Memory use is bounded by the cap plus the size of one page
+#define RC_JSON_INIT_CAPPED(X, Y) &(JsonContent) \
+{                                                \
+    .buffer = NULL,                              \
+    .n_bytes = 0,                                \
+    .n_pages = 0,                                \
+    .n_chunk = 0,                                \
+    .init_size = X > 0 ? X : JSON_INIT_SIZE,     \
+    .total_size = 0,                             \
+    .url_next_page = NULL,                       \
+    .max_size = Y,                               \
+    .n_spilled = 0,                              \
+    .spill = NULL                                \
 }
 
-/// @brief Free a JsonContent's buffer
+/// @brief Free a JsonContent's buffer (and spill file)
 /// @param X pointer to a JsonContent container
-#define RC_JSON_FREE(X) free((X)->buffer)
+#define RC_JSON_FREE(X) rc_json_free(X)
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief CURLOPT_WRITEFUNCTION appending a page of a JSON response
+/// @note userdata must be a pointer to a JsonContent container
+size_t rc_curl_write_json(char* contents, size_t size, size_t nitems, void* userdata);
+
+/// @brief prepare a JsonContent container for a new page loop
+/// @param json pointer to a JsonContent container
+void rc_json_reset(JsonContent* json);
+
+/// @brief copy the complete response held by another container (spilled pages included)
+/// @param json pointer to a JsonContent container, reset first
+/// @param source pointer to a JsonContent container whose page loop has completed
+/// @return false if out of memory or the spill file could not be written
+bool rc_json_copy(JsonContent* json, const JsonContent* source);
+
+/// @brief close the page just written and find the url of the next one
+/// @param json pointer to a JsonContent container
+/// @note json->url_next_page is set to NULL once there are no more pages
+void rc_curl_next_page(JsonContent* json);
+
+#endif // RINGEXTRACT_H
 
 #endif
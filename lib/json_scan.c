@@ -0,0 +1,355 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "json_scan.h"
+
+static inline const char* rc_scan_space(const char* c, const char* end) {
+
+    while (c < end && (*c == ' ' || *c == '\n' || *c == '\r' || *c == '\t' || *c == ',')) { c++; }
+    return c;
+
+}
+
+// returns pointer one past the value starting at c
+static const char* rc_scan_skip(const char* c, const char* end) {
+
+    size_t depth = 0;
+    bool string = false;
+
+    for (; c < end; c++) {
+
+        if (string) {
+
+            if (*c == '\\') { c++; }
+            else if (*c == '"') { string = false; if (depth == 0) { return c + 1; } }
+            continue;
+
+        }
+
+        switch (*c) {
+
+        case '"':
+            string = true;
+            break;
+
+        case '{':
+        case '[':
+            depth++;
+            break;
+
+        case '}':
+        case ']':
+            if (depth == 0) { return c; } // end of enclosing container
+            if (--depth == 0) { return c + 1; }
+            break;
+
+        case ',':
+        case ' ':
+        case '\n':
+        case '\r':
+        case '\t':
+            if (depth == 0) { return c; } // end of a literal
+            break;
+
+        default:
+            break;
+
+        }
+
+    }
+
+    return end;
+
+}
+
+const char* rc_scan_field(const char* object, size_t n, const char* key, size_t* length) {
+
+    const char* end = object + n;
+    const char* c = memchr(object, '{', n);
+    const size_t key_size = strlen(key);
+
+    if (c) { c++; }
+    else { return NULL; }
+
+    while ((c = rc_scan_space(c, end)) < end && *c == '"') {
+
+        const char* name = c + 1;
+        c = rc_scan_skip(c, end);
+
+        const bool match = (size_t)(c - name) == key_size + 1 && memcmp(name, key, key_size) == 0;
+
+        while (c < end && *c != ':') { c++; }
+        c = rc_scan_space(c + 1, end);
+
+        const char* value = c;
+        c = rc_scan_skip(c, end);
+
+        if (match) { *length = c - value; return value; }
+
+    }
+
+    return NULL;
+
+}
+
+const char* rc_scan_path(const char* object, size_t n, const char* path, size_t* length) {
+
+    char key[64];
+    const char* dot;
+
+    while ((dot = strchr(path, '.')) && (size_t)(dot - path) < sizeof(key)) {
+
+        memcpy(key, path, dot - path);
+        key[dot - path] = '\0';
+
+        object = rc_scan_field(object, n, key, &n);
+        if (object == NULL) { return NULL; }
+        else { path = dot + 1; }
+
+    }
+
+    return rc_scan_field(object, n, path, length);
+
+}
+
+bool rc_scan_records(JsonScan* scan, const char* buffer, size_t n) {
+
+    size_t length = 0;
+    const char* records = n ? rc_scan_field(buffer, n, "records", &length) : NULL;
+
+    if (records && *records == '[') {
+
+        rc_scan_array(scan, records, length);
+        return true;
+
+    } else { scan->cursor = scan->end = buffer; return false; }
+
+}
+
+void rc_scan_array(JsonScan* scan, const char* buffer, size_t n) {
+
+    scan->cursor = buffer;
+    scan->end = buffer + n;
+
+    scan->cursor = rc_scan_space(scan->cursor, scan->end);
+    if (scan->cursor < scan->end && *scan->cursor == '[') { scan->cursor++; }
+
+}
+
+const char* rc_scan_next(JsonScan* scan, size_t* n) {
+
+    const char* c = rc_scan_space(scan->cursor, scan->end);
+    if (c >= scan->end || *c == ']' || *c == '}') { scan->cursor = scan->end; return NULL; }
+
+    scan->cursor = rc_scan_skip(c, scan->end);
+    *n = scan->cursor - c;
+    return c;
+
+}
+
+int64_t rc_scan_int(const char* value, size_t n) {
+
+    char digits[24];
+
+    if (n >= 2 && *value == '"') { value++; n -= 2; }
+    if (n == 0 || n >= sizeof(digits)) { return 0; }
+
+    memcpy(digits, value, n);
+    digits[n] = '\0';
+    return strtoll(digits, NULL, 10);
+
+}
+
+static inline int rc_scan_hex(const char* c) {
+
+    int value = 0;
+
+    for (int i = 0; i < 4; i++) {
+
+        const char h = c[i];
+        value <<= 4;
+
+        if (h >= '0' && h <= '9') { value |= h - '0'; }
+        else if (h >= 'a' && h <= 'f') { value |= h - 'a' + 10; }
+        else if (h >= 'A' && h <= 'F') { value |= h - 'A' + 10; }
+        else { return -1; }
+
+    }
+
+    return value;
+
+}
+
+static inline size_t rc_scan_utf8(uint32_t code, char* dest) {
+
+    if (code < 0x80) { dest[0] = (char)code; return 1; }
+
+    if (code < 0x800) {
+
+        dest[0] = (char)(0xC0 | (code >> 6));
+        dest[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+
+    }
+
+    if (code < 0x10000) {
+
+        dest[0] = (char)(0xE0 | (code >> 12));
+        dest[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        dest[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+
+    }
+
+    dest[0] = (char)(0xF0 | (code >> 18));
+    dest[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    dest[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    dest[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+
+}
+
+// every escape sequence is at least as long as its UTF-8 output,
+// so the decoded string never needs more than n bytes
+size_t rc_scan_string(const char* value, size_t n, char* dest) {
+
+    if (n < 2 || value[0] != '"') { return 0; }
+
+    const char* c = value + 1;
+    const char* end = value + n - 1;
+    char* out = dest;
+
+    while (c < end) {
+
+        if (*c != '\\') { *out++ = *c++; continue; }
+        if (++c == end) { break; }
+
+        switch (*c++) {
+
+        case 'n': *out++ = '\n'; break;
+        case 't': *out++ = '\t'; break;
+        case 'r': *out++ = '\r'; break;
+        case 'b': *out++ = '\b'; break;
+        case 'f': *out++ = '\f'; break;
+
+        case 'u': {
+
+            int code = end - c >= 4 ? rc_scan_hex(c) : -1;
+            if (code < 0) { *out++ = '?'; break; }
+            else { c += 4; }
+
+            // surrogate pair
+            if (code >= 0xD800 && code < 0xDC00 && end - c >= 6 && c[0] == '\\' && c[1] == 'u') {
+
+                const int low = rc_scan_hex(c + 2);
+
+                if (low >= 0xDC00 && low < 0xE000) {
+
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    c += 6;
+
+                }
+
+            }
+
+            out += rc_scan_utf8((uint32_t)code, out);
+            break;
+
+        }
+
+        default: *out++ = c[-1]; break; // \" \\ \/
+
+        }
+
+    }
+
+    return out - dest;
+
+}
+
+static inline int64_t rc_scan_digits(const char** c, const char* end, int n) {
+
+    int64_t value = 0;
+
+    for (int i = 0; i < n; i++, (*c)++) {
+
+        if (*c >= end || **c < '0' || **c > '9') { return -1; }
+        value = value * 10 + (**c - '0');
+
+    }
+
+    return value;
+
+}
+
+int64_t rc_scan_time(const char* value, size_t n) {
+
+    if (n < 2 || value[0] != '"') { return 0; }
+
+    const char* c = value + 1;
+    const char* end = value + n - 1;
+
+    const int64_t year = rc_scan_digits(&c, end, 4);
+    if (c < end && *c == '-') { c++; }
+    const int64_t month = rc_scan_digits(&c, end, 2);
+    if (c < end && *c == '-') { c++; }
+    const int64_t day = rc_scan_digits(&c, end, 2);
+    if (c < end && (*c == 'T' || *c == ' ')) { c++; }
+    const int64_t hour = rc_scan_digits(&c, end, 2);
+    if (c < end && *c == ':') { c++; }
+    const int64_t minute = rc_scan_digits(&c, end, 2);
+    if (c < end && *c == ':') { c++; }
+    const int64_t second = rc_scan_digits(&c, end, 2);
+
+    if (year < 0 || month < 1 || month > 12 || day < 1 || hour < 0 || minute < 0 || second < 0) { return 0; }
+
+    int64_t millis = 0;
+
+    if (c < end && *c == '.') {
+
+        int64_t scale = 100;
+        for (c++; c < end && *c >= '0' && *c <= '9'; c++, scale /= 10) { millis += (*c - '0') * scale; }
+
+    }
+
+    int64_t offset = 0;
+
+    if (c < end && (*c == '+' || *c == '-')) {
+
+        const int64_t sign = *c++ == '-' ? -1 : 1;
+        const int64_t h = rc_scan_digits(&c, end, 2);
+        if (c < end && *c == ':') { c++; }
+        const int64_t m = rc_scan_digits(&c, end, 2);
+        if (h >= 0 && m >= 0) { offset = sign * (h * 3600 + m * 60); }
+
+    }
+
+    // days from civil (proleptic Gregorian calendar)
+    const int64_t y = year - (month <= 2);
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const int64_t yoe = y - era * 400;
+    const int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    const int64_t days = era * 146097 + doe - 719468;
+
+    return ((days * 86400 + hour * 3600 + minute * 60 + second) - offset) * 1000 + millis;
+
+}
@@ -0,0 +1,94 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_JSON_SCAN_H
+#define RC_JSON_SCAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Minimal, allocation-free scanner over RingEX list responses
+ *
+ * Not a validating parser: it only tracks strings, escapes and nesting
+ * well enough to walk the records of a (possibly stitched) response
+ * and to look up top-level fields of each record in place.
+ */
+typedef struct {
+
+    const char* cursor;
+    const char* end;
+
+} JsonScan;
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief position a scanner at the first element of the "records" array
+/// @param scan pointer to a JsonScan
+/// @param buffer a complete JSON response (e.g. JsonContent buffer)
+/// @param n number of bytes in buffer
+/// @return true if a records array was found
+bool rc_scan_records(JsonScan* scan, const char* buffer, size_t n);
+
+/// @brief position a scanner over raw array elements (e.g. a page fragment)
+/// @param scan pointer to a JsonScan
+/// @param buffer array elements, optionally preceded by '[' or ','
+/// @param n number of bytes in buffer
+void rc_scan_array(JsonScan* scan, const char* buffer, size_t n);
+
+/// @brief get the next element of the array
+/// @param scan pointer to a JsonScan
+/// @param n set to the number of bytes in the element
+/// @return pointer to the first byte of the element; NULL at the end of the array
+const char* rc_scan_next(JsonScan* scan, size_t* n);
+
+/// @brief look up a top-level field of a JSON object
+/// @param object pointer to the opening '{' of the object
+/// @param n number of bytes in the object
+/// @param key field name (without quotes)
+/// @param length set to the number of bytes in the value (strings include quotes)
+/// @return pointer to the first byte of the value; NULL if not found
+const char* rc_scan_field(const char* object, size_t n, const char* key, size_t* length);
+
+/// @brief look up a field by path of nested object keys, e.g. "to.name"
+/// @return pointer to the first byte of the value; NULL if not found
+const char* rc_scan_path(const char* object, size_t n, const char* path, size_t* length);
+
+/// @brief parse an integer value, quoted (as RingEX returns most ids) or not
+/// @param value pointer returned by rc_scan_field
+/// @param n length returned by rc_scan_field
+/// @return the integer value; 0 if not a number
+int64_t rc_scan_int(const char* value, size_t n);
+
+/// @brief decode a string value (quoted, with JSON escapes) into UTF-8
+/// @param value pointer returned by rc_scan_field
+/// @param n length returned by rc_scan_field
+/// @param dest destination with room for at least n bytes (not null-terminated)
+/// @return number of bytes written; 0 if not a string
+size_t rc_scan_string(const char* value, size_t n, char* dest);
+
+/// @brief parse an ISO 8601 timestamp value, e.g. "2024-03-01T09:30:00.000Z"
+/// @param value pointer returned by rc_scan_field
+/// @param n length returned by rc_scan_field
+/// @return milliseconds since the Unix epoch (UTC); 0 if not a timestamp
+int64_t rc_scan_time(const char* value, size_t n);
+
+#endif // RINGEXTRACT_H
+
+#endif // RC_JSON_SCAN_H
@@ -0,0 +1,121 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "manifest.h"
+
+static FILE* _Atomic rc_manifest = NULL;
+static pthread_mutex_t rc_manifest_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void rc_manifest_string(FILE* f, const char* value) {
+
+    if (value == NULL) { fputs("null", f); return; }
+
+    fputc('"', f);
+
+    for (const unsigned char* c = (const unsigned char*)value; *c; c++) {
+
+        if (*c == '"' || *c == '\\') { fputc('\\', f); fputc(*c, f); }
+        else if (*c < 0x20) { fprintf(f, "\\u%04x", *c); }
+        else { fputc(*c, f); }
+
+    }
+
+    fputc('"', f);
+
+}
+
+const char* rc_manifest_start(const char* file) {
+
+    FILE* f = fopen(file, "a");
+    if (f == NULL) { return NULL; }
+
+    pthread_mutex_lock(&rc_manifest_lock);
+    FILE* old = atomic_exchange(&rc_manifest, f);
+    if (old) { fclose(old); }
+    pthread_mutex_unlock(&rc_manifest_lock);
+
+    return file;
+
+}
+
+void rc_manifest_stop(void) {
+
+    pthread_mutex_lock(&rc_manifest_lock);
+    FILE* f = atomic_exchange(&rc_manifest, NULL);
+    if (f) { fclose(f); }
+    pthread_mutex_unlock(&rc_manifest_lock);
+
+}
+
+bool rc_manifest_enabled(void) { return atomic_load(&rc_manifest) != NULL; }
+
+size_t rc_curl_write_checked(char* contents, size_t size, size_t nitems, void* userdata) {
+
+    ChecksumFile* checked = (ChecksumFile*)userdata;
+    const size_t n = fwrite(contents, size, nitems, checked->f) * size;
+
+    rc_checksum_update(&checked->checksum, contents, n);
+    return n;
+
+}
+
+void rc_manifest_append(const char* file, Checksum* checksum, const char* url, CURL* curl) {
+
+    uint8_t digest[SHA256_SIZE];
+    long status = 0;
+    curl_off_t total = 0;
+    curl_off_t ttfb = 0;
+
+    rc_checksum_final(checksum, digest);
+
+    if (curl) {
+
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+        curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &ttfb);
+
+    }
+
+    pthread_mutex_lock(&rc_manifest_lock);
+    FILE* f = atomic_load(&rc_manifest);
+
+    if (f) {
+
+        fputs("{\"path\":", f);
+        rc_manifest_string(f, file);
+        fprintf(f, ",\"size\":%llu,\"crc32c\":\"%08x\",\"sha256\":\"",
+                (unsigned long long)checksum->n_bytes, (unsigned int)checksum->crc32c);
+
+        for (size_t i = 0; i < SHA256_SIZE; i++) { fprintf(f, "%02x", digest[i]); }
+
+        fputs("\",\"url\":", f);
+        rc_manifest_string(f, url);
+
+        if (curl) { fprintf(f, ",\"status\":%ld,\"total_ms\":%.1f,\"ttfb_ms\":%.1f}\n", status, total / 1e3, ttfb / 1e3); }
+        else { fputs(",\"status\":null,\"total_ms\":null,\"ttfb_ms\":null}\n", f); }
+
+        fflush(f);
+
+    }
+
+    pthread_mutex_unlock(&rc_manifest_lock);
+
+}
@@ -0,0 +1,87 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_MANIFEST_H
+#define RC_MANIFEST_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <curl/curl.h>
+#include "checksum.h"
+
+/**
+ * Optional download manifest, disabled by default
+ *
+ * Once started, rc_media_get_file, rc_media_fwrite, rc_json_get_file and
+ * rc_json_fwrite compute a CRC32C and a SHA-256 of every file they write,
+ * incrementally as the bytes pass through their write path, and append an
+ * entry per file to the manifest (one JSON object per line):
+ *
+ * {"path":"a.mp3","size":48213,"crc32c":"1b2f03a4","sha256":"9f86...",
+ *  "url":"https://...","status":200,"total_ms":412.3,"ttfb_ms":120.8}
+ *
+ * url, status and timings are null for rc_media_fwrite / rc_json_fwrite,
+ * which write a container fetched earlier. Files written to stdout and
+ * failed downloads get no entry.
+ *
+ * rc_manifest_start("manifest.jsonl");
+ * rc_media_get_file(token, "a.mp3", url);
+ * rc_manifest_stop();
+ *
+ * - Entries are appended, so a manifest can span several runs and processes
+ * - Safe to use from several threads; entries are written whole
+ */
+
+/// @brief Start appending an entry for every file written
+/// @param file manifest to append to (created if it does not exist)
+/// @return the file name (same as the file argument); NULL if it could not be
+///         opened (manifest stays disabled)
+const char* rc_manifest_start(const char* file);
+
+/// @brief Stop writing entries and close the manifest
+/// @note Must not be called while other threads are still writing files
+void rc_manifest_stop(void);
+
+/// @brief Checksum state threaded through a file write callback
+typedef struct ChecksumFile {
+
+    FILE* f;
+    Checksum checksum;
+
+} ChecksumFile;
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief whether files written now need a manifest entry
+/// @return true once rc_manifest_start has succeeded
+bool rc_manifest_enabled(void);
+
+/// @brief CURLOPT_WRITEFUNCTION writing to a file while updating its checksum
+/// @param userdata pointer to a ChecksumFile
+size_t rc_curl_write_checked(char* contents, size_t size, size_t nitems, void* userdata);
+
+/// @brief finish a checksum and append the file's entry to the manifest
+/// @param file path of the file written
+/// @param checksum checksum of everything written to it (finalized here)
+/// @param url source url; NULL if unknown
+/// @param curl handle of the completed transfer, for status and timings; NULL if none
+void rc_manifest_append(const char* file, Checksum* checksum, const char* url, CURL* curl);
+
+#endif // RINGEXTRACT_H
+
+#endif // RC_MANIFEST_H
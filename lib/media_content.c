@@ -18,10 +18,13 @@
 
 #include <string.h>
 #include "media_content.h"
+#include "manifest.h"
+#include "file_writer.h"
+#include "single_flight.h"
 
 #define MUL(X, Y) (((X) / (Y) + 1) * (Y))
 
-static size_t rc_curl_write_media(char* contents, size_t size, size_t nitems, void* userdata) {
+size_t rc_curl_write_media(char* contents, size_t size, size_t nitems, void* userdata) {
 
     MediaContent* media = (MediaContent*)userdata;
     const size_t chunk_size = size * nitems;
@@ -47,8 +50,31 @@ static size_t rc_curl_write_media(char* contents, size_t size, size_t nitems, vo
 
 static inline void rc_media_reset(MediaContent* media) { media->n_bytes = 0; }
 
+bool rc_media_copy(MediaContent* media, const MediaContent* source) {
+
+    rc_media_reset(media);
+
+    if (source->n_bytes > media->total_size) {
+
+        const size_t total_size = MUL(source->n_bytes, media->init_size);
+        uint8_t* buffer = realloc(media->buffer, total_size);
+
+        if (buffer) { media->buffer = buffer; media->total_size = total_size; }
+        else { return false; }
+
+    }
+
+    if (source->n_bytes) { memcpy(media->buffer, source->buffer, source->n_bytes); }
+    media->n_bytes = source->n_bytes;
+    return true;
+
+}
+
 void rc_media_get_buffer(BearerToken* token, MediaContent* media, const char* url) {
 
+    struct Flight* flight = NULL;
+    if (token->flight && rc_flight_join(token->flight, token, RC_FLIGHT_MEDIA, url, media, &flight)) { return; }
+
     CURL* curl = curl_easy_init();
 
     if (curl) {
@@ -64,6 +90,8 @@ void rc_media_get_buffer(BearerToken* token, MediaContent* media, const char* ur
 
     } else { token->s_token = RC_CURL_INIT_FAILED; }
 
+    rc_flight_land(token->flight, flight, token);
+
 }
 
 const char* rc_media_get_file(BearerToken* token, const char* file, const char* url) {
@@ -71,17 +99,31 @@ const char* rc_media_get_file(BearerToken* token, const char* file, const char*
     CURL* curl = curl_easy_init();
     if (!curl) { token->s_token = RC_CURL_INIT_FAILED; return NULL; }
 
+    if (token->writer) {
+
+        const char* written = rc_writer_get_file(token->writer, token, curl, file, url);
+        curl_easy_cleanup(curl);
+        return written;
+
+    }
+
     FILE* f = fopen(file, "wb");
 
     if (f) {
 
+        ChecksumFile checked = { .f = f };
+        const bool manifest = rc_manifest_enabled();
+        if (manifest) { rc_checksum_init(&checked.checksum); }
+
         curl_easy_setopt(curl, CURLOPT_URL, url);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, NULL);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, f);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, manifest ? rc_curl_write_checked : NULL);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, manifest ? (void*)&checked : (void*)f);
 
         rc_curl_auto_perform(token, curl);
         fclose(f);
 
+        if (manifest && token->s_token == RC_TOKEN_OK) { rc_manifest_append(file, &checked.checksum, url, curl); }
+
         curl_easy_cleanup(curl);
         return file;
 
@@ -106,6 +148,15 @@ const char* rc_media_fwrite(MediaContent* media, const char* file) {
         fflush(f);
         fclose(f);
 
+        if (rc_manifest_enabled()) {
+
+            Checksum checksum;
+            rc_checksum_init(&checksum);
+            rc_checksum_update(&checksum, media->buffer, media->n_bytes);
+            rc_manifest_append(file, &checksum, NULL, NULL);
+
+        }
+
         return file;
 
     } else { return NULL; }
@@ -91,4 +91,18 @@ const char* rc_media_fwrite(MediaContent* media, const char* file);
 /// @param X pointer to a MediaContent container
 #define RC_MEDIA_FREE(X) free((X)->buffer)
 
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief CURLOPT_WRITEFUNCTION appending a chunk of binary media
+/// @note userdata must be a pointer to a MediaContent container
+size_t rc_curl_write_media(char* contents, size_t size, size_t nitems, void* userdata);
+
+/// @brief copy the binary media held by another container
+/// @param media pointer to a MediaContent container
+/// @param source pointer to a MediaContent container
+/// @return false if out of memory
+bool rc_media_copy(MediaContent* media, const MediaContent* source);
+
+#endif // RINGEXTRACT_H
+
 #endif
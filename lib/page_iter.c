@@ -0,0 +1,88 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "page_iter.h"
+#include "rate_limiter.h"
+#include "tracer.h"
+
+PageIter* rc_iter_begin(BearerToken* token, const char* url, size_t init_size) {
+
+    PageIter* iter = malloc(sizeof(PageIter));
+    CURL* curl = iter && strlen(url) < RING_URL_SIZE ? curl_easy_init() : NULL;
+
+    if (curl == NULL) { token->s_token = RC_CURL_INIT_FAILED; free(iter); return NULL; }
+
+    memcpy(&iter->page, RC_JSON_INIT(init_size), sizeof(JsonContent));
+    memcpy(iter->next, url, strlen(url) + 1);
+
+    iter->token = token;
+    iter->curl = curl;
+    iter->scan.cursor = iter->scan.end = NULL;
+    iter->more = true;
+    iter->n_pages = 0;
+
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, rc_curl_write_json);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &iter->page);
+    return iter;
+
+}
+
+const JsonContent* rc_iter_next(PageIter* iter) {
+
+    JsonContent* page = &iter->page;
+    iter->scan.cursor = iter->scan.end = NULL;
+
+    if (!iter->more) { return NULL; }
+    else { iter->more = false; }
+
+    const uint64_t start = rc_trace_clock();
+    uint64_t attempt = MAX_RETRY_ATTEMPT;
+    uint64_t timeout = MIN_RETRY_TIMEOUT;
+    TokenError result;
+
+    curl_easy_setopt(iter->curl, CURLOPT_URL, iter->next);
+
+    // each page is kept whole, as a first page would be; a failed page is dropped and requested again
+    do { rc_json_reset(page); }
+    while ((result = rc_curl_auto_perform(iter->token, iter->curl)) != RC_TOKEN_OK
+           && rc_curl_retry(iter->token, &attempt, &timeout));
+
+    rc_trace_span(RC_TRACE_PAGE, start, iter->n_pages);
+
+    if (result != RC_TOKEN_OK || page->n_bytes == 0) { return NULL; }
+    else { page->buffer[page->n_bytes] = '\0'; }
+
+    iter->more = rc_ring_next_page(iter->token, page, iter->next);
+    iter->n_pages++;
+
+    rc_scan_records(&iter->scan, page->buffer, page->n_bytes); // empty if the page has no records
+    return page;
+
+}
+
+const char* rc_iter_record(PageIter* iter, size_t* n) { return rc_scan_next(&iter->scan, n); }
+
+void rc_iter_end(PageIter* iter) {
+
+    curl_easy_cleanup(iter->curl);
+    RC_JSON_FREE(&iter->page);
+    free(iter);
+
+}
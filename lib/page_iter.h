@@ -0,0 +1,91 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_PAGE_ITER_H
+#define RC_PAGE_ITER_H
+
+#include "json_content.h"
+#include "json_scan.h"
+#include "page_ring.h"
+
+/**
+ * Pull-style page loop
+ *
+ * rc_json_get_buffer returns once every page has been fetched, and keeps
+ * all of them. A PageIter fetches one page each time the caller asks for
+ * it, into a single buffer that is reused for every page, and hands out
+ * the records of that page one at a time. The caller decides whether and
+ * when the next page is requested, so it can throttle, interleave its own
+ * processing, or stop early (e.g. at a date cutoff) without downloading
+ * the remaining pages.
+ *
+ * PageIter* pages = rc_iter_begin(token, RC_GET_CALL_LOG, 0);
+ * size_t n;
+ *
+ * while (rc_iter_next(pages)) {
+ *     for (const char* record; (record = rc_iter_record(pages, &n)); ) {
+ *         if (before_cutoff(record, n)) { goto done; }
+ *     }
+ * }
+ *
+ * done:
+ * rc_iter_end(pages); // errors, if any, are reported through token
+ *
+ * - Memory stays at the size of the largest page
+ * - Records and pages are only valid until the next call to rc_iter_next
+ * - Each page is the complete response of its request, not stitched
+ */
+typedef struct PageIter {
+
+    BearerToken* token;
+    CURL* curl;
+
+    JsonContent page; // reused for every page
+    JsonScan scan;    // records of the current page not yet handed out
+
+    char next[RING_URL_SIZE];
+    bool more;
+    size_t n_pages;   // pages fetched so far
+
+} PageIter;
+
+/// @brief Start a page loop, without fetching anything yet
+/// @param token pointer to a BearerToken (can be just a skeleton)
+/// @param url full url of the first page
+/// @param init_size initial page buffer size (0 for default of 1 megabyte)
+/// @return a pointer to the iterator; NULL if it could not be created
+PageIter* rc_iter_begin(BearerToken* token, const char* url, size_t init_size);
+
+/// @brief Fetch the next page into the iterator's buffer
+/// @param iter pointer to a PageIter
+/// @return the page (complete, null-terminated response); NULL after the
+///         last page, or if the request failed (reported through token)
+const JsonContent* rc_iter_next(PageIter* iter);
+
+/// @brief Get the next record of the current page
+/// @param iter pointer to a PageIter
+/// @param n set to the number of bytes in the record
+/// @return pointer to the record's opening '{' (not null-terminated);
+///         NULL once every record of the page has been handed out
+const char* rc_iter_record(PageIter* iter, size_t* n);
+
+/// @brief Stop the page loop (whether or not it has reached the last page) and free the iterator
+/// @param iter pointer to a PageIter
+void rc_iter_end(PageIter* iter);
+
+#endif // RC_PAGE_ITER_H
@@ -0,0 +1,245 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "page_ring.h"
+#include "json_scan.h"
+#include "rate_limiter.h"
+#include "tracer.h"
+
+#define RING_SPIN 64
+
+typedef struct {
+
+    JsonContent* slots;
+    size_t n_slots;
+
+    // head is only written by the producer, tail only by the consumer
+    _Alignas(64) atomic_size_t head;
+    _Alignas(64) atomic_size_t tail;
+    atomic_bool done;
+
+    // only for blocking waits; head and tail are still published lock-free
+    pthread_mutex_t lock;
+    pthread_cond_t cond; // head, tail or done has changed
+
+    PageConsumer consumer;
+    void* userdata;
+
+} PageRing;
+
+static bool rc_ring_readable(PageRing* ring) {
+
+    return atomic_load_explicit(&ring->head, memory_order_acquire) != atomic_load_explicit(&ring->tail, memory_order_relaxed)
+        || atomic_load_explicit(&ring->done, memory_order_acquire);
+
+}
+
+static bool rc_ring_writable(PageRing* ring) {
+
+    return atomic_load_explicit(&ring->head, memory_order_relaxed)
+         - atomic_load_explicit(&ring->tail, memory_order_acquire) < ring->n_slots;
+
+}
+
+// after publishing head, tail or done: wake the other side if it is blocked
+static void rc_ring_signal(PageRing* ring) {
+
+    pthread_mutex_lock(&ring->lock);
+    pthread_cond_signal(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+
+}
+
+// spin briefly, then block until the other side signals; waits are on the scale of network round trips
+static void rc_ring_wait(PageRing* ring, size_t* n_spins, bool (*ready)(PageRing*)) {
+
+    if ((*n_spins)++ < RING_SPIN) { sched_yield(); return; }
+
+    pthread_mutex_lock(&ring->lock);
+    while (!ready(ring)) { pthread_cond_wait(&ring->cond, &ring->lock); }
+    pthread_mutex_unlock(&ring->lock);
+
+}
+
+// consume every published page without waiting; returns the number consumed
+static size_t rc_ring_drain(PageRing* ring) {
+
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    const size_t n = head - tail;
+
+    for (; tail < head; tail++) {
+
+        ring->consumer(ring->slots + tail % ring->n_slots, tail, ring->userdata);
+        atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+        rc_ring_signal(ring);
+
+    }
+
+    return n;
+
+}
+
+static void* rc_ring_consumer(void* userdata) {
+
+    PageRing* ring = (PageRing*)userdata;
+    size_t n_spins = 0;
+
+    while (true) {
+
+        // read before draining, so pages published before done are not missed
+        const bool done = atomic_load_explicit(&ring->done, memory_order_acquire);
+
+        if (rc_ring_drain(ring)) { n_spins = 0; }
+        else if (done) { return NULL; }
+        else { rc_ring_wait(ring, &n_spins, rc_ring_readable); }
+
+    }
+
+}
+
+bool rc_ring_next_page(BearerToken* token, const JsonContent* page, char* url) {
+
+    const char* object = page->buffer;
+    const char* end = page->buffer + page->n_bytes;
+    size_t length = 0;
+
+    while (object < end && *object != '{') { object++; }
+    if (object == end) { return false; }
+
+    const char* uri = rc_scan_path(object, end - object, "navigation.nextPage.uri", &length);
+    if (uri == NULL || length < 2 || *uri != '\"') { return false; }
+
+    // cutting the url short would end the page loop early, as if this were the last page
+    if (length - 2 >= RING_URL_SIZE) {
+
+        token->s_token = RC_CURL_TRANSFER_FAILED;
+        snprintf(token->error, CURL_ERROR_SIZE, "Next page URL too long");
+        return false;
+
+    }
+
+    memcpy(url, uri + 1, length - 2);
+    url[length - 2] = '\0';
+    return true;
+
+}
+
+size_t rc_json_pipeline(BearerToken* token, const char* url, size_t n_slots,
+                        PageConsumer consumer, void* userdata) {
+
+    char next[RING_URL_SIZE];
+    pthread_t thread;
+    size_t head = 0;
+
+    n_slots = n_slots > 0 ? n_slots : RING_SLOTS;
+
+    PageRing ring = {
+
+        .slots = malloc(n_slots * sizeof(JsonContent)),
+        .n_slots = n_slots,
+        .head = 0,
+        .tail = 0,
+        .done = false,
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .cond = PTHREAD_COND_INITIALIZER,
+        .consumer = consumer,
+        .userdata = userdata
+
+    };
+
+    CURL* curl = curl_easy_init();
+
+    if (curl == NULL || ring.slots == NULL) {
+
+        token->s_token = RC_CURL_INIT_FAILED;
+        curl_easy_cleanup(curl);
+        free(ring.slots);
+        return 0;
+
+    }
+
+    for (size_t i = 0; i < n_slots; i++)
+    { memcpy(ring.slots + i, RC_JSON_INIT(0), sizeof(JsonContent)); }
+
+    const bool threaded = pthread_create(&thread, NULL, rc_ring_consumer, &ring) == 0;
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, rc_curl_write_json);
+
+    while (true) {
+
+        size_t n_spins = 0;
+
+        // backpressure: wait for the consumer to free a slot
+        while (head - atomic_load_explicit(&ring.tail, memory_order_acquire) == n_slots) {
+
+            if (threaded) { rc_ring_wait(&ring, &n_spins, rc_ring_writable); }
+            else { rc_ring_drain(&ring); } // consume on this thread instead
+
+        }
+
+        JsonContent* page = ring.slots + head % n_slots;
+        const uint64_t start = rc_trace_clock();
+        uint64_t attempt = MAX_RETRY_ATTEMPT;
+        uint64_t timeout = MIN_RETRY_TIMEOUT;
+        TokenError result;
+
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, page);
+
+        // a failed page is dropped and requested again, not the whole loop
+        do { rc_json_reset(page); }
+        while ((result = rc_curl_auto_perform(token, curl)) != RC_TOKEN_OK && rc_curl_retry(token, &attempt, &timeout));
+
+        rc_trace_span(RC_TRACE_PAGE, start, head);
+        if (result != RC_TOKEN_OK) { break; }
+
+        if (page->n_bytes == 0) { break; }
+        else { page->buffer[page->n_bytes] = '\0'; }
+
+        const bool more = rc_ring_next_page(token, page, next);
+        if (more) { curl_easy_setopt(curl, CURLOPT_URL, next); }
+
+        atomic_store_explicit(&ring.head, ++head, memory_order_release);
+        rc_ring_signal(&ring);
+        if (!more) { break; }
+
+    }
+
+    atomic_store_explicit(&ring.done, true, memory_order_release);
+    rc_ring_signal(&ring);
+
+    if (threaded) { pthread_join(thread, NULL); }
+    else { rc_ring_drain(&ring); }
+
+    for (size_t i = 0; i < n_slots; i++) { RC_JSON_FREE(ring.slots + i); }
+
+    curl_easy_cleanup(curl);
+    free(ring.slots);
+    pthread_mutex_destroy(&ring.lock);
+    pthread_cond_destroy(&ring.cond);
+    return head;
+
+}
@@ -0,0 +1,74 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_PAGE_RING_H
+#define RC_PAGE_RING_H
+
+#define RING_SLOTS 4
+#define RING_URL_SIZE 2048
+
+#include "json_content.h"
+
+/// @brief Called on the consumer thread once per page, in page order
+/// @param page pointer to a JsonContent holding one complete page response
+///        (null-terminated); only valid until the function returns
+/// @param index zero-based page number
+/// @param userdata userdata given to rc_json_pipeline
+typedef void (*PageConsumer)(const JsonContent* page, size_t index, void* userdata);
+
+/**
+ * Pipelined page loop
+ *
+ * rc_json_get_buffer fetches every page before the caller can look at any
+ * of them, so processing time adds up with network time. rc_json_pipeline
+ * runs the same page loop on the calling thread while a consumer thread
+ * processes the pages already fetched. Pages are handed over through a
+ * lock-free single-producer/single-consumer ring of reusable page buffers;
+ * once all slots hold unconsumed pages, the page loop waits for the
+ * consumer (backpressure), so memory use stays at n_slots pages. Either
+ * side blocks on a condition variable once a short spin has not found
+ * work, so neither burns CPU while pages are in flight.
+ *
+ * Unlike rc_json_get_buffer, pages are not stitched together: each one is
+ * delivered as the complete response of its request.
+ */
+
+/// @brief Fetch a paginated endpoint while a consumer thread processes its pages
+/// @param token pointer to a BearerToken (can be just a skeleton)
+/// @param url full url
+/// @param n_slots number of page buffers in the ring (0 for default of 4)
+/// @param consumer called on the consumer thread for every page
+/// @param userdata passed to consumer
+/// @return number of pages delivered to the consumer; errors are reported
+///         through token, same as rc_json_get_buffer
+size_t rc_json_pipeline(BearerToken* token, const char* url, size_t n_slots,
+                        PageConsumer consumer, void* userdata);
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief copy the next page url out of a complete page response
+/// @param token pointer to the BearerToken of the page loop
+/// @param page pointer to a JsonContent holding one null-terminated page response
+/// @param url buffer of RING_URL_SIZE bytes for the url
+/// @return false on the last page, or if the url does not fit (the page loop
+///         then fails: token is set to RC_CURL_TRANSFER_FAILED)
+bool rc_ring_next_page(BearerToken* token, const JsonContent* page, char* url);
+
+#endif // RINGEXTRACT_H
+
+#endif // RC_PAGE_RING_H
@@ -0,0 +1,301 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "poller.h"
+#include "json_scan.h"
+
+#define POLL_INIT_ENTRIES 64
+#define POLL_ID_SIZE 64
+#define POLL_SLICE 100
+
+typedef struct PollEntry {
+
+    char* id; // NULL for an empty slot
+    char* record;
+    size_t n;
+    bool seen;
+
+} PollEntry;
+
+static inline uint64_t rc_poll_now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+}
+
+// sleep in slices so that rc_poll_stop takes effect promptly; false if stopped
+static bool rc_poll_wait(Poller* poller, uint64_t deadline) {
+
+    for (uint64_t now = rc_poll_now(); now < deadline; now = rc_poll_now()) {
+
+        if (atomic_load(&poller->stopped)) { return false; }
+
+        const uint64_t ms = deadline - now < POLL_SLICE ? deadline - now : POLL_SLICE;
+        const struct timespec ts = { .tv_sec = 0, .tv_nsec = (long)ms * 1000000 };
+        nanosleep(&ts, NULL);
+
+    }
+
+    return !atomic_load(&poller->stopped);
+
+}
+
+static inline uint64_t rc_poll_hash(const char* id) {
+
+    uint64_t hash = 0xcbf29ce484222325ULL; // FNV-1a
+    for (; *id; id++) { hash = (hash ^ (uint8_t)*id) * 0x100000001b3ULL; }
+    return hash;
+
+}
+
+// slot holding id, or the empty slot where it belongs
+static PollEntry* rc_poll_find(PollEntry* entries, size_t total, const char* id) {
+
+    const size_t mask = total - 1;
+
+    for (size_t i = rc_poll_hash(id) & mask; ; i = (i + 1) & mask)
+    { if (entries[i].id == NULL || strcmp(entries[i].id, id) == 0) { return entries + i; } }
+
+}
+
+static char* rc_poll_copy(const char* data, size_t n) {
+
+    char* copy = malloc(n + 1);
+    if (copy) { memcpy(copy, data, n); copy[n] = '\0'; }
+    return copy;
+
+}
+
+// milliseconds per request that keep a poller within its usage-group budget
+static uint64_t rc_poll_spacing(CURL* curl) {
+
+    struct curl_header* header;
+    uint64_t limit = 0;
+    uint64_t window = 0;
+
+    if (curl_easy_header(curl, "x-rate-limit-limit", 0, CURLH_HEADER, -1, &header) == CURLHE_OK)
+    { limit = strtoull(header->value, NULL, 10); }
+
+    if (curl_easy_header(curl, "x-rate-limit-window", 0, CURLH_HEADER, -1, &header) == CURLHE_OK)
+    { window = strtoull(header->value, NULL, 10); }
+
+    return limit ? window * 1000 / limit : 0;
+
+}
+
+// key the new list by id, carrying over unchanged records from the previous snapshot
+static bool rc_poll_diff(Poller* poller, PollCallback callback, void* userdata) {
+
+    JsonScan scan;
+    size_t n;
+    size_t n_records = 0;
+    size_t total = POLL_INIT_ENTRIES;
+    const JsonContent* json = poller->json;
+
+    if (!rc_scan_records(&scan, json->buffer, json->n_bytes)) { return false; }
+    while (rc_scan_next(&scan, &n)) { n_records++; }
+    while (total < 2 * n_records) { total <<= 1; }
+
+    PollEntry* entries = calloc(total, sizeof(PollEntry));
+    if (entries == NULL) { return false; }
+
+    PollEntry* previous = poller->entries;
+    const size_t n_previous = poller->total_entries;
+    size_t n_entries = 0;
+
+    rc_scan_records(&scan, json->buffer, json->n_bytes);
+
+    for (const char* record; (record = rc_scan_next(&scan, &n)); ) {
+
+        char id[POLL_ID_SIZE];
+        size_t length = 0;
+        const char* value = *record == '{' ? rc_scan_path(record, n, poller->key, &length) : NULL;
+
+        if (value && length >= 2 && *value == '"') { value++; length -= 2; }
+        if (value == NULL || length == 0 || length >= POLL_ID_SIZE) { continue; }
+
+        memcpy(id, value, length);
+        id[length] = '\0';
+
+        PollEntry* entry = rc_poll_find(entries, total, id);
+        if (entry->id) { continue; } // listed twice (records shifted between pages)
+
+        PollEntry* old = previous ? rc_poll_find(previous, n_previous, id) : NULL;
+
+        if (old && old->id) {
+
+            old->seen = true;
+            *entry = (PollEntry){ .id = old->id, .record = old->record, .n = old->n };
+            n_entries++;
+
+            if (old->n == n && memcmp(old->record, record, n) == 0) { continue; }
+
+            char* copy = rc_poll_copy(record, n);
+            if (copy == NULL) { continue; } // keep the old version, report it next time
+
+            free(old->record);
+            entry->record = copy;
+            entry->n = n;
+            callback(RC_POLL_CHANGED, entry->id, entry->record, userdata);
+            poller->n_changes++;
+
+        } else {
+
+            char* copy = rc_poll_copy(record, n);
+            char* key = rc_poll_copy(id, length);
+
+            if (copy == NULL || key == NULL) { free(copy); free(key); continue; }
+
+            *entry = (PollEntry){ .id = key, .record = copy, .n = n };
+            n_entries++;
+            callback(RC_POLL_ADDED, entry->id, entry->record, userdata);
+            poller->n_changes++;
+
+        }
+
+    }
+
+    for (size_t i = 0; previous && i < n_previous; i++) {
+
+        if (previous[i].id == NULL || previous[i].seen) { continue; }
+
+        callback(RC_POLL_REMOVED, previous[i].id, previous[i].record, userdata);
+        poller->n_changes++;
+
+        free(previous[i].id);
+        free(previous[i].record);
+
+    }
+
+    free(previous);
+    poller->entries = entries;
+    poller->total_entries = total;
+    poller->n_entries = n_entries;
+    return true;
+
+}
+
+Poller* rc_poll_init(BearerToken* token, const char* url, const char* key, unsigned int interval) {
+
+    Poller* poller = calloc(1, sizeof(Poller));
+    if (poller == NULL) { return NULL; }
+
+    poller->token = token;
+    poller->url = url;
+    poller->key = key ? key : "id";
+    poller->interval = interval > 0 ? interval : POLL_INTERVAL;
+    poller->curl = curl_easy_init();
+    poller->json = malloc(sizeof(JsonContent));
+    atomic_init(&poller->stopped, false);
+
+    if (poller->curl && poller->json) {
+
+        memcpy(poller->json, RC_JSON_INIT(0), sizeof(JsonContent));
+
+        // one handle for the poller's life: its connection stays open between polls
+        curl_easy_setopt(poller->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(poller->curl, CURLOPT_WRITEFUNCTION, rc_curl_write_json);
+        curl_easy_setopt(poller->curl, CURLOPT_WRITEDATA, poller->json);
+        return poller;
+
+    }
+
+    if (poller->curl) { curl_easy_cleanup(poller->curl); }
+    free(poller->json);
+    free(poller);
+    return NULL;
+
+}
+
+TokenError rc_poll_once(Poller* poller, PollCallback callback, void* userdata) {
+
+    if (!rc_poll_wait(poller, poller->next_poll)) { return RC_TOKEN_OK; }
+
+    BearerToken* token = poller->token;
+    JsonContent* json = poller->json;
+    const uint64_t start = rc_poll_now();
+    uint64_t n_requests = 0;
+
+    // a failed transfer leaves the token in that state; the next poll is a new attempt
+    if (token->s_token == RC_CURL_TRANSFER_FAILED) { token->s_token = RC_TOKEN_OK; }
+
+    rc_json_reset(json);
+    curl_easy_setopt(poller->curl, CURLOPT_URL, poller->url);
+
+    do {
+
+        n_requests++;
+        if (rc_curl_auto_perform(token, poller->curl) != RC_TOKEN_OK) { break; }
+
+        rc_curl_next_page(json);
+        curl_easy_setopt(poller->curl, CURLOPT_URL, json->url_next_page);
+
+    } while (json->url_next_page);
+
+    const uint64_t budget = rc_poll_spacing(poller->curl) * n_requests;
+    poller->next_poll = start + (budget > poller->interval ? budget : poller->interval);
+    poller->n_polls++;
+
+    if (token->s_token != RC_TOKEN_OK) { return token->s_token; }
+    if (!rc_poll_diff(poller, callback, userdata)) { token->s_token = RC_TOKEN_PARSING_ERROR; }
+
+    return token->s_token;
+
+}
+
+TokenError rc_poll_run(Poller* poller, PollCallback callback, void* userdata) {
+
+    atomic_store(&poller->stopped, false);
+
+    while (!atomic_load(&poller->stopped)) {
+
+        const TokenError status = rc_poll_once(poller, callback, userdata);
+        if (status != RC_TOKEN_OK && status != RC_CURL_TRANSFER_FAILED) { return status; }
+
+    }
+
+    return RC_TOKEN_OK;
+
+}
+
+void rc_poll_stop(Poller* poller) { atomic_store(&poller->stopped, true); }
+
+void rc_poll_free(Poller* poller) {
+
+    for (size_t i = 0; poller->entries && i < poller->total_entries; i++) {
+
+        free(poller->entries[i].id);
+        free(poller->entries[i].record);
+
+    }
+
+    free(poller->entries);
+    rc_json_free(poller->json);
+    free(poller->json);
+    curl_easy_cleanup(poller->curl);
+    free(poller);
+
+}
@@ -0,0 +1,116 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_POLLER_H
+#define RC_POLLER_H
+
+#define POLL_INTERVAL 5000
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "json_content.h"
+
+typedef enum { RC_POLL_ADDED, RC_POLL_CHANGED, RC_POLL_REMOVED } PollChange;
+
+/// @brief Called once per record that differs from the previous poll
+/// @param change RC_POLL_ADDED, RC_POLL_CHANGED or RC_POLL_REMOVED
+/// @param id record id (null-terminated, without quotes)
+/// @param record the record's JSON object (null-terminated); for
+///        RC_POLL_REMOVED, its last known version
+/// @param userdata userdata given to rc_poll_once / rc_poll_run
+/// @note id and record are only valid until the function returns
+typedef void (*PollCallback)(PollChange change, const char* id, const char* record, void* userdata);
+
+/**
+ * Change-diffing poller for live lists (active calls, presence, ...)
+ *
+ * Polling with rc_json_get_buffer opens a new connection, downloads the
+ * whole list and leaves all of it to be re-processed every time. A Poller
+ * keeps one CURL handle (and with it, its kept-alive connection and TLS
+ * session) for its whole life, and keeps the previous snapshot of the list
+ * keyed by record id; after every poll, only records that were added,
+ * changed (byte-wise) or removed are passed to the callback.
+ *
+ * Polls are paced: the next one starts no earlier than the interval after
+ * the previous one started, nor earlier than the usage-group budget allows
+ * (X-Rate-Limit-Window / X-Rate-Limit-Limit per request), so a poller can
+ * run indefinitely without being throttled.
+ *
+ * Poller* poller = rc_poll_init(token, RC_GET_ACTIVE_CALLS, "id", 2000);
+ * rc_poll_run(poller, on_change, wallboard); // until rc_poll_stop(poller)
+ * rc_poll_free(poller);
+ *
+ * The first poll reports every record as added. If a poll fails, the
+ * snapshot is kept and no callback is invoked.
+ */
+typedef struct Poller {
+
+    BearerToken* token;
+    const char* url;
+    const char* key;
+
+    uint64_t interval;  // ms between the starts of two polls, at least
+    uint64_t next_poll; // monotonic ms before which no poll starts
+    atomic_bool stopped;
+
+    CURL* curl;
+    JsonContent* json;
+
+    struct PollEntry* entries; // snapshot, by id
+    size_t n_entries;
+    size_t total_entries;
+
+    size_t n_polls;
+    size_t n_changes;
+
+} Poller;
+
+/// @brief Create a poller
+/// @param token pointer to a BearerToken (can be just a skeleton)
+/// @param url full url of a list endpoint, e.g. RC_GET_ACTIVE_CALLS
+/// @param key path of the record id, e.g. "id" or "extension.id" (presence);
+///        NULL for "id"
+/// @param interval minimum milliseconds between polls (0 for default of 5000)
+/// @return a pointer to the poller; NULL if it could not be created
+Poller* rc_poll_init(BearerToken* token, const char* url, const char* key, unsigned int interval);
+
+/// @brief Wait for the next poll to be due, poll, and report the differences
+/// @param poller pointer to a Poller
+/// @param callback called for every added, changed and removed record
+/// @param userdata passed to callback
+/// @return RC_TOKEN_OK on success; otherwise the error, also set in the token
+TokenError rc_poll_once(Poller* poller, PollCallback callback, void* userdata);
+
+/// @brief Poll until stopped (transfer failures are retried at the next poll)
+/// @param poller pointer to a Poller
+/// @param callback called for every added, changed and removed record
+/// @param userdata passed to callback
+/// @return RC_TOKEN_OK once stopped by rc_poll_stop; otherwise the token or
+///         credential error that ended polling
+TokenError rc_poll_run(Poller* poller, PollCallback callback, void* userdata);
+
+/// @brief Make rc_poll_run return after the current poll; a poll still waiting
+///        to be due is skipped (callable from the callback or from another thread)
+/// @param poller pointer to a Poller
+void rc_poll_stop(Poller* poller);
+
+/// @brief Free the poller, its connection and its snapshot
+/// @param poller pointer to a Poller
+void rc_poll_free(Poller* poller);
+
+#endif // RC_POLLER_H
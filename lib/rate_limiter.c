@@ -18,8 +18,22 @@
 
 #include <unistd.h>
 #include "rate_limiter.h"
+#include "http_pool.h"
+#include "hedge.h"
+#include "shared_limiter.h"
+#include "tracer.h"
 
-static inline void rc_limiter_200_timeout(CURL* curl) {
+static inline void rc_limiter_sleep(unsigned int seconds) {
+
+    if (seconds == 0) { return; }
+
+    const uint64_t start = rc_trace_clock();
+    sleep(seconds);
+    rc_trace_span(RC_TRACE_SLEEP, start, seconds * 1000000000LL);
+
+}
+
+static inline unsigned int rc_limiter_200_timeout(CURL* curl) {
 
 #define RLA200 "x-rate-limit-remaining"
 #define RLT200 "x-rate-limit-window"
@@ -34,56 +48,121 @@ static inline void rc_limiter_200_timeout(CURL* curl) {
     if (curl_easy_header(curl, RLT200, 0, CURLH_HEADER, 0, &header) == CURLHE_OK)
     { timeout = strtoul(header->value, NULL, 10); }
 
-    if (attempt == 0) { sleep((unsigned int)timeout); }
+    return attempt == 0 ? (unsigned int)timeout : 0;
 
 #undef RLA200
 #undef RLT200
 
 }
 
-static inline void rc_limiter_429_timeout(CURL* curl) {
+static inline unsigned int rc_limiter_429_timeout(CURL* curl) {
 
     curl_off_t timeout;
 
     if (curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &timeout) == CURLE_OK)
-    { sleep((unsigned int)timeout); }
+    { return (unsigned int)timeout; }
+    else { return 0; }
 
 }
 
-static inline void rc_limiter_503_timeout(uint64_t* timeout) {
+static inline unsigned int rc_limiter_503_timeout(uint64_t* timeout) {
 
-    sleep((unsigned int)*timeout);
+    const unsigned int delay = (unsigned int)*timeout;
     *timeout <<= 1;
+    return delay;
 
 }
 
-void rc_curl_set_limit(BearerToken* token, CURL* curl, uint64_t attempt, uint64_t timeout) {
+void rc_trace_transfer(CURL* curl, uint64_t start) {
 
-    long status;
-    CURLcode result = curl_easy_perform(curl);
+    long status = 0;
+    curl_off_t ttfb = 0;
 
-    if (result != CURLE_OK && result != CURLE_HTTP_RETURNED_ERROR) {
+    if (start == 0) { return; }
 
-        token->s_token = RC_CURL_TRANSFER_FAILED;
-        return;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &ttfb);
+
+    if (status) { rc_trace_record(RC_TRACE_TTFB, start, (uint64_t)ttfb * 1000, status); }
+    rc_trace_span(RC_TRACE_PERFORM, start, status);
+
+}
 
-    } else { curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status); }
+LimitAction rc_curl_check_limit(CURL* curl, CURLcode result, uint64_t* timeout, unsigned int* delay) {
+
+    long status = 0;
+    *delay = 0;
+
+    if (result != CURLE_OK && result != CURLE_HTTP_RETURNED_ERROR) { return RC_LIMIT_FAILED; }
+    else { curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status); }
 
     switch (status) {
 
     case HTTP_OK:
-        rc_limiter_200_timeout(curl);
-        return;
+        *delay = rc_limiter_200_timeout(curl);
+        return RC_LIMIT_DONE;
 
     case HTTP_TOO_MANY_REQUESTS:
-        rc_limiter_429_timeout(curl);
-        break;
+        *delay = rc_limiter_429_timeout(curl);
+        return RC_LIMIT_RETRY;
 
     case HTTP_SERVICE_UNAVAILABLE:
-        rc_limiter_503_timeout(&timeout);
-        break;
-    
+        *delay = rc_limiter_503_timeout(timeout);
+        return RC_LIMIT_RETRY;
+
     default: // TODO: evaluate necessary fallback for other HTTP status codes
+        return RC_LIMIT_FAILED;
+
+    }
+
+}
+
+bool rc_curl_retry(BearerToken* token, uint64_t* attempt, uint64_t* timeout) {
+
+    const long status = token->status;
+
+    if (token->s_token != RC_CURL_TRANSFER_FAILED || *attempt == 0) { return false; }
+
+    // a refused request would be refused again; 503 has been retried already
+    if ((status > HTTP_OK && status < HTTP_INTERNAL_SERVER_ERROR) || status == HTTP_SERVICE_UNAVAILABLE) { return false; }
+
+    (*attempt)--;
+    rc_limiter_sleep(rc_limiter_503_timeout(timeout));
+
+    token->s_token = RC_TOKEN_OK;
+    return true;
+
+}
+
+void rc_curl_set_limit(BearerToken* token, CURL* curl, uint64_t attempt, uint64_t timeout) {
+
+    unsigned int delay = 0;
+    CURL* done = curl; // a hedged duplicate, if it answered first
+    if (token->limiter) { rc_shared_acquire(token->limiter, curl, token->priority); }
+
+    const uint64_t start = rc_trace_clock();
+    token->status = 0;
+    CURLcode result = token->hedger ? rc_hedge_perform(token->hedger, token, curl, &done)
+                    : token->pool ? rc_pool_perform(token->pool, curl) : curl_easy_perform(curl);
+
+    rc_trace_transfer(done, start);
+    curl_easy_getinfo(done, CURLINFO_RESPONSE_CODE, &token->status); // done is released below
+
+    const LimitAction action = rc_curl_check_limit(done, result, &timeout, &delay);
+    if (token->limiter && action != RC_LIMIT_FAILED) { delay = rc_shared_update(token->limiter, done, delay); }
+    if (token->hedger) { rc_hedge_release(curl, done); }
+
+    switch (action) {
+
+    case RC_LIMIT_DONE:
+        rc_limiter_sleep(delay);
+        return;
+
+    case RC_LIMIT_RETRY:
+        rc_limiter_sleep(delay);
+        break;
+
+    default:
         token->s_token = RC_CURL_TRANSFER_FAILED;
         return;
 
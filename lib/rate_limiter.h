@@ -94,6 +94,27 @@ typedef enum {
 
 #ifndef RINGEXTRACT_H // internal functions used within RingEXtract
 
+typedef enum {
+
+    RC_LIMIT_DONE,  // transfer succeeded; wait delay before the next request
+    RC_LIMIT_RETRY, // transfer was throttled; wait delay, then retry
+    RC_LIMIT_FAILED // transfer failed; do not retry
+
+} LimitAction;
+
+/// @brief evaluate a completed transfer against the rate limits, without waiting
+/// @param curl a CURL handle whose transfer has completed
+/// @param result result of the transfer
+/// @param timeout current retry timeout (in seconds), doubled on 503
+/// @param delay set to the number of seconds to wait
+/// @return action to take next
+LimitAction rc_curl_check_limit(CURL* curl, CURLcode result, uint64_t* timeout, unsigned int* delay);
+
+/// @brief record tracer spans for a completed transfer
+/// @param curl a CURL handle whose transfer has completed
+/// @param start value returned by rc_trace_clock when the transfer started
+void rc_trace_transfer(CURL* curl, uint64_t start);
+
 /// @brief implementation of recursive retry/timeout mechanism
 /// @param token pointer to a BearerToken struct
 /// @param curl a CURL handle
@@ -101,6 +122,17 @@ typedef enum {
 /// @param timeout minimum retry timeout (in seconds)
 void rc_curl_set_limit(BearerToken* token, CURL* curl, uint64_t attempt, uint64_t timeout);
 
+/// @brief decide whether a failed page is worth requesting again, and wait before it
+/// @param token pointer to a BearerToken whose transfer failed (its status is
+///        that of the request that answered, the hedged duplicate included)
+/// @param attempt retries left for the page (start with MAX_RETRY_ATTEMPT), decremented
+/// @param timeout current retry timeout (start with MIN_RETRY_TIMEOUT, in seconds), doubled
+/// @return true once the token's error state has been cleared for the retry;
+///         false if the failure is final (refused request, retries used up)
+/// @note Interrupted transfers, network errors and 5xx responses are retried;
+///       4xx responses and 503s (already retried by rc_curl_set_limit) are not
+bool rc_curl_retry(BearerToken* token, uint64_t* attempt, uint64_t* timeout);
+
 #endif // RINGEXTRACT_H
 
 #endif // RC_RATE_LIMITER_H
@@ -0,0 +1,365 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "record_store.h"
+#include "json_scan.h"
+
+#define MUL(X, Y) (((X) / (Y) + 1) * (Y))
+
+#define STORE_INIT_RECORDS 1024
+#define STORE_INIT_STRINGS 256
+#define STORE_INIT_INDEX 2048
+
+typedef struct StoreBlock {
+
+    struct StoreBlock* next;
+    size_t n_bytes;
+    size_t size;
+    char data[];
+
+} StoreBlock;
+
+typedef struct StoreString {
+
+    const char* value; // NULL for an empty slot
+    uint64_t hash;
+    size_t length;
+
+} StoreString;
+
+static inline uint64_t rc_store_hash(const char* value, size_t n) {
+
+    uint64_t hash = 0xcbf29ce484222325ULL; // FNV-1a
+    for (size_t i = 0; i < n; i++) { hash = (hash ^ (uint8_t)value[i]) * 0x100000001b3ULL; }
+    return hash;
+
+}
+
+static inline size_t rc_store_slot(uint64_t key, size_t total) {
+
+    return (size_t)((key * 0x9e3779b97f4a7c15ULL) >> 17) & (total - 1);
+
+}
+
+// room for n bytes at the end of the arena; nothing is committed until the caller bumps n_bytes
+static char* rc_store_reserve(RecordStore* store, size_t n) {
+
+    StoreBlock* block = store->arena;
+    if (block && block->size - block->n_bytes >= n) { return block->data + block->n_bytes; }
+
+    const size_t size = n > STORE_BLOCK_SIZE ? n : STORE_BLOCK_SIZE;
+    block = malloc(sizeof(StoreBlock) + size);
+    if (block == NULL) { return NULL; }
+
+    block->next = store->arena;
+    block->n_bytes = 0;
+    block->size = size;
+    store->arena = block;
+    return block->data;
+
+}
+
+static const StoreString* rc_store_probe(const RecordStore* store, const char* value, size_t n, uint64_t hash) {
+
+    const size_t mask = store->total_strings - 1;
+
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+
+        const StoreString* entry = store->strings + i;
+        if (entry->value == NULL) { return entry; }
+        if (entry->hash == hash && entry->length == n && memcmp(entry->value, value, n) == 0) { return entry; }
+
+    }
+
+}
+
+static bool rc_store_grow_strings(RecordStore* store) {
+
+    const size_t total = store->total_strings ? store->total_strings * 2 : STORE_INIT_STRINGS;
+    StoreString* strings = calloc(total, sizeof(StoreString));
+    if (strings == NULL) { return false; }
+
+    StoreString* old = store->strings;
+    const size_t n_old = store->total_strings;
+
+    store->strings = strings;
+    store->total_strings = total;
+
+    for (size_t i = 0; i < n_old; i++) {
+
+        if (old[i].value == NULL) { continue; }
+        *(StoreString*)rc_store_probe(store, old[i].value, old[i].length, old[i].hash) = old[i];
+
+    }
+
+    free(old);
+    return true;
+
+}
+
+// decode a JSON value straight into the arena, then keep it only if it is new
+static const char* rc_store_intern(RecordStore* store, const char* value, size_t n) {
+
+    if (value == NULL || (n == 4 && memcmp(value, "null", 4) == 0)) { return NULL; }
+
+    if (4 * (store->n_strings + 1) > 3 * store->total_strings && !rc_store_grow_strings(store))
+    { store->failed = true; return NULL; }
+
+    char* dest = rc_store_reserve(store, n + 1);
+    if (dest == NULL) { store->failed = true; return NULL; }
+
+    const size_t length = *value == '"' ? rc_scan_string(value, n, dest) : (memcpy(dest, value, n), n);
+    const uint64_t hash = rc_store_hash(dest, length);
+    StoreString* entry = (StoreString*)rc_store_probe(store, dest, length, hash);
+
+    if (entry->value) { return entry->value; }
+
+    dest[length] = '\0';
+    *entry = (StoreString){ .value = dest, .hash = hash, .length = length };
+
+    store->arena->n_bytes += length + 1;
+    store->n_bytes += length + 1;
+    store->n_strings++;
+    return dest;
+
+}
+
+static inline int64_t rc_store_int(const char* record, size_t n, const char* path) {
+
+    size_t length = 0;
+    const char* value = rc_scan_path(record, n, path, &length);
+    return value ? rc_scan_int(value, length) : 0;
+
+}
+
+static inline const char* rc_store_text(RecordStore* store, const char* record, size_t n, const char* path) {
+
+    size_t length = 0;
+    const char* value = rc_scan_path(record, n, path, &length);
+    return rc_store_intern(store, value, length);
+
+}
+
+static void rc_store_call(RecordStore* store, CallRecord* call, const char* record, size_t n) {
+
+    size_t length = 0;
+    const char* start_time = rc_scan_path(record, n, "startTime", &length);
+
+    call->id = rc_store_text(store, record, n, "id");
+    call->session_id = rc_store_text(store, record, n, "sessionId");
+    call->start_time = start_time ? rc_scan_time(start_time, length) : 0;
+    call->extension_id = rc_store_int(record, n, "extension.id");
+    call->duration = (int32_t)rc_store_int(record, n, "duration");
+
+    call->type = rc_store_text(store, record, n, "type");
+    call->direction = rc_store_text(store, record, n, "direction");
+    call->action = rc_store_text(store, record, n, "action");
+    call->result = rc_store_text(store, record, n, "result");
+    call->from_number = rc_store_text(store, record, n, "from.phoneNumber");
+    call->from_name = rc_store_text(store, record, n, "from.name");
+    call->to_number = rc_store_text(store, record, n, "to.phoneNumber");
+    call->to_name = rc_store_text(store, record, n, "to.name");
+
+}
+
+static void rc_store_extension(RecordStore* store, ExtensionRecord* extension, const char* record, size_t n) {
+
+    extension->id = rc_store_int(record, n, "id");
+    extension->site_id = rc_store_int(record, n, "site.id");
+
+    extension->number = rc_store_text(store, record, n, "extensionNumber");
+    extension->name = rc_store_text(store, record, n, "name");
+    extension->type = rc_store_text(store, record, n, "type");
+    extension->status = rc_store_text(store, record, n, "status");
+    extension->email = rc_store_text(store, record, n, "contact.email");
+
+}
+
+// key of a record in the index, 0 if it has no id: call ids are interned, so the
+// address of the interned string stands for the id; extension ids are numbers
+static inline uint64_t rc_store_key(const RecordStore* store, size_t i) {
+
+    return store->calls ? (uint64_t)(uintptr_t)store->calls[i].id : (uint64_t)store->extensions[i].id;
+
+}
+
+// slot of key in the index: either holding it, or the empty slot where it belongs
+static size_t* rc_store_index_slot(const RecordStore* store, uint64_t key) {
+
+    const size_t mask = store->total_index - 1;
+
+    for (size_t i = rc_store_slot(key, store->total_index); ; i = (i + 1) & mask) {
+
+        size_t* slot = store->index + i;
+        if (*slot == 0 || rc_store_key(store, *slot - 1) == key) { return slot; }
+
+    }
+
+}
+
+static bool rc_store_grow_index(RecordStore* store) {
+
+    const size_t total = store->total_index ? store->total_index * 2 : STORE_INIT_INDEX;
+    size_t* index = calloc(total, sizeof(size_t));
+    if (index == NULL) { return false; }
+
+    free(store->index);
+    store->index = index;
+    store->total_index = total;
+
+    for (size_t i = 0; i < store->n_records; i++) {
+
+        const uint64_t key = rc_store_key(store, i);
+        if (key) { *rc_store_index_slot(store, key) = i + 1; }
+
+    }
+
+    return true;
+
+}
+
+static bool rc_store_grow_records(RecordStore* store) {
+
+    const size_t total = MUL(store->n_records + 1, STORE_INIT_RECORDS);
+    const size_t size = store->calls ? sizeof(CallRecord) : sizeof(ExtensionRecord);
+    void** records = store->calls ? (void**)&store->calls : (void**)&store->extensions;
+
+    void* data = realloc(*records, total * size);
+    if (data == NULL) { return false; }
+
+    *records = data;
+    store->total_records = total;
+    return true;
+
+}
+
+RecordStore* rc_store_init(ColumnSchema schema) {
+
+    RecordStore* store = calloc(1, sizeof(RecordStore));
+    if (store == NULL) { return NULL; }
+
+    store->schema = schema;
+
+    switch (schema) {
+
+    case RC_SCHEMA_CALL_LOG:
+        store->calls = malloc(STORE_INIT_RECORDS * sizeof(CallRecord));
+        if (store->calls) { store->total_records = STORE_INIT_RECORDS; }
+        break;
+
+    case RC_SCHEMA_EXTENSION:
+        store->extensions = malloc(STORE_INIT_RECORDS * sizeof(ExtensionRecord));
+        if (store->extensions) { store->total_records = STORE_INIT_RECORDS; }
+        break;
+
+    }
+
+    if (store->total_records && rc_store_grow_strings(store) && rc_store_grow_index(store)) { return store; }
+
+    rc_store_free(store);
+    return NULL;
+
+}
+
+size_t rc_store_append(RecordStore* store, const char* json, size_t n) {
+
+    JsonScan scan;
+    size_t n_records = 0;
+
+    if (store->failed || !rc_scan_records(&scan, json, n)) { return 0; }
+
+    for (const char* record; (record = rc_scan_next(&scan, &n)); ) {
+
+        if (*record != '{') { continue; }
+
+        if (store->n_records == store->total_records && !rc_store_grow_records(store)) { store->failed = true; }
+        if (4 * (store->n_records + 1) > 3 * store->total_index && !rc_store_grow_index(store)) { store->failed = true; }
+        if (store->failed) { break; }
+
+        // decode into the next free record, then either commit it or move it over its duplicate
+        const size_t i = store->n_records;
+        if (store->calls) { rc_store_call(store, store->calls + i, record, n); }
+        else { rc_store_extension(store, store->extensions + i, record, n); }
+
+        if (store->failed) { break; }
+
+        const uint64_t key = rc_store_key(store, i);
+        size_t* slot = key ? rc_store_index_slot(store, key) : NULL;
+
+        if (slot && *slot) {
+
+            if (store->calls) { store->calls[*slot - 1] = store->calls[i]; }
+            else { store->extensions[*slot - 1] = store->extensions[i]; }
+
+        } else {
+
+            if (slot) { *slot = i + 1; }
+            store->n_records++;
+
+        }
+
+        n_records++;
+
+    }
+
+    return n_records;
+
+}
+
+void rc_store_page(const JsonContent* page, size_t index, void* store) {
+
+    (void)index;
+    rc_store_append((RecordStore*)store, page->buffer, page->n_bytes);
+
+}
+
+const char* rc_store_lookup(const RecordStore* store, const char* value) {
+
+    const size_t n = strlen(value);
+    return rc_store_probe(store, value, n, rc_store_hash(value, n))->value;
+
+}
+
+size_t rc_store_find(const RecordStore* store, const char* id) {
+
+    const uint64_t key = store->calls ? (uint64_t)(uintptr_t)rc_store_lookup(store, id) : (uint64_t)rc_scan_int(id, strlen(id));
+    const size_t* slot = key ? rc_store_index_slot(store, key) : NULL;
+    return slot && *slot ? *slot - 1 : SIZE_MAX;
+
+}
+
+void rc_store_free(RecordStore* store) {
+
+    for (StoreBlock* block = store->arena; block; ) {
+
+        StoreBlock* next = block->next;
+        free(block);
+        block = next;
+
+    }
+
+    free(store->calls);
+    free(store->extensions);
+    free(store->strings);
+    free(store->index);
+    free(store);
+
+}
@@ -0,0 +1,143 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_RECORD_STORE_H
+#define RC_RECORD_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "json_content.h"
+#include "columnar.h"
+
+#define STORE_BLOCK_SIZE (1 << 16)
+
+/// @brief A call-log record; strings are interned (NULL if absent)
+typedef struct CallRecord {
+
+    const char* id;         // alphanumeric, e.g. "Y3s9J2VkQ1UUJjZDQ2QUEBZA"
+    const char* session_id;
+    int64_t start_time;   // milliseconds since the Unix epoch (UTC)
+    int64_t extension_id;
+    int32_t duration;     // seconds
+
+    const char* type;
+    const char* direction;
+    const char* action;
+    const char* result;
+    const char* from_number;
+    const char* from_name;
+    const char* to_number;
+    const char* to_name;
+
+} CallRecord;
+
+/// @brief An extension record; strings are interned (NULL if absent)
+typedef struct ExtensionRecord {
+
+    int64_t id;
+    int64_t site_id;
+
+    const char* number;
+    const char* name;
+    const char* type;
+    const char* status;
+    const char* email;
+
+} ExtensionRecord;
+
+/**
+ * Typed in-memory record store
+ *
+ * Holds call-log or extension records as plain structs, decoded from list
+ * responses as they are fetched, instead of raw JSON text. Timestamps and
+ * durations are stored as integers; every string is unescaped once and
+ * interned into an arena, so the few distinct values of direction, result,
+ * action or extension names are stored once, and can be compared by pointer:
+ *
+ * RecordStore* store = rc_store_init(RC_SCHEMA_CALL_LOG);
+ * rc_json_pipeline(token, RC_GET_CALL_LOG, 0, rc_store_page, store);
+ *
+ * const char* missed = rc_store_lookup(store, "Missed");
+ * for (size_t i = 0; i < store->n_records; i++) {
+ *     if (store->calls[i].result == missed) { ... }
+ * }
+ * rc_store_free(store);
+ *
+ * - Records are kept in one contiguous array (calls or extensions, by schema)
+ * - A record appended again with the same id replaces the earlier one
+ *   (e.g. a page fetched twice), found through rc_store_find; call records
+ *   are keyed by their interned id string, extensions by their numeric id
+ * - Interned strings stay valid until rc_store_free
+ */
+typedef struct RecordStore {
+
+    ColumnSchema schema;
+
+    CallRecord* calls;           // RC_SCHEMA_CALL_LOG, NULL otherwise
+    ExtensionRecord* extensions; // RC_SCHEMA_EXTENSION, NULL otherwise
+    size_t n_records;
+    size_t total_records;
+
+    struct StoreBlock* arena;
+    struct StoreString* strings; // intern table
+    size_t n_strings;
+    size_t total_strings;
+
+    size_t* index;               // id (interned string or number) -> record + 1
+    size_t total_index;
+
+    size_t n_bytes;              // bytes of string data held in the arena
+    bool failed;
+
+} RecordStore;
+
+/// @brief Create an empty record store
+/// @param schema RC_SCHEMA_CALL_LOG or RC_SCHEMA_EXTENSION
+/// @return a pointer to the store; NULL if it could not be created
+RecordStore* rc_store_init(ColumnSchema schema);
+
+/// @brief Decode the records of a list response into the store
+/// @param store pointer to a RecordStore
+/// @param json a complete response, or stitched pages (e.g. JsonContent buffer)
+/// @param n number of bytes in json
+/// @return number of records decoded; fewer than in json if out of memory
+size_t rc_store_append(RecordStore* store, const char* json, size_t n);
+
+/// @brief PageConsumer for rc_json_pipeline, appends every page to the store
+/// @param page page delivered by rc_json_pipeline
+/// @param index page number (unused)
+/// @param store pointer to a RecordStore
+void rc_store_page(const JsonContent* page, size_t index, void* store);
+
+/// @brief Find the interned copy of a string, e.g. to compare fields by pointer
+/// @param store pointer to a RecordStore
+/// @param value null-terminated string
+/// @return the interned string; NULL if no record holds this value
+const char* rc_store_lookup(const RecordStore* store, const char* value);
+
+/// @brief Find a record by id
+/// @param store pointer to a RecordStore
+/// @param id record id as in the response, e.g. "Y3s9J2VkQ1UUJjZDQ2QUEBZA" or "62264425004"
+/// @return index into calls / extensions; SIZE_MAX if not found
+size_t rc_store_find(const RecordStore* store, const char* id);
+
+/// @brief Free the store, its records and all interned strings
+/// @param store pointer to a RecordStore
+void rc_store_free(RecordStore* store);
+
+#endif // RC_RECORD_STORE_H
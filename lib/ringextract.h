@@ -202,5 +202,26 @@
 
 #include "json_content.h"
 #include "media_content.h"
+#include "tracer.h"
+#include "fan_out.h"
+#include "http_pool.h"
+#include "job_runner.h"
+#include "event_loop.h"
+#include "page_ring.h"
+#include "fleet_runner.h"
+#include "checkpoint.h"
+#include "columnar.h"
+#include "record_store.h"
+#include "aggregate.h"
+#include "shared_limiter.h"
+#include "manifest.h"
+#include "poller.h"
+#include "subscription.h"
+#include "tee.h"
+#include "file_writer.h"
+#include "single_flight.h"
+#include "endpoint.h"
+#include "page_iter.h"
+#include "hedge.h"
 
 #endif // RINGEXTRACT_H
@@ -0,0 +1,369 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shared_limiter.h"
+#include "rate_limiter.h"
+#include "endpoint.h"
+#include "tracer.h"
+
+#define SHARED_MAGIC "RCLIMIT2"
+#define SHARED_NAME_SIZE 24
+
+_Static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared budgets need address-free 64-bit atomics");
+
+typedef enum { SHARED_FREE, SHARED_CLAIMING, SHARED_READY } GroupState;
+
+typedef struct SharedGroup {
+
+    atomic_uint state;
+    char name[SHARED_NAME_SIZE];      // X-Rate-Limit-Group, written once while claiming
+
+    atomic_llong limit;               // X-Rate-Limit-Limit
+    atomic_llong window;              // X-Rate-Limit-Window, in ms
+    atomic_llong remaining;           // budget left in the current window
+    atomic_llong reset_at;            // when remaining is refilled to limit (ms), 0 if unknown
+    atomic_llong blocked_until;       // no requests before (ms), after a 429
+    atomic_llong preempt_until;       // bulk requests stand aside until (ms), renewed by waiting interactive ones
+
+} SharedGroup;
+
+typedef struct SharedEndpoint {
+
+    atomic_ullong hash;               // 0 for an empty slot
+    atomic_uint group;                // group + 1
+
+} SharedEndpoint;
+
+typedef struct SharedSegment {
+
+    char magic[8];
+    SharedGroup groups[SHARED_GROUPS];
+    SharedEndpoint endpoints[SHARED_ENDPOINTS];
+
+} SharedSegment;
+
+// CLOCK_MONOTONIC is system-wide, so it is comparable across processes
+static inline int64_t rc_shared_now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+}
+
+static inline void rc_shared_sleep(int64_t ms) {
+
+    const struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000 };
+    nanosleep(&ts, NULL);
+
+}
+
+static inline void rc_shared_max(atomic_llong* value, int64_t x) {
+
+    long long current = atomic_load(value);
+    while (current < x && !atomic_compare_exchange_weak(value, &current, x)) {}
+
+}
+
+static inline void rc_shared_min(atomic_llong* value, int64_t x) {
+
+    long long current = atomic_load(value);
+    while (current > x && !atomic_compare_exchange_weak(value, &current, x)) {}
+
+}
+
+// host and path of the request URL, with ids (digits) left out: /extension/123/call-log ~ /extension/~/call-log
+static uint64_t rc_shared_endpoint_hash(CURL* curl) {
+
+    const char* url = NULL;
+
+    if (curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url) != CURLE_OK || url == NULL) { return 0; }
+    else { return rc_endpoint_hash(url); }
+
+}
+
+static SharedEndpoint* rc_shared_endpoint(SharedSegment* segment, uint64_t hash, bool insert) {
+
+    for (size_t i = 0; i < SHARED_ENDPOINTS; i++) {
+
+        SharedEndpoint* endpoint = segment->endpoints + (hash + i) % SHARED_ENDPOINTS;
+        unsigned long long current = atomic_load(&endpoint->hash);
+
+        if (current == 0 && insert) { atomic_compare_exchange_strong(&endpoint->hash, &current, hash); }
+        if (current == hash || (current == 0 && insert)) { return endpoint; }
+        if (current == 0) { return NULL; }
+
+    }
+
+    return NULL;
+
+}
+
+// find the group by name, or claim a free slot for it
+static SharedGroup* rc_shared_group(SharedSegment* segment, const char* name) {
+
+    for (size_t i = 0; i < SHARED_GROUPS; i++) {
+
+        SharedGroup* group = segment->groups + i;
+        unsigned int state = SHARED_FREE;
+
+        if (atomic_compare_exchange_strong(&group->state, &state, SHARED_CLAIMING)) {
+
+            snprintf(group->name, SHARED_NAME_SIZE, "%s", name);
+            atomic_store(&group->state, SHARED_READY);
+            return group;
+
+        }
+
+        while (state == SHARED_CLAIMING) { rc_shared_sleep(1); state = atomic_load(&group->state); }
+        if (strncmp(group->name, name, SHARED_NAME_SIZE - 1) == 0) { return group; }
+
+    }
+
+    return NULL;
+
+}
+
+static inline bool rc_shared_header(CURL* curl, const char* name, long long* value) {
+
+    struct curl_header* header;
+    if (curl_easy_header(curl, name, 0, CURLH_HEADER, -1, &header) != CURLHE_OK) { return false; }
+
+    *value = strtoll(header->value, NULL, 10);
+    return true;
+
+}
+
+SharedLimiter* rc_shared_open(const char* path) {
+
+    struct stat st;
+    struct flock lock = { .l_type = F_WRLCK, .l_whence = SEEK_SET };
+    const size_t size = sizeof(SharedSegment);
+
+    const int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) { return NULL; }
+
+    // creating the layout is serialized between processes by the file lock
+    bool ok = fcntl(fd, F_SETLKW, &lock) == 0 && fstat(fd, &st) == 0;
+
+    // another layout may still be mapped by other processes: resizing it would SIGBUS them
+    if (ok && st.st_size == 0) { ok = ftruncate(fd, size) == 0; }
+    else if (ok && (size_t)st.st_size != size) { ok = false; }
+
+    SharedSegment* segment = ok ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+
+    // a new file reads as zeros; a magic of its own size but not ours is another layout too
+    if (segment != MAP_FAILED && segment->magic[0] == '\0') { memcpy(segment->magic, SHARED_MAGIC, sizeof(segment->magic)); }
+    else if (segment != MAP_FAILED && memcmp(segment->magic, SHARED_MAGIC, sizeof(segment->magic)) != 0)
+    { munmap(segment, size); segment = MAP_FAILED; }
+
+    lock.l_type = F_UNLCK;
+    fcntl(fd, F_SETLK, &lock);
+    close(fd);
+
+    if (segment == MAP_FAILED) { return NULL; }
+
+    SharedLimiter* limiter = malloc(sizeof(SharedLimiter));
+    if (limiter == NULL) { munmap(segment, size); return NULL; }
+
+    limiter->segment = segment;
+    limiter->size = size;
+    limiter->reserve = SHARED_RESERVE;
+    return limiter;
+
+}
+
+void rc_shared_attach(SharedLimiter* limiter, BearerToken* token) { token->limiter = limiter; }
+
+void rc_shared_priority(BearerToken* token, RequestPriority priority) { token->priority = priority; }
+
+void rc_shared_reserve(SharedLimiter* limiter, unsigned int percent) { limiter->reserve = percent < 100 ? percent : 99; }
+
+void rc_shared_close(SharedLimiter* limiter) {
+
+    munmap(limiter->segment, limiter->size);
+    free(limiter);
+
+}
+
+// units of a group's budget that bulk requests leave unused
+static inline long long rc_shared_headroom(const SharedLimiter* limiter, SharedGroup* group) {
+
+    const long long limit = atomic_load(&group->limit);
+    if (limiter->reserve == 0 || limit < 2) { return 0; }
+
+    const long long units = (limit * limiter->reserve + 99) / 100;
+    return units < limit ? units : limit - 1;
+
+}
+
+// group of a preset endpoint, before the server has reported it
+static SharedGroup* rc_shared_hint(SharedLimiter* limiter, CURL* curl) {
+
+    const char* url = NULL;
+    if (curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url) != CURLE_OK || url == NULL) { return NULL; }
+
+    const Endpoint* endpoint = rc_endpoint_find(url);
+    return endpoint ? rc_shared_group(limiter->segment, rc_endpoint_group_name(endpoint->group)) : NULL;
+
+}
+
+// usage group of the request's URL; NULL until learned
+static SharedGroup* rc_shared_request_group(SharedLimiter* limiter, CURL* curl) {
+
+    SharedEndpoint* endpoint = rc_shared_endpoint(limiter->segment, rc_shared_endpoint_hash(curl), false);
+    const unsigned int index = endpoint ? atomic_load(&endpoint->group) : 0;
+
+    return index > 0 && index <= SHARED_GROUPS ? limiter->segment->groups + index - 1 : rc_shared_hint(limiter, curl);
+
+}
+
+void rc_shared_acquire(SharedLimiter* limiter, CURL* curl, RequestPriority priority) {
+
+    SharedGroup* group = rc_shared_request_group(limiter, curl);
+
+    if (group == NULL) { return; } // group not learned yet
+    const bool interactive = priority == RC_PRIORITY_INTERACTIVE;
+    const uint64_t start = rc_trace_clock();
+    int64_t waited = 0;
+
+    for (;;) {
+
+        const int64_t now = rc_shared_now();
+        const int64_t blocked = atomic_load(&group->blocked_until);
+        long long reset = atomic_load(&group->reset_at);
+
+        const long long window = atomic_load(&group->window);
+
+        if (now < blocked) { rc_shared_sleep(blocked - now); waited += blocked - now; continue; }
+        if (reset == 0 || window <= 0) { break; } // no window reported: nothing to meter against
+
+        // first process to notice the end of the window refills the budget
+        if (now >= reset) {
+
+            if (atomic_compare_exchange_strong(&group->reset_at, &reset, now + window))
+            { atomic_store(&group->remaining, atomic_load(&group->limit)); }
+
+            continue;
+
+        }
+
+        // interactive requests may spend the headroom; bulk ones also yield to waiting interactive ones
+        const long long floor = interactive ? 0 : rc_shared_headroom(limiter, group);
+        const bool yield = !interactive && now < atomic_load(&group->preempt_until);
+
+        if (!yield && atomic_fetch_sub(&group->remaining, 1) > floor) { break; }
+
+        // spent: give the unit back and poll, so a 429 published meanwhile is honored too
+        if (!yield) { atomic_fetch_add(&group->remaining, 1); }
+
+        // a crashed process stops renewing this, so bulk requests are never held back for long
+        if (interactive) { rc_shared_max(&group->preempt_until, now + 2 * SHARED_POLL_MS); }
+
+        const int64_t wait = reset - now < SHARED_POLL_MS ? reset - now : SHARED_POLL_MS;
+        rc_shared_sleep(wait);
+        waited += wait;
+
+    }
+
+    if (waited) { rc_trace_span(RC_TRACE_SLEEP, start, waited * 1000000); }
+
+}
+
+bool rc_shared_try(SharedLimiter* limiter, CURL* curl) {
+
+    SharedGroup* group = rc_shared_request_group(limiter, curl);
+    if (group == NULL) { return true; }
+
+    const int64_t now = rc_shared_now();
+    const long long reset = atomic_load(&group->reset_at);
+
+    if (now < atomic_load(&group->blocked_until) || now < atomic_load(&group->preempt_until)) { return false; }
+    if (reset == 0 || atomic_load(&group->window) <= 0) { return true; }
+    if (now >= reset) { return false; } // let rc_shared_acquire refill the budget first
+
+    // never spends the headroom kept for interactive requests
+    if (atomic_fetch_sub(&group->remaining, 1) > rc_shared_headroom(limiter, group)) { return true; }
+
+    atomic_fetch_add(&group->remaining, 1);
+    return false;
+
+}
+
+unsigned int rc_shared_update(SharedLimiter* limiter, CURL* curl, unsigned int delay) {
+
+    struct curl_header* header;
+    char name[SHARED_NAME_SIZE];
+    long long limit, remaining, window;
+    long status = 0;
+
+    if (curl_easy_header(curl, "x-rate-limit-group", 0, CURLH_HEADER, -1, &header) != CURLHE_OK) { return delay; }
+    else { snprintf(name, SHARED_NAME_SIZE, "%s", header->value); }
+
+    SharedGroup* group = rc_shared_group(limiter->segment, name);
+    if (group == NULL) { return delay; }
+
+    SharedEndpoint* endpoint = rc_shared_endpoint(limiter->segment, rc_shared_endpoint_hash(curl), true);
+    if (endpoint) { atomic_store(&endpoint->group, (unsigned int)(group - limiter->segment->groups) + 1); }
+
+    const int64_t now = rc_shared_now();
+
+    if (rc_shared_header(curl, "x-rate-limit-limit", &limit) && limit > 0) { atomic_store(&group->limit, limit); }
+    if (rc_shared_header(curl, "x-rate-limit-window", &window) && window > 0) { atomic_store(&group->window, window * 1000); }
+
+    window = atomic_load(&group->window);
+
+    // without a known window length, the budget could never be refilled on time: leave it unmetered
+    if (window > 0 && rc_shared_header(curl, "x-rate-limit-remaining", &remaining)) {
+
+        long long reset = atomic_load(&group->reset_at);
+
+        // the first response of a window starts it, later ones can only lower the budget
+        if ((reset == 0 || now >= reset) &&
+            atomic_compare_exchange_strong(&group->reset_at, &reset, now + window))
+        { atomic_store(&group->remaining, remaining); }
+        else { rc_shared_min(&group->remaining, remaining); }
+
+    }
+
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+    // an exhausted window or a 429 holds back the whole group, in every process
+    if ((status == HTTP_OK || status == HTTP_TOO_MANY_REQUESTS) && delay) {
+
+        atomic_store(&group->remaining, 0);
+        rc_shared_max(&group->blocked_until, now + (int64_t)delay * 1000);
+        return 0;
+
+    }
+
+    return delay;
+
+}
@@ -0,0 +1,138 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_SHARED_LIMITER_H
+#define RC_SHARED_LIMITER_H
+
+#define SHARED_GROUPS 8
+#define SHARED_ENDPOINTS 256
+#define SHARED_POLL_MS 250
+#define SHARED_RESERVE 10
+
+#include "bearer_token.h"
+
+/**
+ * Cross-process rate limit coordination
+ *
+ * Each process normally tracks X-Rate-Limit-Remaining on its own, so
+ * several extractors running against the same account overshoot the
+ * shared budget together, and then all receive 429 (and long Retry-After
+ * stalls) at once. Once a SharedLimiter is attached to a token, every
+ * transfer made with it (including its copies used by the job runner and
+ * rc_json_fan_out, and its access token requests) draws from a budget kept
+ * per usage group in a memory-mapped file, shared by all processes on the
+ * host that open the same file:
+ *
+ * - before a request, one unit is taken from the budget of its usage group
+ *   with an atomic decrement; once the budget is spent, the request waits
+ *   for the window to end instead of being sent
+ * - after a response, the budget is lowered to X-Rate-Limit-Remaining, and
+ *   a 429 blocks the whole group, in every process, for its Retry-After
+ * - a group whose responses never report X-Rate-Limit-Window is not
+ *   metered, since its budget could not be refilled; only 429s hold it back
+ * - usage groups are learned from X-Rate-Limit-Group; which endpoint
+ *   belongs to which group is recorded in the file for the other processes;
+ *   until then, preset endpoints are charged to the group the endpoint
+ *   registry (endpoint.h) lists for them
+ *
+ * -- Priority Classes --
+ * A bulk extraction can otherwise spend a group's whole budget, so a single
+ * lookup made meanwhile waits for the end of the window. Requests made with
+ * a token set to RC_PRIORITY_INTERACTIVE (see rc_shared_priority) are
+ * favored over the default RC_PRIORITY_BULK:
+ *
+ * - bulk requests leave SHARED_RESERVE percent of each group's limit (at
+ *   least one request) unused, as headroom for interactive requests
+ * - while an interactive request waits for budget, bulk requests waiting
+ *   in any process stand aside and let it through first
+ *
+ * rc_shared_priority(lookup, RC_PRIORITY_INTERACTIVE);
+ * rc_json_get_buffer(lookup, json, RC_GET_ACTIVE_CALLS); // does not queue behind the bulk job
+ *
+ * SharedLimiter* limiter = rc_shared_open("/dev/shm/ringextract-account");
+ * rc_shared_attach(limiter, token);
+ * rc_json_get_buffer(token, json, RC_GET_CALL_LOG);
+ * rc_shared_close(limiter);
+ *
+ * - The file is created (or reset, if it has an unknown layout) on first use
+ * - Any path works; /dev/shm keeps the budget in memory only
+ * - Applies to the blocking data fetching APIs; the event loop and the
+ *   fleet runner schedule around rate limits themselves
+ */
+typedef struct SharedLimiter {
+
+    struct SharedSegment* segment;
+    size_t size;
+
+    unsigned int reserve; // percent of each group's limit kept from bulk requests
+
+} SharedLimiter;
+
+/// @brief Map (and if needed create) a shared rate limit budget file
+/// @param path file shared by all coordinating processes, e.g. under /dev/shm
+/// @return a pointer to the limiter; NULL if the file could not be mapped, or
+///         if it holds another layout (e.g. made by another version of RingEXtract,
+///         whose processes may still use it); pick another path in that case
+SharedLimiter* rc_shared_open(const char* path);
+
+/// @brief Make every transfer of a token draw from the shared budget
+/// @param limiter pointer to a SharedLimiter (NULL to detach)
+/// @param token pointer to a BearerToken (can be just a skeleton)
+void rc_shared_attach(SharedLimiter* limiter, BearerToken* token);
+
+/// @brief Set the priority class of every request made with a token (and its copies made afterwards)
+/// @param token pointer to a BearerToken (can be just a skeleton)
+/// @param priority RC_PRIORITY_BULK (default) or RC_PRIORITY_INTERACTIVE
+void rc_shared_priority(BearerToken* token, RequestPriority priority);
+
+/// @brief Set the headroom bulk requests leave for interactive requests
+/// @param limiter pointer to a SharedLimiter
+/// @param percent percent of each group's limit (default is 10; 0 for none)
+/// @note Processes sharing the file should use the same value
+void rc_shared_reserve(SharedLimiter* limiter, unsigned int percent);
+
+/// @brief Unmap the shared budget (the file itself is kept for other processes)
+/// @param limiter pointer to a SharedLimiter
+void rc_shared_close(SharedLimiter* limiter);
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief wait until the usage group of the request's URL has budget left, and take one unit
+/// @param limiter pointer to a SharedLimiter
+/// @param curl a CURL handle with its URL set
+/// @param priority priority class of the request
+void rc_shared_acquire(SharedLimiter* limiter, CURL* curl, RequestPriority priority);
+
+/// @brief take one unit of the budget for an optional request (e.g. a hedged duplicate), without waiting
+/// @param limiter pointer to a SharedLimiter
+/// @param curl a CURL handle with its URL set
+/// @return true if a unit was taken (or the group is not learned yet); false if the
+///         request should not be sent
+bool rc_shared_try(SharedLimiter* limiter, CURL* curl);
+
+/// @brief publish the rate limit headers of a completed transfer
+/// @param limiter pointer to a SharedLimiter
+/// @param curl a CURL handle whose transfer has completed
+/// @param delay delay (in seconds) returned by rc_curl_check_limit
+/// @return the part of delay still to be waited by the caller; 0 once the
+///         wait has been published to the group (rc_shared_acquire waits it)
+unsigned int rc_shared_update(SharedLimiter* limiter, CURL* curl, unsigned int delay);
+
+#endif // RINGEXTRACT_H
+
+#endif // RC_SHARED_LIMITER_H
@@ -0,0 +1,218 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+
+#include "single_flight.h"
+#include "json_content.h"
+#include "media_content.h"
+#include "endpoint.h"
+
+typedef struct Flight {
+
+    struct Flight* next;
+
+    const BearerToken* root; // copies of a token share its root
+    FlightKind kind;
+    char* url;
+
+    const void* result; // the leader's container (or the kept copy), read by followers
+    void* kept;         // copy of the result of a cacheable endpoint, owned by the flight
+    size_t n_followers; // followers that have not copied the result yet
+    bool landed;
+
+    TokenError s_token;
+    char error[CURL_ERROR_SIZE];
+
+} Flight;
+
+SingleFlight* rc_flight_init(void) {
+
+    SingleFlight* sf = calloc(1, sizeof(SingleFlight));
+    if (sf == NULL) { return NULL; }
+
+    pthread_mutex_init(&sf->lock, NULL);
+    pthread_cond_init(&sf->cond, NULL);
+    return sf;
+
+}
+
+void rc_flight_attach(SingleFlight* flight, BearerToken* token) { token->flight = flight; }
+
+static void rc_flight_release(Flight* flight) {
+
+    if (flight->kept && flight->kind == RC_FLIGHT_JSON) { RC_JSON_FREE((JsonContent*)flight->kept); }
+    else if (flight->kept) { RC_MEDIA_FREE((MediaContent*)flight->kept); }
+
+    free(flight->kept);
+    free(flight->url);
+    free(flight);
+
+}
+
+void rc_flight_free(SingleFlight* flight) {
+
+    for (Flight* next; flight->flights; flight->flights = next) {
+
+        next = flight->flights->next;
+        rc_flight_release(flight->flights);
+
+    }
+
+    pthread_cond_destroy(&flight->cond);
+    pthread_mutex_destroy(&flight->lock);
+    free(flight);
+
+}
+
+static inline const BearerToken* rc_flight_root(const BearerToken* token) {
+
+    while (token->origin) { token = token->origin; }
+    return token;
+
+}
+
+// copy the result of a landed flight; the leader keeps it intact until every follower is done
+static void rc_flight_copy(const Flight* flight, BearerToken* token, void* result) {
+
+    const bool ok = flight->kind == RC_FLIGHT_JSON ? rc_json_copy(result, flight->result)
+                                                   : rc_media_copy(result, flight->result);
+
+    if (flight->s_token != RC_TOKEN_OK) {
+
+        token->s_token = flight->s_token;
+        memcpy(token->error, flight->error, CURL_ERROR_SIZE);
+
+    } else if (!ok) {
+
+        token->s_token = RC_CURL_TRANSFER_FAILED;
+        snprintf(token->error, CURL_ERROR_SIZE, "Out of memory copying a coalesced response");
+
+    }
+
+}
+
+bool rc_flight_join(SingleFlight* sf, BearerToken* token, FlightKind kind,
+                    const char* url, void* result, Flight** flight) {
+
+    *flight = NULL;
+
+    // a token in an error state fails on its own, without a transfer
+    if (token->s_token != RC_TOKEN_OK && token->s_token != RC_TOKEN_UNINITIALIZED) { return false; }
+
+    const BearerToken* root = rc_flight_root(token);
+    pthread_mutex_lock(&sf->lock);
+
+    Flight* f = sf->flights;
+    while (f && (f->root != root || f->kind != kind || strcmp(f->url, url) != 0)) { f = f->next; }
+
+    if (f) {
+
+        f->n_followers++;
+        sf->n_coalesced++;
+
+        while (!f->landed) { pthread_cond_wait(&sf->cond, &sf->lock); }
+        pthread_mutex_unlock(&sf->lock);
+
+        rc_flight_copy(f, token, result);
+
+        pthread_mutex_lock(&sf->lock);
+        if (--f->n_followers == 0) { pthread_cond_broadcast(&sf->cond); }
+        pthread_mutex_unlock(&sf->lock);
+        return true;
+
+    }
+
+    f = calloc(1, sizeof(Flight));
+    if (f) { f->url = strdup(url); }
+
+    if (f && f->url) {
+
+        f->root = root;
+        f->kind = kind;
+        f->result = result;
+        f->next = sf->flights;
+        sf->flights = f;
+        *flight = f;
+
+    } else { free(f); } // not coalesced, but the transfer still goes ahead
+
+    sf->n_sent++;
+    pthread_mutex_unlock(&sf->lock);
+    return false;
+
+}
+
+// copy the successful result of a cacheable endpoint for later requests
+static void* rc_flight_keep(Flight* flight, BearerToken* token) {
+
+    const Endpoint* endpoint = token->s_token == RC_TOKEN_OK ? rc_endpoint_find(flight->url) : NULL;
+    if (endpoint == NULL || !endpoint->cacheable) { return NULL; }
+
+    if (flight->kind == RC_FLIGHT_JSON) {
+
+        JsonContent* json = malloc(sizeof(JsonContent));
+        if (json) { memcpy(json, RC_JSON_INIT(0), sizeof(JsonContent)); }
+
+        if (json && !rc_json_copy(json, flight->result)) { RC_JSON_FREE(json); free(json); json = NULL; }
+        return json;
+
+    } else {
+
+        MediaContent* media = malloc(sizeof(MediaContent));
+        if (media) { memcpy(media, RC_MEDIA_INIT(0), sizeof(MediaContent)); }
+
+        if (media && !rc_media_copy(media, flight->result)) { RC_MEDIA_FREE(media); free(media); media = NULL; }
+        return media;
+
+    }
+
+}
+
+void rc_flight_land(SingleFlight* sf, Flight* flight, BearerToken* token) {
+
+    if (flight == NULL) { return; }
+
+    flight->s_token = token->s_token;
+    if (token->s_token != RC_TOKEN_OK) { memcpy(flight->error, token->error, CURL_ERROR_SIZE); }
+
+    void* kept = rc_flight_keep(flight, token);
+    pthread_mutex_lock(&sf->lock);
+
+    if (kept) { flight->kept = kept; flight->result = kept; }
+    else { // requests made from now on are sent again
+
+        Flight** link = &sf->flights;
+        while (*link != flight) { link = &(*link)->next; }
+        *link = flight->next;
+
+    }
+
+    flight->landed = true;
+    pthread_cond_broadcast(&sf->cond);
+
+    // a kept flight stays listed; its followers copy from the kept result instead
+    while (kept == NULL && flight->n_followers) { pthread_cond_wait(&sf->cond, &sf->lock); }
+    pthread_mutex_unlock(&sf->lock);
+
+    if (kept == NULL) { rc_flight_release(flight); }
+
+}
@@ -0,0 +1,102 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_SINGLE_FLIGHT_H
+#define RC_SINGLE_FLIGHT_H
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "bearer_token.h"
+
+typedef enum { RC_FLIGHT_JSON, RC_FLIGHT_MEDIA } FlightKind;
+
+/**
+ * In-flight request coalescing (single-flight)
+ *
+ * Several consumers often need the same URL at the same time, e.g. the
+ * branches of a job graph or of rc_json_fan_out each looking up
+ * RC_GET_EXTENSION. Once a SingleFlight is attached to a token, a GET made
+ * with it (or with its copies) while an identical GET is already in
+ * flight does not go to the server: the caller waits for the transfer in
+ * flight and receives a copy of its result, including its error, if any.
+ *
+ * SingleFlight* flight = rc_flight_init();
+ * rc_flight_attach(flight, token);
+ * rc_jobs_run(token, runner); // duplicate lookups are fetched once
+ * rc_flight_free(flight);
+ *
+ * - Requests are identical if they use the same URL, the same fetching API
+ *   (rc_json_get_buffer or rc_media_get_buffer) and the same token, or
+ *   copies of the same token
+ * - Only concurrent requests are coalesced: once a transfer has completed,
+ *   the next request for its URL is sent again, except for endpoints the
+ *   registry marks as cacheable (dictionaries, see endpoint.h), whose
+ *   successful responses are kept until rc_flight_free
+ * - Applies to the blocking buffer APIs; file downloads, the event loop
+ *   and the fleet runner send every request
+ */
+typedef struct SingleFlight {
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond; // a flight has landed, or a follower has copied its result
+    struct Flight* flights;
+
+    size_t n_sent;      // transfers made
+    size_t n_coalesced; // requests answered by a transfer in flight (or kept)
+
+} SingleFlight;
+
+/// @brief Create an empty set of in-flight requests
+/// @return a pointer to the SingleFlight; NULL if out of memory
+SingleFlight* rc_flight_init(void);
+
+/// @brief Coalesce identical concurrent GETs made with a token
+/// @param flight pointer to a SingleFlight (NULL to detach)
+/// @param token pointer to a BearerToken (can be just a skeleton)
+void rc_flight_attach(SingleFlight* flight, BearerToken* token);
+
+/// @brief Free a SingleFlight and the responses it keeps
+/// @param flight pointer to a SingleFlight
+/// @note Must only be called once all transfers using it have returned
+void rc_flight_free(SingleFlight* flight);
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief join an identical request in flight, or register this one
+/// @param sf pointer to a SingleFlight
+/// @param token pointer to a BearerToken
+/// @param kind container type of result
+/// @param url full url
+/// @param result pointer to a JsonContent or MediaContent container
+/// @param flight set to the new flight if the caller must make the transfer
+/// @return true if result (and token's error) was copied from a request in
+///         flight, so there is nothing left to do; false if the caller must
+///         make the transfer, then call rc_flight_land with *flight
+bool rc_flight_join(SingleFlight* sf, BearerToken* token, FlightKind kind,
+                    const char* url, void* result, struct Flight** flight);
+
+/// @brief publish the result of a transfer to the requests that joined it
+/// @param sf pointer to a SingleFlight
+/// @param flight flight returned by rc_flight_join (NULL is ignored)
+/// @param token pointer to the BearerToken that made the transfer
+/// @note Returns once every follower has copied the result
+void rc_flight_land(SingleFlight* sf, struct Flight* flight, BearerToken* token);
+
+#endif // RINGEXTRACT_H
+
+#endif // RC_SINGLE_FLIGHT_H
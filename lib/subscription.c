@@ -0,0 +1,705 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "subscription.h"
+#include "json_scan.h"
+#include "checksum.h"
+
+#define MUL(X, Y) (((X) / (Y) + 1) * (Y))
+#define MATCH(V, N, S) ((N) == sizeof(S) - 1 && memcmp(V, S, N) == 0)
+
+#define SUB_BACKOFF_MIN 1000
+#define SUB_BUFFER_SIZE 16384
+#define SUB_SLICE 100
+
+#define SUB_PATH "/restapi/v1.0/subscription/"
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+enum { WS_CONTINUATION = 0x0, WS_TEXT = 0x1, WS_BINARY = 0x2, WS_CLOSE = 0x8, WS_PING = 0x9, WS_PONG = 0xA };
+
+static inline uint64_t rc_sub_now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+}
+
+// xorshift32: frame masks and message ids only need to be unpredictable enough for proxies
+static inline uint32_t rc_sub_random(Subscription* sub) {
+
+    uint32_t x = sub->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return sub->seed = x;
+
+}
+
+static TokenError rc_sub_fail(Subscription* sub, const char* reason, const char* detail) {
+
+    snprintf(sub->token->error, CURL_ERROR_SIZE, "%s%s", reason, detail ? detail : "");
+    return sub->token->s_token = RC_CURL_TRANSFER_FAILED;
+
+}
+
+// sleep in slices so that rc_sub_stop takes effect promptly
+static void rc_sub_wait(Subscription* sub, uint64_t deadline) {
+
+    for (uint64_t now = rc_sub_now(); now < deadline && !atomic_load(&sub->stopped); now = rc_sub_now()) {
+
+        const uint64_t ms = deadline - now < SUB_SLICE ? deadline - now : SUB_SLICE;
+        const struct timespec ts = { .tv_sec = 0, .tv_nsec = (long)ms * 1000000 };
+        nanosleep(&ts, NULL);
+
+    }
+
+}
+
+static bool rc_sub_reserve(Subscription* sub, size_t size) {
+
+    if (size <= sub->size) { return true; }
+
+    const size_t new_size = MUL(size, SUB_BUFFER_SIZE);
+    char* buffer = realloc(sub->buffer, new_size);
+    if (buffer == NULL) { return false; }
+
+    sub->buffer = buffer;
+    sub->size = new_size;
+    return true;
+
+}
+
+static size_t rc_sub_save(char* contents, size_t size, size_t nitems, void* userdata) {
+
+    Subscription* sub = (Subscription*)userdata;
+    const size_t n = size * nitems;
+
+    if (!rc_sub_reserve(sub, sub->n_bytes + n + 1)) { return 0; }
+
+    memcpy(sub->buffer + sub->n_bytes, contents, n);
+    sub->n_bytes += n;
+    sub->buffer[sub->n_bytes] = '\0';
+    return n;
+
+}
+
+static TokenError rc_sub_send_raw(Subscription* sub, const unsigned char* data, size_t n) {
+
+    while (n) {
+
+        size_t sent = 0;
+        const CURLcode result = curl_easy_send(sub->curl, data, n, &sent);
+
+        if (result == CURLE_AGAIN) {
+
+            if (atomic_load(&sub->stopped)) { return rc_sub_fail(sub, "WebSocket send interrupted", NULL); }
+
+            struct pollfd pfd = { .fd = sub->socket, .events = POLLOUT };
+            poll(&pfd, 1, SUB_SLICE);
+            continue;
+
+        }
+
+        if (result != CURLE_OK) { return rc_sub_fail(sub, "WebSocket send failed: ", curl_easy_strerror(result)); }
+
+        data += sent;
+        n -= sent;
+
+    }
+
+    sub->last_sent = rc_sub_now();
+    return RC_TOKEN_OK;
+
+}
+
+// client frames are always masked (RFC 6455 5.3)
+static TokenError rc_sub_send(Subscription* sub, int opcode, const char* payload, size_t n) {
+
+    unsigned char* frame = malloc(n + 14);
+    if (frame == NULL) { return rc_sub_fail(sub, "WebSocket send failed: out of memory", NULL); }
+
+    size_t header = 2;
+    frame[0] = 0x80 | opcode;
+
+    if (n < 126) { frame[1] = 0x80 | n; }
+    else if (n < 65536) {
+
+        frame[1] = 0x80 | 126;
+        frame[2] = n >> 8;
+        frame[3] = n & 0xff;
+        header = 4;
+
+    } else {
+
+        frame[1] = 0x80 | 127;
+        for (int i = 0; i < 8; i++) { frame[2 + i] = (uint64_t)n >> (56 - 8 * i); }
+        header = 10;
+
+    }
+
+    const uint32_t mask = rc_sub_random(sub);
+    unsigned char* key = frame + header;
+    memcpy(key, &mask, 4);
+    header += 4;
+
+    for (size_t i = 0; i < n; i++) { frame[header + i] = payload[i] ^ key[i & 3]; }
+
+    const TokenError status = rc_sub_send_raw(sub, frame, header + n);
+    free(frame);
+    return status;
+
+}
+
+// read whatever has arrived, waiting up to timeout ms for it
+static TokenError rc_sub_recv(Subscription* sub, int timeout) {
+
+    if (!rc_sub_reserve(sub, sub->n_bytes + SUB_BUFFER_SIZE / 2 + 1))
+    { return rc_sub_fail(sub, "WebSocket receive failed: out of memory", NULL); }
+
+    const size_t avail = sub->size - sub->n_bytes - 1;
+    size_t n = 0;
+
+    // TLS may already hold decrypted data, so poll only when nothing is ready
+    CURLcode result = curl_easy_recv(sub->curl, sub->buffer + sub->n_bytes, avail, &n);
+
+    if (result == CURLE_AGAIN) {
+
+        struct pollfd pfd = { .fd = sub->socket, .events = POLLIN };
+        if (poll(&pfd, 1, timeout) <= 0) { return RC_TOKEN_OK; }
+
+        result = curl_easy_recv(sub->curl, sub->buffer + sub->n_bytes, avail, &n);
+        if (result == CURLE_AGAIN) { return RC_TOKEN_OK; }
+
+    }
+
+    if (result != CURLE_OK) { return rc_sub_fail(sub, "WebSocket receive failed: ", curl_easy_strerror(result)); }
+    if (n == 0) { return rc_sub_fail(sub, "WebSocket connection closed by server", NULL); }
+
+    sub->n_bytes += n;
+    sub->buffer[sub->n_bytes] = '\0';
+    sub->last_received = rc_sub_now();
+    return RC_TOKEN_OK;
+
+}
+
+static void rc_sub_uuid(Subscription* sub, char* uuid) {
+
+    const uint32_t a = rc_sub_random(sub);
+    const uint32_t b = rc_sub_random(sub);
+    const uint32_t c = rc_sub_random(sub);
+    const uint32_t d = rc_sub_random(sub);
+
+    snprintf(uuid, 37, "%08x-%04x-4%03x-%04x-%08x%04x", a, b >> 16, b & 0xfff,
+             (c >> 16 & 0x3fff) | 0x8000, d, c & 0xffff);
+
+}
+
+static void rc_sub_base64(const unsigned char* data, size_t n, char* out) {
+
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    for (size_t i = 0; i < n; i += 3) {
+
+        const uint32_t v = data[i] << 16 | (i + 1 < n ? data[i + 1] << 8 : 0) | (i + 2 < n ? data[i + 2] : 0);
+
+        *out++ = digits[v >> 18 & 63];
+        *out++ = digits[v >> 12 & 63];
+        *out++ = i + 1 < n ? digits[v >> 6 & 63] : '=';
+        *out++ = i + 2 < n ? digits[v & 63] : '=';
+
+    }
+
+    *out = '\0';
+
+}
+
+// Sec-WebSocket-Accept the server must answer with: base64(SHA-1(key + GUID)), RFC 6455 4.2.2
+static bool rc_sub_accepted(const char* key, const char* header, const char* end) {
+
+    char message[24 + sizeof(WS_GUID)];
+    uint8_t digest[SHA1_SIZE];
+    char expected[29];
+
+    rc_sha1(message, (size_t)snprintf(message, sizeof(message), "%s" WS_GUID, key), digest);
+    rc_sub_base64(digest, SHA1_SIZE, expected);
+
+    for (const char* line = strstr(header, "\r\n"); line && line < end; line = strstr(line + 2, "\r\n")) {
+
+        const char* value = line + 2;
+        if (strncasecmp(value, "Sec-WebSocket-Accept:", 21) != 0) { continue; }
+
+        for (value += 21; *value == ' ' || *value == '\t'; value++) {}
+        const size_t n = strcspn(value, " \t\r\n");
+        return n == sizeof(expected) - 1 && memcmp(value, expected, n) == 0;
+
+    }
+
+    return false;
+
+}
+
+// WebSocket token response: { "uri" : "wss://...", "ws_access_token" : "...", "expires_in" : 86400 }
+static char* rc_sub_ws_url(Subscription* sub) {
+
+    BearerToken* token = sub->token;
+    CURL* curl = curl_easy_init();
+
+    if (curl == NULL) { token->s_token = RC_CURL_INIT_FAILED; rc_curl_set_error(token); return NULL; }
+
+    sub->n_bytes = 0;
+    curl_easy_setopt(curl, CURLOPT_URL, sub->url);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, "");
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, rc_sub_save);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, sub);
+
+    if (rc_curl_auto_perform(token, curl) != RC_TOKEN_OK) { curl_easy_cleanup(curl); return NULL; }
+
+    size_t n_uri = 0;
+    size_t n_key = 0;
+    char* object = sub->buffer ? memchr(sub->buffer, '{', sub->n_bytes) : NULL;
+    char* uri = object ? (char*)rc_scan_field(object, sub->n_bytes - (object - sub->buffer), "uri", &n_uri) : NULL;
+    char* key = object ? (char*)rc_scan_field(object, sub->n_bytes - (object - sub->buffer), "ws_access_token", &n_key) : NULL;
+
+    // both are decoded in place
+    n_uri = uri ? rc_scan_string(uri, n_uri, uri) : 0;
+    n_key = key ? rc_scan_string(key, n_key, key) : 0;
+
+    if (n_uri == 0 || n_key == 0) {
+
+        curl_easy_cleanup(curl);
+        rc_sub_fail(sub, "WebSocket token parsing error: unknown response format", NULL);
+        token->s_token = RC_TOKEN_PARSING_ERROR;
+        return NULL;
+
+    }
+
+    const char* rest = uri;
+    const char* scheme = "";
+    char* escaped = curl_easy_escape(curl, key, (int)n_key);
+
+    uri[n_uri] = '\0';
+    if (strncmp(uri, "wss://", 6) == 0) { scheme = "https://"; rest = uri + 6; }
+    else if (strncmp(uri, "ws://", 5) == 0) { scheme = "http://"; rest = uri + 5; }
+
+    const size_t size = n_uri + (escaped ? strlen(escaped) : 0) + 32;
+    char* url = escaped ? malloc(size) : NULL;
+
+    if (url) { snprintf(url, size, "%s%s%caccess_token=%s", scheme, rest, strchr(rest, '?') ? '&' : '?', escaped); }
+    else { token->s_token = RC_CURL_INIT_FAILED; rc_curl_set_error(token); }
+
+    curl_free(escaped);
+    curl_easy_cleanup(curl);
+    return url;
+
+}
+
+static TokenError rc_sub_handshake(Subscription* sub, const char* url) {
+
+    // authority and request target of http(s)://authority/target
+    const char* authority = strstr(url, "://") + 3;
+    const char* target = authority + strcspn(authority, "/?");
+    const int n_authority = (int)(target - authority);
+
+    unsigned char nonce[16];
+    char key[25];
+
+    for (int i = 0; i < 16; i += 4) { const uint32_t r = rc_sub_random(sub); memcpy(nonce + i, &r, 4); }
+    rc_sub_base64(nonce, 16, key);
+
+    const size_t size = strlen(url) + 256;
+    char* request = malloc(size);
+    if (request == NULL) { return rc_sub_fail(sub, "WebSocket handshake failed: out of memory", NULL); }
+
+    const int n = snprintf(request, size,
+                           "GET %s%s HTTP/1.1\r\n"
+                           "Host: %.*s\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: Upgrade\r\n"
+                           "Sec-WebSocket-Key: %s\r\n"
+                           "Sec-WebSocket-Version: 13\r\n\r\n",
+                           *target == '/' ? "" : "/", target, n_authority, authority, key);
+
+    TokenError status = rc_sub_send_raw(sub, (const unsigned char*)request, n);
+    free(request);
+
+    const uint64_t deadline = rc_sub_now() + sub->heartbeat;
+    char* end = NULL;
+
+    sub->n_bytes = 0;
+    if (sub->buffer) { sub->buffer[0] = '\0'; }
+
+    while (status == RC_TOKEN_OK && !(end = sub->buffer ? strstr(sub->buffer, "\r\n\r\n") : NULL)) {
+
+        if (rc_sub_now() > deadline) { return rc_sub_fail(sub, "WebSocket handshake timed out", NULL); }
+        status = rc_sub_recv(sub, SUB_SLICE);
+
+    }
+
+    if (status != RC_TOKEN_OK) { return status; }
+
+    // "HTTP/1.1 101 Switching Protocols"
+    if (strncmp(sub->buffer, "HTTP/1.1 101", 12) != 0) {
+
+        sub->buffer[strcspn(sub->buffer, "\r\n")] = '\0';
+        return rc_sub_fail(sub, "WebSocket handshake rejected: ", sub->buffer);
+
+    }
+
+    // a response not computed from our key (e.g. replayed by a proxy) is not a WebSocket we opened
+    if (!rc_sub_accepted(key, sub->buffer, end)) {
+
+        return rc_sub_fail(sub, "WebSocket handshake rejected: ", "Sec-WebSocket-Accept does not match Sec-WebSocket-Key");
+
+    }
+
+    // frames may already follow the response header
+    end += 4;
+    sub->n_bytes -= end - sub->buffer;
+    memmove(sub->buffer, end, sub->n_bytes);
+    return RC_TOKEN_OK;
+
+}
+
+static TokenError rc_sub_connect(Subscription* sub) {
+
+    BearerToken* token = sub->token;
+    char* url = rc_sub_ws_url(sub);
+
+    if (url == NULL) { return token->s_token; }
+
+    sub->curl = curl_easy_init();
+
+    if (sub->curl == NULL) {
+
+        free(url);
+        token->s_token = RC_CURL_INIT_FAILED;
+        return rc_curl_set_error(token);
+
+    }
+
+    curl_easy_setopt(sub->curl, CURLOPT_URL, url);
+    curl_easy_setopt(sub->curl, CURLOPT_CONNECT_ONLY, 1L);
+    curl_easy_setopt(sub->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(sub->curl, CURLOPT_ERRORBUFFER, token->error);
+
+    TokenError status = RC_TOKEN_OK;
+
+    if (curl_easy_perform(sub->curl) == CURLE_OK) {
+
+        curl_easy_getinfo(sub->curl, CURLINFO_ACTIVESOCKET, &sub->socket);
+        sub->n_connects++;
+        status = rc_sub_handshake(sub, url);
+
+    } else { status = token->s_token = RC_CURL_TRANSFER_FAILED; }
+
+    sub->last_received = rc_sub_now();
+    free(url);
+    return status;
+
+}
+
+static void rc_sub_disconnect(Subscription* sub) {
+
+    if (sub->curl == NULL) { return; }
+
+    // going away (1001)
+    if (atomic_load(&sub->stopped) && sub->token->s_token == RC_TOKEN_OK) { rc_sub_send(sub, WS_CLOSE, "\x03\xe9", 2); }
+
+    curl_easy_cleanup(sub->curl);
+    sub->curl = NULL;
+    sub->n_bytes = 0;
+
+}
+
+static TokenError rc_sub_request(Subscription* sub) {
+
+    size_t size = 256;
+    for (size_t i = 0; i < sub->n_filters; i++) { size += strlen(sub->filters[i]) + 3; }
+
+    char* request = malloc(size);
+    if (request == NULL) { return rc_sub_fail(sub, "Subscription request failed: out of memory", NULL); }
+
+    char uuid[37];
+    rc_sub_uuid(sub, uuid);
+
+    size_t n = snprintf(request, size,
+                        "[{\"type\":\"ClientRequest\",\"messageId\":\"%s\",\"method\":\"POST\",\"path\":\"" SUB_PATH "\"},"
+                        "{\"eventFilters\":[", uuid);
+
+    for (size_t i = 0; i < sub->n_filters; i++)
+    { n += snprintf(request + n, size - n, "%s\"%s\"", i ? "," : "", sub->filters[i]); }
+
+    n += snprintf(request + n, size - n, "],\"deliveryMode\":{\"transportType\":\"WebSocket\"}}]");
+
+    const TokenError status = rc_sub_send(sub, WS_TEXT, request, n);
+    free(request);
+    return status;
+
+}
+
+static TokenError rc_sub_heartbeat(Subscription* sub) {
+
+    char message[80];
+    char uuid[37];
+    rc_sub_uuid(sub, uuid);
+
+    const int n = snprintf(message, sizeof(message), "[{\"type\":\"Heartbeat\",\"messageId\":\"%s\"}]", uuid);
+    return rc_sub_send(sub, WS_TEXT, message, n);
+
+}
+
+/**
+ * One complete message, [ header, body ]; for notifications:
+ *
+ * [ { "type" : "ServerNotification", "messageId" : "...", ... },
+ *   { "uuid" : "...", "event" : "/restapi/v1.0/account/1234/telephony/sessions",
+ *     "subscriptionId" : "...", "body" : { ... } } ]
+ *
+ * Returns the status of a ClientResponse, 0 for anything else
+ */
+static long rc_sub_message(Subscription* sub, char* message, size_t n, SubscriptionCallback callback, void* userdata) {
+
+    JsonScan scan;
+    size_t n_header = 0;
+    size_t n_body = 0;
+    size_t length = 0;
+
+    rc_scan_array(&scan, message, n);
+    const char* header = rc_scan_next(&scan, &n_header);
+    char* body = (char*)rc_scan_next(&scan, &n_body);
+
+    if (header == NULL || *header != '{') { return 0; }
+
+    const char* type = rc_scan_field(header, n_header, "type", &length);
+    if (type == NULL) { return 0; }
+
+    if (MATCH(type, length, "\"ClientResponse\"")) {
+
+        const char* status = rc_scan_field(header, n_header, "status", &length);
+        return status ? (long)rc_scan_int(status, length) : 0;
+
+    }
+
+    if (!MATCH(type, length, "\"ServerNotification\"") || body == NULL || *body != '{') { return 0; }
+
+    size_t n_event = 0;
+    size_t n_data = 0;
+    char* event = (char*)rc_scan_field(body, n_body, "event", &n_event);
+    char* data = (char*)rc_scan_field(body, n_body, "body", &n_data);
+
+    if (event == NULL || data == NULL || data + n_data >= body + n_body) { return 0; }
+
+    // terminate both in place: what follows them in the message is not needed anymore
+    data[n_data] = '\0';
+    n_event = rc_scan_string(event, n_event, event);
+    event[n_event] = '\0';
+
+    callback(event, data, n_data, userdata);
+    sub->n_events++;
+    return 0;
+
+}
+
+/**
+ * Frames are parsed in place. Data frame payloads are moved down to the
+ * end of the message being assembled at the start of the buffer (for an
+ * unfragmented message, that is a move by the frame header's size), and
+ * the message is handed to rc_sub_message once its final frame arrives.
+ */
+static TokenError rc_sub_listen(Subscription* sub, SubscriptionCallback callback, void* userdata,
+                                bool* subscribed, bool* rejected) {
+
+    size_t n_message = 0;
+    TokenError status = rc_sub_request(sub);
+
+    while (status == RC_TOKEN_OK && !atomic_load(&sub->stopped)) {
+
+        const uint64_t now = rc_sub_now();
+
+        if (now - sub->last_received > 2 * sub->heartbeat) { return rc_sub_fail(sub, "WebSocket connection timed out", NULL); }
+        if (now - sub->last_sent >= sub->heartbeat && (status = rc_sub_heartbeat(sub)) != RC_TOKEN_OK) { return status; }
+
+        size_t pos = n_message;
+
+        while (status == RC_TOKEN_OK) {
+
+            unsigned char* frame = (unsigned char*)sub->buffer + pos;
+            const size_t avail = sub->n_bytes - pos;
+
+            if (avail < 2) { break; }
+
+            size_t header = 2;
+            uint64_t length = frame[1] & 0x7f;
+
+            if (length == 126) {
+
+                if (avail < 4) { break; }
+                length = (uint64_t)frame[2] << 8 | frame[3];
+                header = 4;
+
+            } else if (length == 127) {
+
+                if (avail < 10) { break; }
+                length = 0;
+                for (int i = 0; i < 8; i++) { length = length << 8 | frame[2 + i]; }
+                header = 10;
+
+            }
+
+            const bool masked = frame[1] & 0x80;
+            if (masked) { header += 4; }
+            if (avail < header || avail - header < length) { break; } // incomplete
+
+            const int opcode = frame[0] & 0x0f;
+            const bool fin = frame[0] & 0x80;
+            unsigned char* payload = frame + header;
+
+            if (masked) { for (uint64_t i = 0; i < length; i++) { payload[i] ^= frame[header - 4 + (i & 3)]; } }
+
+            pos += header + length;
+
+            switch (opcode) {
+
+            case WS_PING:
+                status = rc_sub_send(sub, WS_PONG, (const char*)payload, length);
+                break;
+
+            case WS_PONG:
+                break;
+
+            case WS_CLOSE:
+                rc_sub_send(sub, WS_CLOSE, (const char*)payload, length < 2 ? length : 2);
+                return rc_sub_fail(sub, "WebSocket closed by server", NULL);
+
+            case WS_CONTINUATION:
+            case WS_TEXT:
+            case WS_BINARY:
+
+                memmove(sub->buffer + n_message, payload, length);
+                n_message += length;
+
+                if (fin) {
+
+                    const long response = rc_sub_message(sub, sub->buffer, n_message, callback, userdata);
+                    n_message = 0;
+
+                    if (response >= 200 && response < 300) { *subscribed = true; }
+                    else if (response >= 300) {
+
+                        char detail[32];
+                        snprintf(detail, sizeof(detail), "HTTP %ld", response);
+                        *rejected = true;
+                        return rc_sub_fail(sub, "Subscription rejected: ", detail);
+
+                    }
+
+                }
+
+                break;
+
+            default:
+                return rc_sub_fail(sub, "WebSocket protocol error: unknown opcode", NULL);
+
+            }
+
+        }
+
+        // keep the message being assembled and the incomplete frame
+        memmove(sub->buffer + n_message, sub->buffer + pos, sub->n_bytes - pos);
+        sub->n_bytes = n_message + sub->n_bytes - pos;
+
+        if (status == RC_TOKEN_OK) { status = rc_sub_recv(sub, SUB_SLICE); }
+
+    }
+
+    return status;
+
+}
+
+Subscription* rc_sub_init(BearerToken* token, const char* url, const char* const* filters,
+                          size_t n_filters, unsigned int heartbeat) {
+
+    Subscription* sub = calloc(1, sizeof(Subscription));
+    if (sub == NULL) { return NULL; }
+
+    sub->token = token;
+    sub->url = url;
+    sub->filters = filters;
+    sub->n_filters = n_filters;
+    sub->heartbeat = heartbeat > 0 ? heartbeat : SUB_HEARTBEAT;
+    sub->socket = CURL_SOCKET_BAD;
+    sub->seed = (uint32_t)time(NULL) ^ (uint32_t)(uintptr_t)sub ^ (uint32_t)rc_sub_now();
+    if (sub->seed == 0) { sub->seed = 0x9e3779b9; }
+    atomic_init(&sub->stopped, false);
+
+    return sub;
+
+}
+
+TokenError rc_sub_run(Subscription* sub, SubscriptionCallback callback, void* userdata) {
+
+    BearerToken* token = sub->token;
+    uint64_t backoff = SUB_BACKOFF_MIN;
+
+    atomic_store(&sub->stopped, false);
+
+    while (!atomic_load(&sub->stopped)) {
+
+        bool subscribed = false;
+        bool rejected = false;
+
+        // a lost connection leaves the token in that state; reconnecting is a new attempt
+        if (token->s_token == RC_CURL_TRANSFER_FAILED) { token->s_token = RC_TOKEN_OK; }
+
+        TokenError status = rc_sub_connect(sub);
+        if (status == RC_TOKEN_OK) { status = rc_sub_listen(sub, callback, userdata, &subscribed, &rejected); }
+
+        rc_sub_disconnect(sub);
+
+        if (status == RC_TOKEN_OK) { continue; }
+        if (status != RC_CURL_TRANSFER_FAILED || rejected) { return status; }
+        if (subscribed) { backoff = SUB_BACKOFF_MIN; }
+
+        rc_sub_wait(sub, rc_sub_now() + backoff);
+        backoff = backoff * 2 < SUB_BACKOFF_MAX ? backoff * 2 : SUB_BACKOFF_MAX;
+
+    }
+
+    if (token->s_token == RC_CURL_TRANSFER_FAILED) { token->s_token = RC_TOKEN_OK; }
+    return rc_curl_set_error(token);
+
+}
+
+void rc_sub_stop(Subscription* sub) { atomic_store(&sub->stopped, true); }
+
+void rc_sub_free(Subscription* sub) {
+
+    if (sub->curl) { curl_easy_cleanup(sub->curl); }
+    free(sub->buffer);
+    free(sub);
+
+}
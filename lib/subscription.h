@@ -0,0 +1,121 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_SUBSCRIPTION_H
+#define RC_SUBSCRIPTION_H
+
+#define SUB_HEARTBEAT 30000
+#define SUB_BACKOFF_MAX 60000
+
+// Event filters
+#define RC_EVENT_TELEPHONY_SESSIONS "/restapi/v1.0/account/~/telephony/sessions"
+#define RC_EVENT_PRESENCE           "/restapi/v1.0/account/~/presence?detailedTelephonyState=true"
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "bearer_token.h"
+
+/// @brief Called once per notification
+/// @param event event path of the notification (null-terminated), e.g.
+///        "/restapi/v1.0/account/1234/telephony/sessions"
+/// @param body the notification's "body" JSON object (null-terminated)
+/// @param n number of bytes in body
+/// @param userdata userdata given to rc_sub_run
+/// @note event and body point into the receive buffer and are only valid
+///       until the function returns
+typedef void (*SubscriptionCallback)(const char* event, const char* body, size_t n, void* userdata);
+
+/**
+ * WebSocket push subscription (real-time events instead of polling)
+ *
+ * A Subscription requests a WebSocket token with the token's access token
+ * (POST to RC_OAUTH_WSTOKEN), opens the WebSocket it points to, subscribes
+ * to the given event filters and invokes the callback for every
+ * notification, with the event and body pointing directly into the
+ * receive buffer. A heartbeat is sent whenever the connection has been
+ * quiet for the heartbeat interval; if nothing arrives for twice that
+ * long, or the connection drops, a new WebSocket token is requested and
+ * the subscription is re-established with exponential backoff (1 s up to
+ * SUB_BACKOFF_MAX).
+ *
+ * const char* filters[] = { RC_EVENT_TELEPHONY_SESSIONS, RC_EVENT_PRESENCE };
+ * Subscription* sub = rc_sub_init(token, RC_OAUTH_WSTOKEN, filters, 2, 0);
+ * rc_sub_run(sub, on_event, wallboard); // until rc_sub_stop(sub)
+ * rc_sub_free(sub);
+ *
+ * Both wss:// and ws:// URIs are accepted (the latter for local testing).
+ * libcurl only provides the (TLS) connection; the handshake (including the
+ * check of the server's Sec-WebSocket-Accept against the key sent) and framing
+ * are done here, so no WebSocket support is required from libcurl.
+ */
+typedef struct Subscription {
+
+    BearerToken* token;
+    const char* url;
+    const char* const* filters;
+    size_t n_filters;
+
+    uint64_t heartbeat; // ms of silence before a heartbeat is sent
+    atomic_bool stopped;
+
+    CURL* curl; // current connection, NULL while disconnected
+    curl_socket_t socket;
+    uint64_t last_received;
+    uint64_t last_sent;
+    uint32_t seed;
+
+    char* buffer; // received frames; fragmented messages are joined in place
+    size_t n_bytes;
+    size_t size;
+
+    size_t n_connects;
+    size_t n_events;
+
+} Subscription;
+
+/// @brief Create a subscription (no connection is made until rc_sub_run)
+/// @param token pointer to a BearerToken (can be just a skeleton)
+/// @param url WebSocket token endpoint, normally RC_OAUTH_WSTOKEN
+/// @param filters event filters, e.g. RC_EVENT_TELEPHONY_SESSIONS
+///        (must remain valid for the subscription's life)
+/// @param n_filters number of event filters
+/// @param heartbeat milliseconds between heartbeats (0 for default of 30000)
+/// @return a pointer to the subscription; NULL if it could not be created
+Subscription* rc_sub_init(BearerToken* token, const char* url, const char* const* filters,
+                          size_t n_filters, unsigned int heartbeat);
+
+/// @brief Connect, subscribe and deliver notifications until stopped,
+///        reconnecting whenever the connection is lost
+/// @param sub pointer to a Subscription
+/// @param callback called for every notification
+/// @param userdata passed to callback
+/// @return RC_TOKEN_OK once stopped by rc_sub_stop; otherwise the token or
+///         credential error, or the rejected subscription, that ended it
+///         (the reason is in the token's error buffer)
+TokenError rc_sub_run(Subscription* sub, SubscriptionCallback callback, void* userdata);
+
+/// @brief Make rc_sub_run return within a fraction of a second (callable
+///        from the callback or from another thread)
+/// @param sub pointer to a Subscription
+void rc_sub_stop(Subscription* sub);
+
+/// @brief Free the subscription (after rc_sub_run has returned)
+/// @param sub pointer to a Subscription
+void rc_sub_free(Subscription* sub);
+
+#endif // RC_SUBSCRIPTION_H
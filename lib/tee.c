@@ -0,0 +1,214 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tee.h"
+#include "tracer.h"
+
+static bool rc_tee_add(Tee* tee, Sink sink) {
+
+    if (tee->n_sinks == TEE_SINKS) { return false; }
+
+    tee->sinks[tee->n_sinks++] = sink;
+    return true;
+
+}
+
+bool rc_tee_fd(Tee* tee, int fd) {
+
+    const off_t offset = lseek(fd, 0, SEEK_CUR);
+    return rc_tee_add(tee, (Sink){ .type = RC_SINK_FD, .fd = fd, .offset = offset });
+
+}
+
+bool rc_tee_media(Tee* tee, MediaContent* media)
+{ return rc_tee_add(tee, (Sink){ .type = RC_SINK_MEDIA, .fd = -1, .target = media }); }
+
+bool rc_tee_json(Tee* tee, JsonContent* json)
+{ return rc_tee_add(tee, (Sink){ .type = RC_SINK_JSON, .fd = -1, .target = json }); }
+
+bool rc_tee_digest(Tee* tee, Digest* digest)
+{ return rc_tee_add(tee, (Sink){ .type = RC_SINK_DIGEST, .fd = -1, .target = digest }); }
+
+bool rc_tee_callback(Tee* tee, SinkWrite write, SinkFinish finish, void* userdata) {
+
+    const Sink sink = { .type = RC_SINK_CALLBACK, .fd = -1, .target = userdata, .write = write, .finish = finish };
+    return rc_tee_add(tee, sink);
+
+}
+
+// 0 on success, otherwise errno
+static int rc_tee_write_fd(Sink* sink, const char* data, size_t n) {
+
+    while (n) {
+
+        const ssize_t written = sink->offset >= 0 ? pwrite(sink->fd, data, n, sink->offset) : write(sink->fd, data, n);
+
+        if (written < 0 && errno == EINTR) { continue; }
+        if (written <= 0) { return written < 0 ? errno : EIO; }
+
+        if (sink->offset >= 0) { sink->offset += written; }
+        data += written;
+        n -= written;
+
+    }
+
+    return 0;
+
+}
+
+static size_t rc_curl_write_tee(char* contents, size_t size, size_t nitems, void* userdata) {
+
+    Tee* tee = (Tee*)userdata;
+    const size_t n = size * nitems;
+
+    for (size_t i = 0; i < tee->n_sinks; i++) {
+
+        Sink* sink = tee->sinks + i;
+        bool ok = true;
+
+        switch (sink->type) {
+
+        case RC_SINK_FD:
+            tee->errnum = rc_tee_write_fd(sink, contents, n);
+            ok = tee->errnum == 0;
+            break;
+
+        case RC_SINK_MEDIA:
+            ok = rc_curl_write_media(contents, 1, n, sink->target) == n;
+            break;
+
+        case RC_SINK_JSON:
+            ok = rc_curl_write_json(contents, 1, n, sink->target) == n;
+            break;
+
+        case RC_SINK_DIGEST:
+            rc_checksum_update(&((Digest*)sink->target)->checksum, contents, n);
+            break;
+
+        case RC_SINK_CALLBACK:
+            ok = sink->write(contents, n, sink->target) == n;
+            break;
+
+        }
+
+        if (!ok) { tee->failed = i + 1; return 0; }
+
+    }
+
+    tee->n_bytes += n;
+    return n;
+
+}
+
+static void rc_tee_reset(Tee* tee) {
+
+    tee->n_bytes = 0;
+    tee->failed = 0;
+    tee->errnum = 0;
+
+    for (size_t i = 0; i < tee->n_sinks; i++) {
+
+        Sink* sink = tee->sinks + i;
+
+        if (sink->type == RC_SINK_MEDIA) { ((MediaContent*)sink->target)->n_bytes = 0; }
+        else if (sink->type == RC_SINK_JSON) { rc_json_reset(sink->target); }
+        else if (sink->type == RC_SINK_DIGEST) { rc_checksum_init(&((Digest*)sink->target)->checksum); }
+
+    }
+
+}
+
+static void rc_tee_finish(BearerToken* token, Tee* tee) {
+
+    for (size_t i = 0; i < tee->n_sinks; i++) {
+
+        Sink* sink = tee->sinks + i;
+
+        if (sink->type == RC_SINK_DIGEST) {
+
+            Digest* digest = (Digest*)sink->target;
+            rc_checksum_final(&digest->checksum, digest->sha256);
+            digest->crc32c = digest->checksum.crc32c;
+            digest->n_bytes = digest->checksum.n_bytes;
+
+        } else if (sink->type == RC_SINK_CALLBACK && sink->finish) {
+
+            if (!sink->finish(sink->target) && tee->failed == 0) { tee->failed = i + 1; }
+
+        }
+
+    }
+
+    if (tee->failed && token->s_token == RC_TOKEN_OK) { token->s_token = RC_CURL_TRANSFER_FAILED; }
+
+    if (tee->failed) {
+
+        const Sink* sink = tee->sinks + tee->failed - 1;
+        const char* reason = sink->type == RC_SINK_FD ? strerror(tee->errnum) : "sink rejected the data";
+        snprintf(token->error, CURL_ERROR_SIZE, "Tee sink %zu failed: %s", tee->failed, reason);
+
+    }
+
+}
+
+void rc_tee_get(BearerToken* token, Tee* tee, const char* url) {
+
+    CURL* curl = curl_easy_init();
+    JsonContent* json = NULL;
+
+    if (curl) {
+
+        rc_tee_reset(tee);
+
+        curl_easy_setopt(curl, CURLOPT_URL, url);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, rc_curl_write_tee);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, tee);
+
+    } else { token->s_token = RC_CURL_INIT_FAILED; return; }
+
+    // the first JsonContent sink drives the page loop
+    for (size_t i = 0; i < tee->n_sinks && json == NULL; i++)
+    { if (tee->sinks[i].type == RC_SINK_JSON) { json = tee->sinks[i].target; } }
+
+    do {
+
+        const uint64_t start = rc_trace_clock();
+        const size_t page = json ? json->n_pages : 0;
+
+        if (rc_curl_auto_perform(token, curl) != RC_TOKEN_OK) { rc_trace_span(RC_TRACE_PAGE, start, page); break; }
+
+        for (size_t i = 0; i < tee->n_sinks; i++)
+        { if (tee->sinks[i].type == RC_SINK_JSON) { rc_curl_next_page(tee->sinks[i].target); } }
+
+        rc_trace_span(RC_TRACE_PAGE, start, page);
+
+        curl_easy_setopt(curl, CURLOPT_URL, json ? json->url_next_page : NULL);
+
+    } while (json && json->url_next_page);
+
+    rc_tee_finish(token, tee);
+    curl_easy_cleanup(curl);
+
+}
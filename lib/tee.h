@@ -0,0 +1,155 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_TEE_H
+#define RC_TEE_H
+
+#define TEE_SINKS 8
+
+#include <sys/types.h>
+#include "json_content.h"
+#include "media_content.h"
+#include "checksum.h"
+
+/// @brief Consumes one chunk of the response (e.g. feeds a compressor or parser)
+/// @param data chunk of the response, only valid until the function returns
+/// @param n number of bytes in data
+/// @param userdata userdata given to rc_tee_callback
+/// @return n on success; anything else fails the transfer
+typedef size_t (*SinkWrite)(const char* data, size_t n, void* userdata);
+
+/// @brief Called once after the last chunk (e.g. to flush a compressor)
+/// @param userdata userdata given to rc_tee_callback
+/// @return true on success; false fails the transfer
+typedef bool (*SinkFinish)(void* userdata);
+
+/// @brief Size, CRC32C and SHA-256 of a response, filled in by rc_tee_get
+typedef struct Digest {
+
+    uint64_t n_bytes;
+    uint32_t crc32c;
+    uint8_t sha256[SHA256_SIZE];
+
+    Checksum checksum; // running state during the transfer
+
+} Digest;
+
+typedef enum { RC_SINK_FD, RC_SINK_MEDIA, RC_SINK_JSON, RC_SINK_DIGEST, RC_SINK_CALLBACK } SinkType;
+
+typedef struct Sink {
+
+    SinkType type;
+    int fd;
+    off_t offset; // next pwrite offset; -1 for unseekable descriptors
+    void* target; // MediaContent, JsonContent, Digest or userdata
+
+    SinkWrite write;
+    SinkFinish finish;
+
+} Sink;
+
+/**
+ * Not using opaque typedef here, specifically so that
+ * RC_TEE_INIT can initialize the struct inline
+ * without function call / copy on return
+ */
+
+/**
+ * Tee of response bytes to several sinks
+ *
+ * Every other fetching API writes a response to exactly one place. A Tee
+ * hands each chunk libcurl receives to all of its sinks, in the order they
+ * were added, straight from libcurl's buffer: a file written with pwrite,
+ * a MediaContent (raw bytes), a JsonContent (stitched page loop), a Digest
+ * and user callbacks (parsers, compressors, ...). A file, its parsed form
+ * and its checksum come out of the same transfer without reading anything
+ * back.
+ *
+ * Tee* tee = RC_TEE_INIT();
+ * int fd = open("a.mp3", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+ * Digest digest;
+ * rc_tee_fd(tee, fd);
+ * rc_tee_digest(tee, &digest);
+ * rc_tee_callback(tee, deflate_chunk, deflate_end, &z); // e.g. zlib
+ * rc_tee_get(token, tee, url);
+ *
+ * - With a JsonContent sink, rc_tee_get follows the page loop like
+ *   rc_json_get_buffer; the other sinks then receive the raw response of
+ *   every page, one after the other
+ * - Containers and digests are reset by each rc_tee_get; file sinks keep
+ *   writing where the previous call stopped
+ * - The tee does not own its sinks: descriptors stay open, containers
+ *   must still be freed
+ */
+typedef struct Tee {
+
+    Sink sinks[TEE_SINKS];
+    size_t n_sinks;
+
+    uint64_t n_bytes; // passed to every sink by the last rc_tee_get
+    size_t failed;    // 1-based index of the sink that failed; 0 if none
+    int errnum;       // errno of a failed file descriptor sink
+
+} Tee;
+
+/// @brief Create an empty Tee on the stack
+/// @return a pointer to the Tee
+#define RC_TEE_INIT() &(Tee) { .n_sinks = 0, .n_bytes = 0, .failed = 0, .errnum = 0 }
+
+/// @brief Add a file descriptor sink, written with pwrite from its current offset
+/// @param tee pointer to a Tee
+/// @param fd open file descriptor (pipes and sockets are written with write)
+/// @return false if the tee already has TEE_SINKS sinks
+bool rc_tee_fd(Tee* tee, int fd);
+
+/// @brief Add a MediaContent sink (raw bytes)
+/// @param tee pointer to a Tee
+/// @param media pointer to a MediaContent container
+/// @return false if the tee already has TEE_SINKS sinks
+bool rc_tee_media(Tee* tee, MediaContent* media);
+
+/// @brief Add a JsonContent sink (records of all pages, same as rc_json_get_buffer)
+/// @param tee pointer to a Tee
+/// @param json pointer to a JsonContent container
+/// @return false if the tee already has TEE_SINKS sinks
+bool rc_tee_json(Tee* tee, JsonContent* json);
+
+/// @brief Add a digest sink (size, CRC32C and SHA-256 of the response)
+/// @param tee pointer to a Tee
+/// @param digest pointer to a Digest, filled in once rc_tee_get returns
+/// @return false if the tee already has TEE_SINKS sinks
+bool rc_tee_digest(Tee* tee, Digest* digest);
+
+/// @brief Add a user sink
+/// @param tee pointer to a Tee
+/// @param write called for every chunk
+/// @param finish called once after the last chunk, even if the transfer
+///        failed (NULL if not needed)
+/// @param userdata passed to write and finish
+/// @return false if the tee already has TEE_SINKS sinks
+bool rc_tee_callback(Tee* tee, SinkWrite write, SinkFinish finish, void* userdata);
+
+/// @brief Fetch a url into every sink of the tee
+/// @param token pointer to a BearerToken (can be just a skeleton)
+/// @param tee pointer to a Tee
+/// @param url full url
+/// @note Errors are reported through token; if a sink failed, tee->failed
+///       tells which one
+void rc_tee_get(BearerToken* token, Tee* tee, const char* url);
+
+#endif // RC_TEE_H
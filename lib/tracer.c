@@ -0,0 +1,159 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "tracer.h"
+
+typedef struct {
+
+    uint64_t start;
+    uint64_t duration;
+    int64_t arg;
+    uint32_t tid;
+    uint32_t event;
+
+} TraceSpan;
+
+static TraceSpan* _Atomic rc_trace_ring = NULL;
+static atomic_size_t rc_trace_head = 0;
+static size_t rc_trace_mask = 0;
+
+static atomic_uint rc_trace_threads = 0;
+static _Thread_local uint32_t rc_trace_tid = 0;
+
+static const struct { const char* name; const char* cat; const char* arg; } rc_trace_names[] = {
+
+    [RC_TRACE_TOKEN]   = { "token request", "auth",    "status"  },
+    [RC_TRACE_PERFORM] = { "transfer",      "http",    "status"  },
+    [RC_TRACE_TTFB]    = { "first byte",    "http",    "status"  },
+    [RC_TRACE_PAGE]    = { "page",          "json",    "page"    },
+    [RC_TRACE_SLEEP]   = { "sleep",         "limiter", "ns"      }
+
+};
+
+static inline uint64_t rc_trace_now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+
+}
+
+uint64_t rc_trace_clock(void) {
+
+    if (atomic_load_explicit(&rc_trace_ring, memory_order_relaxed)) { return rc_trace_now(); }
+    else { return 0; }
+
+}
+
+void rc_trace_record(TraceEvent event, uint64_t start, uint64_t duration, int64_t arg) {
+
+    TraceSpan* ring = atomic_load_explicit(&rc_trace_ring, memory_order_acquire);
+    if (start == 0 || ring == NULL) { return; }
+
+    if (rc_trace_tid == 0) { rc_trace_tid = atomic_fetch_add(&rc_trace_threads, 1) + 1; }
+
+    const size_t index = atomic_fetch_add_explicit(&rc_trace_head, 1, memory_order_relaxed);
+    TraceSpan* span = ring + (index & rc_trace_mask);
+
+    span->start = start;
+    span->duration = duration;
+    span->arg = arg;
+    span->tid = rc_trace_tid;
+    span->event = event;
+
+}
+
+void rc_trace_span(TraceEvent event, uint64_t start, int64_t arg) {
+
+    if (start) { rc_trace_record(event, start, rc_trace_now() - start, arg); }
+
+}
+
+size_t rc_trace_start(size_t capacity) {
+
+    size_t size = 1;
+    capacity = capacity > 0 ? capacity : TRACE_INIT_SIZE;
+    while (size < capacity) { size <<= 1; }
+
+    rc_trace_stop();
+    TraceSpan* ring = calloc(size, sizeof(TraceSpan));
+    if (ring == NULL) { return 0; }
+
+    rc_trace_mask = size - 1;
+    atomic_store(&rc_trace_head, 0);
+    atomic_store_explicit(&rc_trace_ring, ring, memory_order_release);
+    return size;
+
+}
+
+void rc_trace_stop(void) {
+
+    TraceSpan* ring = atomic_exchange(&rc_trace_ring, NULL);
+    free(ring);
+
+}
+
+const char* rc_trace_fwrite(const char* file) {
+
+    const TraceSpan* ring = atomic_load(&rc_trace_ring);
+    if (ring == NULL) { return NULL; }
+
+    FILE* f = file ? fopen(file, "w") : stdout;
+    if (f == NULL) { return NULL; }
+
+    const size_t head = atomic_load(&rc_trace_head);
+    const size_t size = rc_trace_mask + 1;
+    const size_t first = head > size ? head - size : 0;
+    const int pid = (int)getpid();
+    size_t n = 0;
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    for (size_t i = first; i < head; i++) {
+
+        const TraceSpan* span = ring + (i & rc_trace_mask);
+        if (span->start == 0) { continue; } // claimed but not yet written
+
+        fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                   "\"ts\":%llu.%03u,\"dur\":%llu.%03u,\"pid\":%d,\"tid\":%u,"
+                   "\"args\":{\"%s\":%lld}}",
+                n++ ? "," : "",
+                rc_trace_names[span->event].name,
+                rc_trace_names[span->event].cat,
+                (unsigned long long)(span->start / 1000), (unsigned)(span->start % 1000),
+                (unsigned long long)(span->duration / 1000), (unsigned)(span->duration % 1000),
+                pid, span->tid,
+                rc_trace_names[span->event].arg, (long long)span->arg);
+
+    }
+
+    fprintf(f, "\n]}\n");
+    fflush(f);
+
+    if (file) { fclose(f); } // If file is null, f is stdout. Do not close.
+    return file;
+
+}
@@ -0,0 +1,94 @@
+/**
+ *  RingEXtract - RingEX C Interface for Data Extraction
+ *  Copyright (C) 2024 Ian Wang
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RC_TRACER_H
+#define RC_TRACER_H
+
+#define TRACE_INIT_SIZE (1 << 16)
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Optional timeline tracer, disabled by default
+ *
+ * Once started, RingEXtract records a span for every token request,
+ * every transfer attempt (and its time to first byte), every page
+ * of a page loop and every rate limiter sleep. Spans are stored in a
+ * pre-allocated ring, so recording costs two clock reads and one
+ * atomic increment; the oldest spans are overwritten when it is full.
+ *
+ * The recorded timeline is exported in Chrome trace-event JSON format,
+ * which can be opened in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * rc_trace_start(0);
+ * rc_json_get_buffer(token, json, RC_GET_CALL_LOG);
+ * rc_trace_fwrite("trace.json");
+ * rc_trace_stop();
+ */
+
+typedef enum {
+
+    RC_TRACE_TOKEN,   // rc_token_request: access token request
+    RC_TRACE_PERFORM, // rc_curl_set_limit: one transfer attempt
+    RC_TRACE_TTFB,    // from start of a transfer attempt to its first byte
+    RC_TRACE_PAGE,    // one iteration of a page loop
+    RC_TRACE_SLEEP    // rate limiter wait (argument: the wait, in nanoseconds)
+
+} TraceEvent;
+
+/// @brief Start recording spans (restarts from an empty ring if already started)
+/// @param capacity number of spans kept in the ring (rounded up to a power of 2)
+/// @return the capacity allocated; 0 if allocation failed (tracer stays disabled)
+/// @note To accept default capacity (65536 spans), pass in 0
+size_t rc_trace_start(size_t capacity);
+
+/// @brief Write recorded spans to file in Chrome trace-event JSON format
+/// @param file full path & file name to be written. If null, writing to stdout
+/// @return if written successfully, the file name (same as the file argument);
+///         otherwise, NULL
+/// @note Spans still being recorded by other threads may be incomplete;
+///       call after transfers have returned for a consistent timeline
+const char* rc_trace_fwrite(const char* file);
+
+/// @brief Stop recording and free the ring
+/// @note Must not be called while other threads are still transferring
+void rc_trace_stop(void);
+
+#ifndef RINGEXTRACT_H // internal functions used within RingEXtract
+
+/// @brief read the trace clock
+/// @return current monotonic time in nanoseconds; 0 if tracing is disabled
+uint64_t rc_trace_clock(void);
+
+/// @brief record a span that started at start and ends now
+/// @param event the kind of span
+/// @param start value returned by rc_trace_clock (no-op if 0)
+/// @param arg event specific argument (page number, HTTP status, wait in nanoseconds, etc.)
+void rc_trace_span(TraceEvent event, uint64_t start, int64_t arg);
+
+/// @brief record a span with an explicit duration
+/// @param event the kind of span
+/// @param start value returned by rc_trace_clock (no-op if 0)
+/// @param duration span duration in nanoseconds
+/// @param arg event specific argument
+void rc_trace_record(TraceEvent event, uint64_t start, uint64_t duration, int64_t arg);
+
+#endif // RINGEXTRACT_H
+
+#endif // RC_TRACER_H